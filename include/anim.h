@@ -0,0 +1,16 @@
+#ifndef __ANIM_H
+#define __ANIM_H
+
+#include <stdio.h>
+#include <string.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+
+#include "typedef.h"
+#include "cubes.h"
+
+void init_animations(Animations *anims, const Frame *initial);
+void schedule_effects(Animations *anims, const Frame *prev, const Frame *cur);
+U8 draw_effects(Animations *anims, RenderBackend *rb, ScreenCache *screens, const Frame *cur);
+
+#endif // __ANIM_H
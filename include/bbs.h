@@ -56,18 +56,10 @@ static inline U32 get_seed() {
     return (U32)time(NULL);
 }
 
-// Optimized Blum Blum Shub CSPRNG with inlined modular reduction
+// Blum Blum Shub step x_n+1 = x_n^2 mod N (truncated to 32 bit)
 static inline U32 bbs(U32 seed) {
-    U64 x = (U64)seed * seed;  // (x_n+1)^2
-    U32 res;
-    __asm__ __volatile__(
-        "divq %[modulus]\n\t"           // Divide x by N
-        : "=a" (res)                    // Remainder in res (lower 32 bits of quotient)
-        : "d" ((U32)(x >> 32)),         // High 32 bits of dividend
-          "a" ((U32)x),                 // Low 32 bits of dividend
-          [modulus] "r" (N)             // Divisor N
-    );
-    return res;
+    U64 x = (U64)seed * seed;  // (x_n)^2 always fits, a single 64 bit division
+    return (U32)(x % N);
 }
 static inline U32 random_U32(U32 *seed) {
     *seed = bbs(*seed);
@@ -0,0 +1,22 @@
+#ifndef __BOT_H
+#define __BOT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "typedef.h"
+#include "cubes.h"
+
+#define BOT_WEIGHT_HEIGHT -51	// per cell of aggregate column height
+#define BOT_WEIGHT_LINES 76		// per removed row
+#define BOT_WEIGHT_HOLES -36	// per empty cell below the top of its column
+#define BOT_WEIGHT_BUMPINESS -18	// per cell of height difference between neighbouring columns
+#define BOT_WEIGHT_WELLS -10		// per empty cell between two filled ones, open to the top
+#define BOT_WEIGHT_ROW_TRANSITIONS -8	// per change between filled and empty along a row
+
+void init_bot(Bot *bot);
+const Move *choose_move(const GameBoard *board, const MoveList *list);
+void bot_tick(Bot *bot, Game *game);
+
+#endif // __BOT_H
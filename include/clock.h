@@ -0,0 +1,11 @@
+#ifndef __CLOCK_H
+#define __CLOCK_H
+
+#include <time.h>
+
+#include "typedef.h"
+
+I64 now_ns(void);
+void sleep_until_ns(I64 when);
+
+#endif // __CLOCK_H
@@ -4,15 +4,34 @@
 
 #include "window.h"
 #include "graphics.h"
+#include "render.h"
 #include "input.h"
 #include "typedef.h"
+#include "clock.h"
 #include "game.h"
+#include "options.h"
+#include "pipeline.h"
+#include "stream.h"
+#include "metrics.h"
+#include "xstats.h"
+#include "font.h"
+#include "solver.h"
+#include "movegen.h"
+#include "rewind.h"
+#include "shm.h"
+#include "anim.h"
+#include "eval.h"
+#include "bot.h"
+#include "grid.h"
+#include "hash.h"
 
 // Global variables
 extern bool needsRedraw;
+extern Region exposeRegion; // damaged window area not repainted yet
+extern XAccounting xAccounting; // X traffic per frame (--xstats)
 
 // Main game loop
-int main(void);
+int main(int argc, char **argv);
 
 #endif // __CUBES_H
 
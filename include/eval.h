@@ -0,0 +1,31 @@
+#ifndef __EVAL_H
+#define __EVAL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "typedef.h"
+#include "cubes.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define EVAL_X86 1 // SSE2 and AVX2 kernels, chosen at runtime
+#include <immintrin.h>
+#else
+#define EVAL_X86 0
+#endif
+
+#define EVAL_FULL_ROW ((1U << BOARD_WIDTH) - 1)
+
+void board_rows(const GameBoard *board, U16 rows[BOARD_HEIGHT]);
+U8 place_rows(U16 rows[BOARD_HEIGHT], const Placement *placement);
+void evaluate_batch_scalar(const EvalBatch *batch, EvalFeatures *features);
+#if EVAL_X86
+void evaluate_batch_sse2(const EvalBatch *batch, EvalFeatures *features);
+void evaluate_batch_avx2(const EvalBatch *batch, EvalFeatures *features);
+#endif
+bool eval_kernel_supported(EvalKernel kernel);
+EvalKernel eval_kernel(void);
+void evaluate_batch(const EvalBatch *batch, EvalFeatures *features);
+
+#endif // __EVAL_H
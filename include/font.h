@@ -0,0 +1,25 @@
+#ifndef __FONT_H
+#define __FONT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <fontconfig/fontconfig.h>
+#include <X11/Xft/Xft.h>
+
+#include "typedef.h"
+#include "writer.h"
+
+#define FONT_CACHE_FILE_NAME ".cubes_fonts" // default location is $HOME/.cubes_fonts
+#define FONT_CACHE_VERSION 1
+#define FONT_PATH_LENGTH 256
+
+void start_font_loading(void);
+I8 finish_font_loading(XWindow *xw, XftFont *fonts[FONT_COUNT]);
+void join_font_loader(void);
+
+#endif // __FONT_H
@@ -2,23 +2,37 @@
 #define __GAME_H
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <X11/Xlib.h>
 #include "typedef.h"
 #include "window.h" // for window width and height
 #include "graphics.h"
 #include "cubes.h"
-#include "bbs.h"
+#include "rng.h"
+#include "score.h"
+#include "snapshot.h"
+
+#define GRAVITY_SPEED 1      // pixels the tetromino falls per frame
+#define SOFT_DROP_SPEED 0xf  // pixels per frame while the down key is held
+#define SPAWN_COLUMN 4       // board column the 4x4 shape of a new tetromino starts in
+
+// window position of a tetromino (in px)
+#define TETROMINO_X(t) (BOARD_OFFSET_LEFT + (t)->col * CELL_SIZE)
+#define TETROMINO_Y(t) (BOARD_OFFSET_TOP + (t)->row * CELL_SIZE + (t)->fraction * viewScale)
 
 // precomputed tetrominos with there spective rotation values
-extern Tetromino tetrominos[];
-extern U32 seed;
+extern Tetromino tetrominos[TETROMINO_TYPES];
 
-I8 init_game(GameBoard *board);
-Tetromino *get_tetromino();
-bool move_tetromino(XWindow *xw, GameBoard *board, Tetromino *tetromino, const char *keyBuf);
-void update_game(XWindow *xw, Tetromino **currentTetromino);
-GameState remove_full_row(GameBoard *board);
-void free_game(GameBoard *board);
+void init_game(GameBoard *board, U64 highscore);
+Tetromino *get_tetromino(U8 type);
+bool drop_tetromino(GameBoard *board, Tetromino *tetromino, U16 distance);
+bool move_tetromino(GameBoard *board, Tetromino *tetromino, KeyAction action);
+bool shift_tetromino(GameBoard *board, Tetromino *tetromino, I8 direction);
+GameState remove_full_row(GameBoard *board, U8 *rowsCleared);
 void free_tetromino(Tetromino **tetromino);
+void init_session(Game *game, const Options *options, Leaderboard *leaderboard);
+void step_game(Game *game, InputQueue *queue);
+void snapshot_game(const Game *game, Frame *frame);
+void free_session(Game *game);
 
 #endif // __GAME_H
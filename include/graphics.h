@@ -12,12 +12,45 @@
 
 #define REVERSED_STREAM 1 // reversal of the default color scheme
 
+#if REVERSED_STREAM
+#define COLOR_FOREGROUND 0xffffff
+#define COLOR_BACKGROUND 0x000000
+#else
+#define COLOR_FOREGROUND 0x000000
+#define COLOR_BACKGROUND 0xffffff
+#endif
+#define COLOR_BLOCK 0xc0c0c0 // placed cubes
+
+#define LINE_WIDTH (2 * viewScale) // outlines of the board and the T-cube
+#define BEVEL_DIVISOR 8 // width of the lit and shaded block edges: 1/8 of the block
+
+#define HUD_LINES 3 // score, highscore and level next to the board
+#define HUD_LINE_LENGTH 32
+
+extern BoardLayout boardLayout; // the board of the game window, follows the view scale
+
+I8 set_view_scale(U16 scale);
 void init_graphics(XWindow *xw);
-XftFont* init_font(XWindow *xw, const char* fontname);
-U16 draw_text_center(Display *display, Window window, XftFont *font, const char *text, I16 yPadding, bool effect);
-void draw_start_screen(XWindow *xw, XftFont *fontText, XftFont *fontHeadlines);
-void draw_end_screen(XWindow *xw, XftFont *fontText, XftFont *fontHeadlines);
-void draw_board(XWindow *xw, GameBoard *board, XftFont *scoreFont) ;
-void draw_tetromino(Display *display, Window window, GC gc, Tetromino *tetromino);
+void draw_T_cube(RenderBackend *rb, Surface target, U16 size, U16 y);
+U16 draw_text_center(RenderBackend *rb, Surface target, FontId font, const char *text, I16 yPadding, bool effect);
+void draw_start_screen(RenderBackend *rb, Surface target);
+void draw_pause_screen(RenderBackend *rb, Surface target);
+void draw_end_screen(RenderBackend *rb, Surface target);
+void init_screens(ScreenCache *screens);
+void draw_screen(RenderBackend *rb, ScreenCache *screens, ScreenId id);
+void free_screens(RenderBackend *rb, ScreenCache *screens);
+U32 cell_color(U8 index);
+U32 shade_color(U32 color, I16 amount);
+void draw_block_atlas(RenderBackend *rb, Surface target, U16 size);
+void draw_blocks(RenderBackend *rb, ScreenCache *screens, Surface target, U8 color, const XRectangle *blocks, U16 count);
+void border_rects(const BoardLayout *layout, XRectangle rects[4]);
+void collect_cells(const BoardLayout *layout, const GameBoard *board, Region region, XRectangle *cells, U16 start[CELL_COLORS], U16 end[CELL_COLORS]);
+void draw_board(RenderBackend *rb, ScreenCache *screens, const GameBoard *board);
+void repaint_region(RenderBackend *rb, ScreenCache *screens, const GameBoard *board, const Tetromino *tetromino, Region region);
+void clear_tetromino(RenderBackend *rb, const Tetromino *tetromino);
+U8 tetromino_blocks(const BoardLayout *layout, const Tetromino *tetromino, XRectangle blocks[4]);
+void draw_tetromino(RenderBackend *rb, ScreenCache *screens, Surface target, const Tetromino *tetromino);
+void reset_expose_region(void);
+void render_frame(RenderBackend *rb, ScreenCache *screens, Animations *anims, const Frame *prev, const Frame *cur);
 #endif // __GRAPHICS_H
 
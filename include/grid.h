@@ -0,0 +1,24 @@
+#ifndef __GRID_H
+#define __GRID_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <X11/Xlib.h>
+
+#include "typedef.h"
+#include "cubes.h"
+
+#define GRID_MARGIN 10 // px around the grid
+
+I8 init_grid(Grid *grid, U16 count, const Options *options, U8 workers);
+I8 layout_grid(Grid *grid, U16 width, U16 height);
+void step_grid(Grid *grid);
+U16 render_grid(RenderBackend *rb, Grid *grid, bool full);
+void free_grid(Grid *grid);
+I8 run_grid(XWindow *xw, RenderBackend *rb, Grid *grid);
+
+#endif // __GRID_H
@@ -0,0 +1,13 @@
+#ifndef __HASH_H
+#define __HASH_H
+
+#include <stddef.h>
+
+#include "typedef.h"
+
+#define FNV1A_BASIS 2166136261u // hash of no bytes, the start of an incremental hash
+
+U32 fnv1a_update(U32 hash, const void *data, size_t length);
+U32 fnv1a(const void *data, size_t length);
+
+#endif // __HASH_H
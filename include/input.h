@@ -2,6 +2,7 @@
 #define __INPUT_H
 
 #include <stdio.h>
+#include <string.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/keysym.h>
@@ -9,7 +10,12 @@
 #include "typedef.h"
 #include "cubes.h"
 
-bool recv_events(Display *display, XIC xic, char *keyBuf, U32 mousePos[2]);
+void init_input(InputState *input, U32 dasMs, U32 arrMs);
+KeyAction get_repeat_shifts(InputState *input, U8 *shifts);
+bool push_input(InputQueue *queue, const InputEvent *event);
+bool pop_input(InputQueue *queue, InputEvent *event);
+bool update_held(InputState *input, const InputEvent *event);
+bool recv_events(Display *display, InputQueue *queue, U32 mousePos[2]);
 
 #endif // __INPUT_H
 
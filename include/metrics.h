@@ -0,0 +1,23 @@
+#ifndef __METRICS_H
+#define __METRICS_H
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+
+#include "typedef.h"
+#include "cubes.h"
+#include "writer.h"
+
+#define METRICS_INTERVAL_TICKS (15 * TICK_RATE) // ticks between two exports of the textfile
+#define METRICS_BUFFER_SIZE 4096
+
+void init_metrics(Metrics *metrics, const char *path);
+void count_frame(Metrics *metrics, I64 due, long budgetNs);
+U32 format_metrics(const Metrics *metrics, char *buffer, U32 capacity);
+void export_metrics(const Metrics *metrics);
+void begin_startup(Metrics *metrics, const struct timespec *begin, bool trace);
+void mark_startup(Metrics *metrics, StartupPhase phase);
+
+#endif // __METRICS_H
@@ -0,0 +1,15 @@
+#ifndef __MOVEGEN_H
+#define __MOVEGEN_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "typedef.h"
+#include "game.h"
+
+#define MOVEGEN_WALLS 0xe007 // bits of a move generator row outside the board (cell x is bit x + 3)
+
+U16 generate_moves(const GameBoard *board, U8 type, MoveList *list);
+
+#endif // __MOVEGEN_H
@@ -0,0 +1,16 @@
+#ifndef __OPTIONS_H
+#define __OPTIONS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "typedef.h"
+#include "score.h"
+#include "snapshot.h"
+
+#define DEFAULT_DAS_MS 167 // 10 frames at 60 FPS
+#define DEFAULT_ARR_MS 33  // 2 frames at 60 FPS
+
+I8 parse_options(Options *options, int argc, char **argv);
+
+#endif // __OPTIONS_H
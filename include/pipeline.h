@@ -0,0 +1,26 @@
+#ifndef __PIPELINE_H
+#define __PIPELINE_H
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <pthread.h>
+#include <X11/Xlib.h>
+
+#include "typedef.h"
+#include "cubes.h"
+
+#define TICK_RATE 60 // simulation ticks per second
+#define TICK_NS (1000000000L / TICK_RATE)
+#define MAX_CATCH_UP_TICKS 5 // ticks the simulation may run behind before it skips ahead
+
+void init_triple_buffer(TripleBuffer *buffer, const Frame *initial);
+Frame *back_frame(TripleBuffer *buffer);
+void publish_frame(TripleBuffer *buffer);
+const Frame *latest_frame(TripleBuffer *buffer, bool *fresh);
+void wait_next_tick(struct timespec *deadline, long periodNs);
+void interpolate_frame(const Frame *from, const Frame *to, I64 elapsed, Frame *out);
+I8 run_threaded(XWindow *xw, RenderBackend *rb, Game *game, ScreenCache *screens, StreamServer *stream, ShmInterface *shm, U32 frameRate);
+
+#endif // __PIPELINE_H
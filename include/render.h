@@ -0,0 +1,26 @@
+#ifndef __RENDER_H
+#define __RENDER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/Xft/Xft.h>
+
+#include "typedef.h"
+#include "graphics.h" // for the color scheme
+#include "hash.h"
+
+// Xlib/Xft backend drawing into the game window
+void init_x11_backend(RenderBackend *backend, X11Backend *x11, XWindow *xw, XftFont *fontText, XftFont *fontHeadlines);
+void free_x11_backend(X11Backend *x11);
+
+// In-memory backend for rendering tests and benchmarks, no display required
+I8 init_headless_backend(RenderBackend *backend, HeadlessBackend *headless, U16 width, U16 height);
+void free_headless_backend(HeadlessBackend *headless);
+U32 checksum_surface(const HeadlessBackend *headless, Surface surface);
+I8 write_ppm(const HeadlessBackend *headless, Surface surface, const char *path);
+I64 compare_ppm(const HeadlessBackend *headless, Surface surface, const char *path);
+
+#endif // __RENDER_H
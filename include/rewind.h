@@ -0,0 +1,14 @@
+#ifndef __REWIND_H
+#define __REWIND_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "typedef.h"
+#include "cubes.h"
+
+void record_placement(Game *game);
+I8 rewind_placement(Game *game);
+
+#endif // __REWIND_H
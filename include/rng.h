@@ -0,0 +1,18 @@
+#ifndef __RNG_H
+#define __RNG_H
+
+#include <stdio.h>
+#include <string.h>
+
+#include "typedef.h"
+#include "bbs.h"
+
+#define RNG_GAMMA 0x9e3779b97f4a7c15ULL // SplitMix64 increment (golden ratio)
+
+void init_rng(Rng *rng, RngMode mode, U64 seed);
+U32 rng_next(Rng *rng);
+U32 rng_below(Rng *rng, U32 bound);
+void rng_jump(Rng *rng, U64 steps);
+void rng_stream(const Rng *rng, U64 id, Rng *stream);
+
+#endif // __RNG_H
@@ -0,0 +1,25 @@
+#ifndef __SCORE_H
+#define __SCORE_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "typedef.h"
+#include "hash.h"
+#include "writer.h"
+
+#define SCORES_FILE_NAME ".cubes_scores" // default location is $HOME/.cubes_scores
+
+void load_scores(Leaderboard *leaderboard, const char *path);
+U64 best_score(const Leaderboard *leaderboard);
+I8 save_score(Leaderboard *leaderboard, U64 score, U32 level);
+void free_scores(Leaderboard *leaderboard);
+
+#endif // __SCORE_H
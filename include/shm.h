@@ -0,0 +1,24 @@
+#ifndef __SHM_H
+#define __SHM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "typedef.h"
+#include "cubes.h"
+
+I8 init_shm_interface(ShmInterface *shm, const char *name);
+void publish_shm_state(ShmInterface *shm, const Game *game);
+U32 pump_shm_inputs(ShmInterface *shm, InputQueue *queue);
+void free_shm_interface(ShmInterface *shm);
+void read_shm_state(const ShmRegion *region, ShmState *state);
+bool send_shm_input(ShmRegion *region, KeyAction action, bool pressed);
+
+#endif // __SHM_H
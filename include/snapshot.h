@@ -0,0 +1,22 @@
+#ifndef __SNAPSHOT_H
+#define __SNAPSHOT_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "typedef.h"
+#include "cubes.h"
+#include "hash.h"
+#include "writer.h"
+
+#define SNAPSHOT_FILE_NAME ".cubes_snapshot" // default location is $HOME/.cubes_snapshot
+#define SNAPSHOT_INTERVAL_TICKS (5 * TICK_RATE) // ticks between two saves of a running game
+
+void save_game(const Game *game);
+I8 resume_game(Game *game, const char *path);
+
+#endif // __SNAPSHOT_H
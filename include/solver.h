@@ -0,0 +1,20 @@
+#ifndef __SOLVER_H
+#define __SOLVER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "typedef.h"
+#include "game.h"
+#include "clock.h"
+
+#define SOLVER_MEMO_BITS 16 // default size of the memo table (2^n entries)
+#define SOLVER_ROW_MASK 0x3ffULL // the cells of one row in a solver board
+
+I8 init_solver(PcSolver *solver, U8 memoBits);
+SolveResult solve_perfect_clear(PcSolver *solver, const GameBoard *board, const U8 *pieces, U8 count, U32 budgetUs);
+void free_solver(PcSolver *solver);
+
+#endif // __SOLVER_H
@@ -0,0 +1,32 @@
+#ifndef __STREAM_H
+#define __STREAM_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "typedef.h"
+#include "cubes.h"
+
+#define STREAM_KEYFRAME_INTERVAL 120 // published frames between two keyframes for all viewers
+#define STREAM_STATS_INTERVAL_S 10 // seconds between two reports of the server
+
+void pack_frame(const Frame *frame, U8 packed[STREAM_FRAME_SIZE]);
+void unpack_frame(const U8 packed[STREAM_FRAME_SIZE], Frame *frame);
+U16 encode_delta(const U8 *previous, const U8 *current, U8 *out, U16 capacity);
+I8 decode_delta(const U8 *delta, U16 length, U8 *frame);
+I8 init_stream_server(StreamServer *server, const char *path);
+void stream_frame(StreamServer *server, const Frame *frame);
+void free_stream_server(StreamServer *server);
+I8 run_viewer(XWindow *xw, RenderBackend *rb, ScreenCache *screens, const char *path);
+
+#endif // __STREAM_H
@@ -1,7 +1,9 @@
 #ifndef __TYPEDEF_H
 #define __TYPEDEF_H
 #include <stdint.h>
+#include <pthread.h>
 #include <X11/Xlib.h>
+#include <X11/Xft/Xft.h>
 
 #define BLOCKSIZE 25
 
@@ -24,18 +26,33 @@ typedef _Bool bool;
 
 // demensions of everything
 
-#define WINDOW_WIDTH 750
-#define WINDOW_HEIGHT 800
+#define WINDOW_BASE_WIDTH 750 // at view scale 1
+#define WINDOW_BASE_HEIGHT 800
+#define BOARD_BASE_TOP 100
+
+extern U16 viewScale; ///< Window pixels per pixel of the game, see `set_view_scale`
+#define VIEW_SCALE_MAX 4
+
+#define CELL_SIZE (BLOCKSIZE * viewScale) // distance between two cells in the window
+#define WINDOW_WIDTH (WINDOW_BASE_WIDTH * viewScale)
+#define WINDOW_HEIGHT (WINDOW_BASE_HEIGHT * viewScale)
 
 #define BOARD_WIDTH 10
 #define BOARD_HEIGHT 24
-#define BOARD_WIDTH_PX BOARD_WIDTH * BLOCKSIZE // 250px
-#define BOARD_HEIGHT_PX BOARD_HEIGHT * BLOCKSIZE // 550px
-#define BOARD_OFFSET_LEFT_B ((WINDOW_WIDTH / 2)/BLOCKSIZE) - (BOARD_WIDTH/2)
-#define BOARD_OFFSET_LEFT (WINDOW_WIDTH / 2) - (BOARD_WIDTH_PX / 2)
-#define BOARD_OFFSET_RIGHT (WINDOW_WIDTH / 2) + (BOARD_WIDTH_PX / 2)
-#define BOARD_OFFSET_BOTTOM WINDOW_HEIGHT - ((WINDOW_HEIGHT) - BOARD_HEIGHT_PX)
-#define BOARD_OFFSET_TOP 100
+#define BOARD_WIDTH_PX (BOARD_WIDTH * CELL_SIZE) // 250px at scale 1
+#define BOARD_HEIGHT_PX (BOARD_HEIGHT * CELL_SIZE) // 600px at scale 1
+#define BOARD_OFFSET_LEFT_B (((WINDOW_WIDTH / 2) / CELL_SIZE) - (BOARD_WIDTH / 2))
+#define BOARD_OFFSET_LEFT ((WINDOW_WIDTH / 2) - (BOARD_WIDTH_PX / 2))
+#define BOARD_OFFSET_RIGHT ((WINDOW_WIDTH / 2) + (BOARD_WIDTH_PX / 2))
+#define BOARD_OFFSET_BOTTOM (WINDOW_HEIGHT - ((WINDOW_HEIGHT) - BOARD_HEIGHT_PX))
+#define BOARD_OFFSET_TOP (BOARD_BASE_TOP * viewScale)
+
+// color plane of the board: 3 bits per cell, one U32 per row
+#define CELL_COLOR_BITS 3
+#define CELL_COLOR_MASK 0x7
+#define CELL_COLORS 8 // 0: a block without a known piece (gray), otherwise the tetromino type + 1
+#define CELL_COLOR_ROW_MASK ((1U << (BOARD_WIDTH * CELL_COLOR_BITS)) - 1)
+#define CELL_COLOR(board, x, y) (((board)->colors[y] >> ((x) * CELL_COLOR_BITS)) & CELL_COLOR_MASK)
 
 // Enum for game state
 typedef enum {
@@ -51,7 +68,8 @@ typedef enum {
  * 
  */
 typedef struct {
-	U8 **state;		///< The game board 2d array state[x][y] where the cubes are placed (0: no cube 1: cube)
+	U8 state[BOARD_WIDTH][BOARD_HEIGHT];	///< The game board 2d array state[x][y] where the cubes are placed (0: no cube 1: cube)
+	U32 colors[BOARD_HEIGHT];	///< Color of every cube, see `CELL_COLOR` (0 for empty cells)
 	U32 level;		///< The current level the user is at
 	U64 score;		///< The current score for the round
 	U64 highscore;	///< The highest score in all rounds (in one execution [currently])
@@ -64,11 +82,16 @@ typedef struct {
 typedef struct {
 	U8 rotationState;	///< The current Rotation out of the 4 possible 90° rotations
 	U16 rotations[4];	///< All possible rotations (precomputed)
-	U16 X;				///< The X position on the window (in px)
-	U16 Y;				///< The Y position on the window (in px)
+	I8 col;				///< Board column of the left edge of the 4x4 shape
+	I8 row;				///< Board row of the top edge of the 4x4 shape
+	U8 fraction;		///< Sub-cell progress towards the next row (in px, `< BLOCKSIZE`), only for smooth falling
 	U32 color;			///< The color of this tetromino as RGB val
+	U8 type;			///< Index of the shape in `tetrominos`
 } Tetromino;
 
+#define TETROMINO_TYPES 7
+#define PIECE_QUEUE_LENGTH 3 // upcoming tetrominos decided in advance
+
 /* movement */
 
 typedef enum {
@@ -78,9 +101,476 @@ typedef enum {
 	KEY_UP,
 	KEY_DOWN,
 	KEY_LEFT,
-	KEY_RIGHT
+	KEY_RIGHT,
+	KEY_PAUSE,
+	KEY_REWIND,		///< Take back the last placement
+	KEY_ANY,		///< Every other key or mouse button ("press any key")
+	KEY_COUNT
 } KeyAction;
 
+#define INPUT_QUEUE_SIZE 64 // has to be a power of two
+
+/**
+ * @brief A single key press or release translated from an X event.
+ */
+typedef struct {
+	KeyAction action;	///< What the key does in the game
+	bool pressed;		///< `true` for KeyPress, `false` for KeyRelease
+	Time time;			///< X server timestamp of the event (in ms)
+} InputEvent;
+
+/**
+ * @brief Fixed capacity ring buffer of input events, filled by `recv_events` and drained by the simulation.
+ */
+typedef struct {
+	InputEvent events[INPUT_QUEUE_SIZE];
+	U32 head;		///< Next event to read (only written by the consumer)
+	U32 tail;		///< Next free slot (only written by the producer)
+	U32 dropped;	///< Events lost because the queue was full
+} InputQueue;
+
+/**
+ * @brief Held keys for the delayed auto shift (DAS) and the auto repeat rate (ARR).
+ *
+ * Filled from `KeyPress`/`KeyRelease` by `recv_events` and evaluated on the simulation tick,
+ * so lateral movement does not depend on the autorepeat settings of the desktop.
+ */
+typedef struct {
+	bool held[KEY_COUNT];		///< Whether the key is currently pressed
+	I64 pressedNs[KEY_COUNT];	///< Monotonic time the key went down (in ns)
+	U32 repeats[KEY_COUNT];		///< Number of auto repeated moves already applied since the press
+	U32 dasMs;					///< Delay before a held key starts to repeat (in ms)
+	U32 arrMs;					///< Interval between repeated moves (in ms, 0: move to the wall instantly)
+} InputState;
+
+/* Random numbers */
+
+typedef enum {
+	RNG_COUNTER = 0,	///< SplitMix64 over a counter: O(1) jump ahead and independent streams
+	RNG_BBS				///< Blum Blum Shub, sequential
+} RngMode;
+
+/**
+ * @brief State of a random generator, every game owns its own.
+ */
+typedef struct {
+	RngMode mode;
+	U64 seed;		///< The seed the generator (and all streams derived from it) started from
+	U64 id;			///< Number of the stream (see `rng_stream`)
+	U64 key;		///< Counter mode: selects the stream
+	U64 counter;	///< Counter mode: number of values taken
+	U32 state;		///< BBS mode: the current value
+} Rng;
+
+/**
+ * @brief Settings given on the command line.
+ */
+typedef struct {
+	U32 dasMs;		///< Delayed auto shift in ms
+	U32 arrMs;		///< Auto repeat rate in ms
+	bool threaded;			///< Run X I/O, simulation and rendering on their own threads
+	const char *scoresPath;	///< Leaderboard file (`NULL`: default location)
+	const char *servePath;	///< Publish the game to spectators on this socket (`NULL`: off)
+	const char *viewPath;	///< Watch the game published on this socket instead of playing
+	const char *metricsPath;	///< Prometheus textfile the gameplay metrics are written to (`NULL`: off)
+	bool xStats;			///< Show the X traffic per frame and print a summary on exit
+	bool traceStartup;		///< Print how long each phase of the startup took
+	const char *snapshotPath;	///< Where a running game is saved and resumed from (`NULL`: default location)
+	U32 seed;				///< Seed of the piece sequence (0: random)
+	RngMode rngMode;		///< Generator of the piece sequence
+	const char *shmName;	///< Publish the game and take inputs in this shared memory object (`NULL`: off)
+	U32 gridBoards;			///< Show this many bot games in a grid instead of playing (0: off)
+	U32 frameRate;			///< Frames drawn per second, independent of the simulation (0: unlimited)
+	U32 scale;				///< Window pixels per pixel of the game (1 to `VIEW_SCALE_MAX`)
+} Options;
+
+/* Persistent leaderboard */
+
+#define LEADERBOARD_MAGIC 0x53425543 // "CUBS"
+#define LEADERBOARD_VERSION 1
+#define LEADERBOARD_SIZE 10
+
+/**
+ * @brief One finished game in the leaderboard file.
+ */
+typedef struct {
+	U64 score;		///< Final score of the game
+	I64 time;		///< When the game ended (unix time)
+	U32 level;		///< Level reached
+	U32 checksum;	///< FNV-1a of the fields above, records with a wrong checksum are ignored
+} ScoreRecord;
+
+/**
+ * @brief Fixed layout of the leaderboard file, it is used directly from the memory mapping.
+ */
+typedef struct {
+	U32 magic;			///< `LEADERBOARD_MAGIC`
+	U16 version;		///< `LEADERBOARD_VERSION`
+	U16 capacity;		///< `LEADERBOARD_SIZE`
+	U32 count;			///< Number of used records (sorted by score, best first)
+	U32 reserved;
+	U64 generation;		///< Incremented with every update
+	ScoreRecord records[LEADERBOARD_SIZE];
+} LeaderboardFile;
+
+/**
+ * @brief The top-N leaderboard of all rounds.
+ */
+typedef struct {
+	const LeaderboardFile *view;	///< Current content (the mapping until the first update, then `image`)
+	void *mapping;					///< The file mapped at startup (`NULL` if there was no valid file)
+	LeaderboardFile image;			///< Updated content, handed to the writer thread
+	char path[256];					///< Location of the leaderboard file (empty: not persisted)
+} Leaderboard;
+
+/* Background writer */
+
+/**
+ * @brief Files written in the background, a newer submission for a slot replaces a pending one.
+ */
+typedef enum {
+	WRITE_SLOT_SCORES = 0,
+	WRITE_SLOT_METRICS,
+	WRITE_SLOT_FONTS,
+	WRITE_SLOT_SNAPSHOT,
+	WRITE_SLOT_COUNT
+} WriteSlot;
+
+/* Gameplay metrics */
+
+#define METRICS_LINE_SIZES 4	///< A Tetromino clears at most 4 rows at once
+
+typedef enum {
+	STARTUP_SESSION = 0,	///< Options, leaderboard and game session ready
+	STARTUP_DISPLAY,		///< Connected to the X server
+	STARTUP_WINDOW,			///< Window created and mapped
+	STARTUP_FONTS,			///< Fonts resolved (in the background meanwhile) and opened
+	STARTUP_FIRST_FRAME,	///< First frame drawn into the mapped window and flushed
+	STARTUP_PHASE_COUNT
+} StartupPhase;
+
+/**
+ * @brief Throughput counters of a session, exported in the Prometheus textfile format.
+ *
+ * Only the simulation writes them, except for the frame counters, which the render
+ * thread increments atomically when the pipeline is threaded.
+ */
+typedef struct {
+	U64 piecesPlaced;
+	U64 linesCleared[METRICS_LINE_SIZES];	///< Indexed by the number of rows cleared at once - 1
+	U64 inputs;				///< Key presses applied to a falling Tetromino
+	U64 gamesStarted;
+	U64 framesRendered;
+	U64 framesOverBudget;	///< Frames finished later than one frame period after they started
+	U64 gameTicks;			///< Ticks the current (or last) game is running, pauses excluded
+	U64 gamePieces;			///< Pieces placed in the current (or last) game
+	U64 gameInputs;			///< Inputs applied in the current (or last) game
+	U64 rewinds;			///< Placements taken back with the rewind key
+	U64 rewindEntries;		///< Placements that can currently be taken back
+	U64 rewindBytes;		///< Memory of the rewind buffer (fixed)
+	I64 startupBegin;		///< When the process started its initialization (monotonic clock, in ns)
+	I64 startup[STARTUP_PHASE_COUNT];	///< ns from `startupBegin` until each phase was done (0: not yet)
+	bool traceStartup;		///< Print the startup phases once the first frame is drawn
+	const char *path;		///< Textfile the metrics are exported to (`NULL`: not exported)
+} Metrics;
+
+/**
+ * @brief The last lock of a Tetromino, noted before its full rows were removed.
+ */
+typedef struct {
+	U32 count;				///< Locks so far, changes with every lock
+	U32 clearedColors[4];	///< Color plane rows of the removed rows
+	U8 clearedRows[4];		///< Board rows that were removed, from the top down
+	U8 rowsCleared;			///< `0` as well if the lock ended the game
+	U8 type;				///< The placed Tetromino
+	U8 rotationState;
+	I8 col;
+	I8 row;
+	bool gameOver;			///< A block reached row 2, the lock ended the game (see `remove_full_row`)
+} LockEvent;
+
+#define REWIND_LENGTH 256 ///< Placements that can be taken back
+
+/**
+ * @brief What a placement changed, enough to take it back.
+ *
+ * Only the piece and the removed rows are stored, not the board: full rows need no
+ * occupancy bits, their color plane row is all there is to them.
+ */
+typedef struct {
+	U64 score;				///< Score and level before the placement
+	U64 rngCounter;			///< The random generator before the next piece was drawn
+	U32 rngState;
+	U32 level;
+	LockEvent lock;			///< The placed Tetromino and the rows it removed
+} RewindEntry;
+
+/**
+ * @brief Fixed size ring of the last placements of a game, the oldest one is overwritten.
+ */
+typedef struct {
+	RewindEntry entries[REWIND_LENGTH];
+	U16 head;		///< Slot of the next placement
+	U16 count;		///< Placements that can be taken back
+} RewindRing;
+
+/**
+ * @brief Everything the simulation of one running game session needs.
+ */
+typedef struct {
+	GameState state;		///< Current screen / game state
+	GameBoard board;		///< Placed blocks, score and level
+	Tetromino *current;		///< The falling Tetromino (`NULL` until the next one spawns)
+	InputState input;		///< Held keys for DAS/ARR
+	Leaderboard *leaderboard;	///< Where finished games are recorded (may be `NULL`)
+	U32 boardVersion;		///< Incremented whenever the placed blocks changed
+	U64 tick;				///< Number of simulation ticks so far
+	U8 next[PIECE_QUEUE_LENGTH];	///< Types of the next tetrominos, `next[0]` spawns first
+	Rng rng;				///< Draws the piece sequence
+	char snapshotPath[256];	///< Where the running game is saved (empty: not saved)
+	Metrics metrics;		///< Gameplay counters (see `export_metrics`)
+	RewindRing rewind;		///< The last placements, taken back with the rewind key
+	LockEvent lastLock;		///< The last Tetromino placed
+} Game;
+
+/* Saved game */
+
+#define SNAPSHOT_MAGIC 0x56415343 // "CSAV"
+#define SNAPSHOT_VERSION 3
+#define SNAPSHOT_BOARD_BYTES ((BOARD_WIDTH * BOARD_HEIGHT + 7) / 8)
+
+/**
+ * @brief Fixed layout of the snapshot file of a running game.
+ */
+typedef struct {
+	U32 magic;			///< `SNAPSHOT_MAGIC`
+	U16 version;		///< `SNAPSHOT_VERSION`
+	U8 state;			///< GameState, only `STATE_GAME` and `STATE_PAUSE` are resumed
+	U8 hasPiece;
+	U64 score;
+	U32 level;
+	U32 colors[BOARD_HEIGHT];	///< The color plane of the board
+	U32 rngState;		///< The random generator (see Rng)
+	U64 rngSeed;
+	U64 rngId;
+	U64 rngKey;
+	U64 rngCounter;
+	U8 rngMode;
+	U8 board[SNAPSHOT_BOARD_BYTES];	///< One bit per cell, column by column
+	U8 next[PIECE_QUEUE_LENGTH];
+	U8 type;			///< The falling Tetromino (if `hasPiece`)
+	U8 rotationState;
+	I8 col;
+	I8 row;
+	U8 fraction;
+	U32 checksum;		///< FNV-1a of everything in front of it
+} SnapshotFile;
+
+/**
+ * @brief Immutable snapshot of a Game, everything needed to draw one frame.
+ */
+typedef struct {
+	GameState state;
+	GameBoard board;
+	Tetromino piece;		///< Copy of the falling Tetromino (valid if `hasPiece`)
+	bool hasPiece;
+	U32 boardVersion;		///< Changes whenever the board has to be redrawn completely
+	U64 tick;				///< Simulation tick the snapshot was taken at
+	I64 time;				///< When the tick was due (monotonic, in ns), places the interpolated Tetromino
+	LockEvent lastLock;		///< The last Tetromino placed, starts the animations
+} Frame;
+
+#define FRAME_FRESH 0x4 // set in `TripleBuffer.middle` while the reader has not taken the frame yet
+
+/**
+ * @brief Lock-free triple buffer passing frame snapshots from the simulation to the renderer.
+ *
+ * The writer always owns `back`, the reader always owns `front`, both swap their frame with
+ * `middle` atomically, so neither side ever waits for the other.
+ */
+typedef struct {
+	Frame frames[3];
+	U32 middle;		///< Index of the last published frame (| `FRAME_FRESH`), shared
+	U32 back;		///< Index of the frame the writer fills
+	U32 front;		///< Index of the frame the reader draws
+} TripleBuffer;
+
+/* Perfect clear solver */
+
+#define SOLVER_MAX_HEIGHT 6		///< Rows the solver works on, 6 rows of 10 cells fit into a U64
+#define SOLVER_MAX_PIECES 15	///< Longest piece sequence (the depth is kept in 4 bits of the memo key)
+
+typedef enum {
+	SOLVE_FOUND = 0,	///< The placements in `path` clear the board
+	SOLVE_NONE,			///< No perfect clear with the given pieces
+	SOLVE_TIMEOUT,		///< The time budget ran out
+	SOLVE_TOO_HIGH		///< The stack is higher than `SOLVER_MAX_HEIGHT`
+} SolveResult;
+
+/**
+ * @brief Where a Tetromino is placed, in the coordinates of the Tetromino struct.
+ */
+typedef struct {
+	U8 type;
+	U8 rotationState;
+	I8 col;
+	I8 row;		///< Row of the top edge of the 4x4 shape on the board at the time it is placed
+} Placement;
+
+/**
+ * @brief One entry of the memo table, a board that is known to fail from a depth on.
+ */
+typedef struct {
+	U64 key;			///< Board (60 bits) and depth (4 bits)
+	U32 generation;		///< Search the entry belongs to, older ones count as empty
+} SolverMemo;
+
+/**
+ * @brief State of the perfect clear search, reusable for many solves.
+ */
+typedef struct {
+	SolverMemo *memo;		///< Direct mapped table of failed states
+	U32 memoMask;			///< Number of entries - 1
+	U32 generation;
+	const U8 *pieces;		///< The piece sequence of the current solve
+	U8 pieceCount;			///< Pieces a perfect clear at the current height takes
+	I64 deadline;			///< Monotonic time the search gives up (ns)
+	bool timedOut;
+	U64 nodes;				///< Searched states (of all solves)
+	Placement path[SOLVER_MAX_PIECES];	///< The solution
+	U8 length;				///< Placements in `path`
+} PcSolver;
+
+/* Move generator */
+
+#define MOVEGEN_COLS (BOARD_WIDTH + 3)	///< Columns of the 4x4 shape, the left edge may be up to 3 cells outside the board
+#define MOVEGEN_STATES (4 * BOARD_HEIGHT * MOVEGEN_COLS)	///< (col, row, rotation) states of a piece
+#define MOVEGEN_MAX_MOVES 256			///< Distinct lock positions kept per piece
+#define MOVEGEN_MAX_INPUTS 64			///< Longest input sequence of a move
+
+/**
+ * @brief A lock position and the shortest inputs that get the piece there.
+ *
+ * The inputs are `KeyAction` values: `KEY_LEFT`, `KEY_RIGHT`, `KEY_UP` (clockwise), `KEY_CTRL`
+ * (counter clockwise), `KEY_DOWN` for one row of soft drop and a final `KEY_SPACE` that locks.
+ */
+typedef struct {
+	Placement placement;
+	U8 length;							///< Inputs in `inputs`
+	U8 inputs[MOVEGEN_MAX_INPUTS];
+} Move;
+
+/**
+ * @brief Every placement of a piece that is reachable from its spawn position.
+ */
+typedef struct {
+	Move moves[MOVEGEN_MAX_MOVES];
+	U16 count;
+	U16 states;		///< Piece states the search visited
+} MoveList;
+
+/* Spectator stream */
+
+#define STREAM_FRAME_SIZE (81 + 4 * BOARD_HEIGHT)	///< Bytes of a packed frame (see `pack_frame`)
+#define STREAM_HEADER_SIZE 12		///< type, reserved, payload length, sequence
+#define STREAM_MESSAGE_SIZE (STREAM_HEADER_SIZE + 2 * STREAM_FRAME_SIZE)	///< Upper bound of a message
+#define STREAM_MAX_VIEWERS 512
+
+typedef enum {
+	STREAM_KEYFRAME = 1,	///< Payload is the packed frame
+	STREAM_DELTA			///< Payload is the run length coded XOR against the previous frame
+} StreamMessageType;
+
+/**
+ * @brief Publishes the frames of a game to spectators over a Unix domain socket.
+ */
+typedef struct {
+	int listenFd;
+	int epollFd;							///< Watches the listening socket and all viewers
+	int viewers[STREAM_MAX_VIEWERS];		///< Connected viewer sockets
+	bool needsKeyframe[STREAM_MAX_VIEWERS];	///< Joined or missed a message, gets a keyframe next
+	U32 viewerCount;
+	U8 previous[STREAM_FRAME_SIZE];			///< The packed frame the deltas are computed against
+	U64 sequence;							///< Number of the last published frame
+	U64 lastKeyframe;						///< Sequence of the last periodic keyframe
+	U64 framesEncoded;						///< Statistics since `statsSince`
+	I64 encodeNs;
+	U64 bytesSent;
+	I64 statsSince;
+	char path[108];							///< Socket path, removed again on shutdown
+} StreamServer;
+
+/* Shared memory interface for bots */
+
+#define SHM_MAGIC 0x4d485343	///< "CSHM" in little endian
+#define SHM_VERSION 1
+#define SHM_INPUT_SIZE 256		///< Actions in the input ring, has to be a power of two
+#define SHM_NAME_LENGTH 64
+
+/**
+ * @brief The game as external tools see it, all fields have a fixed size.
+ */
+typedef struct {
+	U64 tick;					///< Simulation tick the state was published at
+	U64 score;
+	U64 highscore;
+	U32 level;
+	U32 boardVersion;			///< Changes whenever the placed blocks changed
+	U32 colors[BOARD_HEIGHT];	///< Colors of the placed blocks (see `CELL_COLOR`)
+	U8 cells[BOARD_HEIGHT][BOARD_WIDTH];	///< `1` for a placed block, row by row from the top
+	U8 next[PIECE_QUEUE_LENGTH];	///< The next Tetromino types, `next[0]` spawns first
+	U8 state;					///< GameState
+	U8 hasPiece;
+	U8 type;					///< The falling Tetromino (valid if `hasPiece`)
+	U8 rotationState;
+	I8 col;						///< Column of the 4x4 shape
+	I8 row;
+	U8 fraction;				///< Pixels the Tetromino fell below `row`
+	U8 reserved[6];
+} ShmState;
+
+/**
+ * @brief A key press or release written by a tool.
+ */
+typedef struct {
+	U8 action;		///< KeyAction
+	U8 pressed;		///< `1` for a press, `0` for a release
+} ShmInput;
+
+/**
+ * @brief Layout of the shared memory object (`--shm`).
+ *
+ * `state` is written by the game under a seqlock: `sequence` is odd while a write is in progress,
+ * a reader copies the state and retries if `sequence` was odd or changed meanwhile. The inputs
+ * are a single producer single consumer ring, the tool writes `inputTail`, the game `inputHead`.
+ * The fields each side writes lie on their own cache lines.
+ */
+typedef struct {
+	U32 magic;				///< `SHM_MAGIC`
+	U32 version;			///< `SHM_VERSION`
+	U32 size;				///< Size of the whole region in bytes
+	U32 pid;				///< Process of the game
+	U32 sequence;			///< Seqlock of `state`
+	U32 reserved[11];
+	ShmState state;
+	U32 inputHead;			///< Next action the game takes
+	U32 reservedHead[15];
+	U32 inputTail;			///< Next free slot of the ring
+	U32 inputDropped;		///< Actions the tool could not write, the ring was full
+	U32 reservedTail[14];
+	ShmInput inputs[SHM_INPUT_SIZE];
+} ShmRegion;
+
+/**
+ * @brief The game's side of the shared memory interface.
+ */
+typedef struct {
+	ShmRegion *region;		///< Mapped shared memory (`NULL`: off)
+	char name[SHM_NAME_LENGTH];	///< Name of the object, removed again on shutdown
+	U64 device;				///< Identity of the object (`st_dev`, `st_ino`), only this object is removed
+	U64 inode;
+} ShmInterface;
+
 /* XServer related structs */
 /**
  * @brief Struct representing an X11 window and its associated graphical context.
@@ -94,5 +584,260 @@ typedef struct {
 	U32 screenNumber;
 } XWindow;
 
+/* Rendering */
+
+typedef unsigned long Surface; ///< Drawing target of a RenderBackend (the window or an offscreen surface)
+#define SURFACE_WINDOW 0
+
+typedef enum {
+	FONT_TEXT = 0,	///< Normal display text
+	FONT_HEADLINE,	///< Headlines of the screens
+	FONT_COUNT
+} FontId;
+
+/**
+ * @brief The drawing primitives the game is rendered with.
+ *
+ * Implemented on top of Xlib/Xft (`init_x11_backend`) and in memory without any display
+ * (`init_headless_backend`) for rendering tests and benchmarks. Colors are 0xRRGGBB.
+ */
+typedef struct {
+	void *ctx;	///< State of the implementation
+	Surface (*create_surface)(void *ctx, U16 width, U16 height);
+	void (*free_surface)(void *ctx, Surface surface);
+	void (*clear)(void *ctx, Surface target, I16 x, I16 y, U16 width, U16 height);	///< Fill with the background color
+	void (*fill_rects)(void *ctx, Surface target, U32 color, const XRectangle *rects, U16 count);
+	void (*blit)(void *ctx, Surface source, I16 sourceX, I16 sourceY, U16 width, U16 height, Surface target, I16 x, I16 y);
+	void (*fill_tiled)(void *ctx, Surface target, Surface source, const XRectangle *area, I16 originX, I16 originY, const XRectangle *rects, U16 count);	///< Fill with `area` of `source` repeated, one copy starting at the origin
+	void (*text)(void *ctx, Surface target, FontId font, I16 x, I16 y, const char *text, bool glow);	///< `y` is the top of the line
+	void (*text_extents)(void *ctx, FontId font, const char *text, XGlyphInfo *extents);
+	U16 (*line_height)(void *ctx, FontId font);
+	void (*set_clip)(void *ctx, Region clip);	///< Clip everything to a region, `NULL` to draw everywhere
+	void (*flush)(void *ctx);
+} RenderBackend;
+
+#define X11_TILE_CACHE 8 // one tile per cell color
+
+/**
+ * @brief A tile copied out of a surface, with the GC that fills with it.
+ */
+typedef struct {
+	Surface source;		///< The surface the tile was copied from (`SURFACE_WINDOW`: unused slot)
+	XRectangle area;	///< The area of `source` the tile was copied from
+	Pixmap pixmap;
+	GC gc;				///< `FillTiled` with `pixmap`
+	I16 originX;		///< Current tile-stipple origin of `gc`
+	I16 originY;
+	U32 clipVersion;	///< Clip of the backend `gc` was last set to
+} X11Tile;
+
+/**
+ * @brief State of the Xlib/Xft render backend.
+ */
+typedef struct {
+	XWindow *xw;
+	XftFont *fonts[FONT_COUNT];
+	XftDraw *draw;			///< Reused for all text, retargeted with XftDrawChange
+	Drawable drawTarget;	///< The drawable `draw` currently renders to
+	XftColor textColor;		///< Allocated once instead of for every string
+	XftColor glowColor;
+	U32 foreground;			///< Current foreground of the GC, avoids redundant XSetForeground requests
+	Region clip;			///< Current clip region (`NULL`: none)
+	U32 clipVersion;		///< Incremented with every clip change, the tile GCs follow it lazily
+	X11Tile tiles[X11_TILE_CACHE];
+	U8 nextTile;			///< Slot replaced when the cache is full
+} X11Backend;
+
+#define HEADLESS_MAX_SURFACES 8
+
+/**
+ * @brief State of the in-memory render backend.
+ */
+typedef struct {
+	U32 *pixels[HEADLESS_MAX_SURFACES];		///< 0xRRGGBB pixels of each surface, `NULL` if unused (0 is the window)
+	U16 width[HEADLESS_MAX_SURFACES];
+	U16 height[HEADLESS_MAX_SURFACES];
+	Region clip;							///< Current clip region (`NULL`: none)
+	U64 pixelsWritten;						///< Statistics for benchmarks
+} HeadlessBackend;
+
+/* X protocol accounting */
+
+/**
+ * @brief X protocol traffic of one frame or of a whole run.
+ */
+typedef struct {
+	U64 requests;		///< Requests sent (difference of `XNextRequest`)
+	U64 bytes;			///< Bytes of the requests written into the Xlib output buffer
+	U64 roundTrips;		///< Drawing calls that waited for a reply of the server
+	U64 flushes;		///< Flushes of a non-empty output buffer (explicit or by `XPending`)
+} XStats;
+
+/**
+ * @brief Counts the X traffic of the game, frame by frame.
+ *
+ * Wraps a RenderBackend (see `account_backend`) and observes the connection between the calls,
+ * so nothing else has to know about it. All updates happen with the display locked.
+ */
+typedef struct {
+	Display *display;		///< `NULL` while the accounting is off
+	RenderBackend inner;	///< The wrapped backend
+	unsigned long request;	///< `XNextRequest` at the last observation
+	size_t buffered;		///< Bytes in the output buffer at the last observation
+	XStats frame;			///< Traffic of the frame in progress
+	XStats last;			///< Traffic of the last complete frame
+	XStats shown;			///< What the overlay currently shows
+	XStats total;
+	XStats peak;			///< Highest value of every field in a single frame
+	U64 frames;
+	bool overlay;			///< Draw the traffic of the last frame into the window
+} XAccounting;
+
+/* Cached screens */
+
+typedef enum {
+	SCREEN_START = 0,
+	SCREEN_PAUSE,
+	SCREEN_GAME_OVER,
+	SCREEN_COUNT
+} ScreenId;
+
+/**
+ * @brief Static full-window screens and the block tiles, rendered once into surfaces and restored with copies.
+ */
+typedef struct {
+	Surface screens[SCREEN_COUNT];	///< One surface per screen (`SURFACE_WINDOW` until it was rendered the first time)
+	Surface atlas;					///< Block tiles of all `CELL_COLORS` side by side (`SURFACE_WINDOW`: flat blocks)
+	U16 atlasBlock;					///< Block size the atlas was rendered for, `0` until it was tried
+} ScreenCache;
+
+/**
+ * @brief Where a board is drawn in the window.
+ */
+typedef struct {
+	I16 left;		///< Window position of the left edge of column 0 (in px)
+	I16 top;		///< Window position of the top edge of row 0 (in px)
+	U16 cell;		///< Distance between two cells (in px), the blocks are one pixel smaller
+} BoardLayout;
+
+/* Animations */
+
+#define ANIM_MAX_EFFECTS 4
+#define ANIM_FLASH_FRAMES 12	///< The removed rows blink before they vanish
+#define ANIM_FLASH_PERIOD 3		///< Frames of one blink phase
+#define ANIM_COLLAPSE_FRAMES 8	///< The rows above fall into the gap
+#define ANIM_LOCK_FRAMES 8		///< A placed Tetromino fades from white to its color
+#define ANIM_FILL_FRAMES 36		///< The board fills up from the bottom before the game over screen
+
+typedef enum {
+	EFFECT_ROW_FLASH = 0,
+	EFFECT_COLLAPSE,
+	EFFECT_LOCK_FLASH,
+	EFFECT_GAME_OVER_FILL
+} EffectType;
+
+/**
+ * @brief A running effect, a state machine advanced by the simulation ticks of the drawn frames.
+ */
+typedef struct {
+	EffectType type;
+	U64 start;			///< Tick of its first step
+	U16 frame;			///< Steps drawn so far
+	U16 length;			///< Steps (one per tick)
+	LockEvent lock;		///< The lock that started it
+} Effect;
+
+/**
+ * @brief The effects of the renderer, started from the differences between two frames.
+ */
+typedef struct {
+	Effect effects[ANIM_MAX_EFFECTS];
+	U8 count;
+	U32 lockCount;		///< `lastLock.count` of the last drawn frame
+	U32 boardVersion;	///< `boardVersion` of the last drawn frame
+} Animations;
+
+/* Board evaluation */
+
+#define EVAL_BATCH 16	///< Boards evaluated at once, one per 16 bit lane of an AVX2 register
+
+/**
+ * @brief Candidate boards as row masks, stored by row so that row `y` of all boards is one vector.
+ */
+typedef struct {
+	U16 rows[BOARD_HEIGHT][EVAL_BATCH];	///< Bit `x` of `rows[y][i]` is the cell in column `x` and row `y` of board `i`
+	U8 count;							///< Boards in the batch, the other lanes are evaluated but not used
+} EvalBatch;
+
+/**
+ * @brief The features of every board of a batch, see `evaluate_batch`.
+ */
+typedef struct {
+	U16 height[EVAL_BATCH];			///< Sum of the column heights
+	U16 holes[EVAL_BATCH];			///< Empty cells below the top of their column
+	U16 bumpiness[EVAL_BATCH];		///< Sum of the height differences of neighbouring columns
+	U16 wells[EVAL_BATCH];			///< Empty cells open to the top between two filled cells (or a wall)
+	U16 rowTransitions[EVAL_BATCH];	///< Changes between filled and empty along the rows, the walls are filled
+} EvalFeatures;
+
+typedef enum {
+	EVAL_SCALAR = 0,
+	EVAL_SSE2,
+	EVAL_AVX2,
+	EVAL_KERNELS
+} EvalKernel;
+
+/* Bots and the grid view */
+
+#define BOT_INPUT_TICKS 3		///< Ticks between two inputs of a bot, so the moves can be followed
+#define BOT_RESTART_TICKS 120	///< Ticks a finished game stays on screen before the bot starts the next
+#define GRID_MAX_BOARDS 64
+#define GRID_MAX_WORKERS 16
+
+/**
+ * @brief A bot playing one game, it places every Tetromino where its evaluation is best.
+ */
+typedef struct {
+	InputQueue queue;		///< Inputs of the bot, read by `step_game` like the keys of a player
+	U8 inputs[MOVEGEN_MAX_INPUTS];	///< The move planned for the falling Tetromino
+	U8 length;
+	U8 next;				///< Next input of the move to send
+	U16 wait;				///< Ticks until the next input
+	bool planned;			///< The falling Tetromino has its move
+	GameState seen;			///< State of the game at the last tick
+} Bot;
+
+/**
+ * @brief Threads stepping the games of the grid, the caller of `step_grid` works along.
+ *
+ * Each tick the games are handed out one at a time from a shared counter, so a game whose bot
+ * is searching its moves does not hold up the others.
+ */
+typedef struct {
+	pthread_t threads[GRID_MAX_WORKERS];
+	U8 count;				///< Started threads
+	pthread_mutex_t lock;
+	pthread_cond_t start;	///< Signalled when a tick begins (or the pool stops)
+	pthread_cond_t done;	///< Signalled when the last game of the tick was stepped
+	U64 generation;			///< Number of the tick, the workers wait for it to change
+	U32 claimed;			///< Next game to step (taken atomically)
+	U32 pending;			///< Games of the tick not stepped yet
+	bool running;
+} WorkerPool;
+
+/**
+ * @brief Many bot games in one window, each board drawn with its own layout.
+ */
+typedef struct {
+	U16 count;				///< Games in the grid
+	Game *games;
+	Bot *bots;
+	Frame *frames;			///< Snapshot of every game after the last tick
+	Frame *drawn;			///< What the window shows of every game
+	BoardLayout layouts[GRID_MAX_BOARDS];
+	XRectangle *batches[CELL_COLORS];	///< Blocks of all boards collected by color while drawing
+	U32 batchCount[CELL_COLORS];
+	WorkerPool pool;
+} Grid;
 
 #endif // __TYPEDEF_H
@@ -5,13 +5,14 @@
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
 #include <X11/keysym.h>
+#include <X11/XKBlib.h>
 #include <X11/extensions/Xcomposite.h>
 #include "typedef.h"
 #include "game.h"
 
 extern Atom wm_delete_window;
 
-I8 init_main_window(Display *display, Window window, XIM *xim, XIC *xic);
+I8 init_main_window(Display *display, Window window);
 
 #endif // __WINDOW_H
 
@@ -0,0 +1,18 @@
+#ifndef __WRITER_H
+#define __WRITER_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <pthread.h>
+
+#include "typedef.h"
+
+I8 start_writer(void);
+void submit_write(WriteSlot slot, const char *path, const void *data, size_t length, bool durable);
+void stop_writer(void);
+
+#endif // __WRITER_H
@@ -0,0 +1,22 @@
+#ifndef __XSTATS_H
+#define __XSTATS_H
+
+#include <stdio.h>
+#include <string.h>
+#include <X11/Xlib.h>
+
+#include "typedef.h"
+#include "cubes.h"
+
+#define X_OVERLAY_X 10 // top left corner of the traffic overlay, left of the board
+#define X_OVERLAY_Y 10
+#define X_OVERLAY_WIDTH (BOARD_OFFSET_LEFT - 2 * X_OVERLAY_X)
+#define X_OVERLAY_LENGTH 64
+
+void account_backend(XAccounting *accounting, RenderBackend *rb, Display *display, bool overlay);
+void account_x_io(XAccounting *accounting);
+void sync_x_frame(XAccounting *accounting);
+void end_x_frame(XAccounting *accounting);
+void print_x_summary(const XAccounting *accounting);
+
+#endif // __XSTATS_H
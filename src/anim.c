@@ -0,0 +1,295 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include "anim.h"
+
+#define BOARD_INNER_TOP (BOARD_OFFSET_TOP + LINE_WIDTH / 2) // first pixel row below the border
+#define BOARD_INNER_BOTTOM (BOARD_OFFSET_TOP + (BOARD_HEIGHT_PX) - LINE_WIDTH / 2)
+
+/**
+ * @brief Starts without effects, the frame that is visible in the window is the baseline.
+ *
+ * @param anims The animations.
+ * @param initial The frame drawn first.
+ */
+void init_animations(Animations *anims, const Frame *initial) {
+	memset(anims, 0, sizeof(*anims));
+	anims->lockCount = initial->lastLock.count;
+	anims->boardVersion = initial->boardVersion;
+}
+
+/**
+ * @brief Appends an effect, the oldest one is dropped if there is no room.
+ */
+static void add_effect(Animations *anims, EffectType type, U64 start, U16 length, const LockEvent *lock) {
+	if(anims->count == ANIM_MAX_EFFECTS) {
+		memmove(anims->effects, anims->effects + 1, (ANIM_MAX_EFFECTS - 1) * sizeof(Effect));
+		anims->count--;
+	}
+	anims->effects[anims->count++] = (Effect){type, start, 0, length, *lock};
+}
+
+/**
+ * @brief Starts the effects of what happened between two frames.
+ *
+ * A lock with removed rows starts the row flash followed by the collapse, any other lock the
+ * lock flash. The end of the game starts the fill. Whenever the placed blocks change the running
+ * effects are dropped, they were drawn for a board that is gone (and the board is redrawn).
+ * Leaving the game for another screen drops them as well.
+ *
+ * @param anims The animations.
+ * @param prev The frame that is visible in the window.
+ * @param cur The frame that is drawn next.
+ */
+void schedule_effects(Animations *anims, const Frame *prev, const Frame *cur) {
+	const LockEvent *lock = &cur->lastLock;
+
+	if(cur->state != STATE_GAME && cur->state != STATE_GAME_OVER) {
+		anims->count = 0;
+	} else if(cur->state == STATE_GAME_OVER) {
+		if(prev->state == STATE_GAME) {
+			anims->count = 0;
+			add_effect(anims, EFFECT_GAME_OVER_FILL, cur->tick, ANIM_FILL_FRAMES, lock);
+		}
+	} else if(cur->boardVersion != anims->boardVersion) {
+		anims->count = 0;
+		if(lock->count != anims->lockCount && lock->rowsCleared > 0) {
+			add_effect(anims, EFFECT_ROW_FLASH, cur->tick, ANIM_FLASH_FRAMES, lock);
+			add_effect(anims, EFFECT_COLLAPSE, cur->tick + ANIM_FLASH_FRAMES, ANIM_COLLAPSE_FRAMES, lock);
+		} else if(lock->count != anims->lockCount) {
+			add_effect(anims, EFFECT_LOCK_FLASH, cur->tick, ANIM_LOCK_FRAMES, lock);
+		}
+	}
+
+	anims->lockCount = lock->count;
+	anims->boardVersion = cur->boardVersion;
+}
+
+/**
+ * @brief Draws the filled cells of one board row at any height, batched by color.
+ *
+ * @param rb The render backend.
+ * @param screens The cache holding the block atlas.
+ * @param filled Bit `x` is set for a block in column `x`.
+ * @param colors The color plane row of the blocks.
+ * @param y Window position of the top of the row (in px).
+ */
+static void draw_row(RenderBackend *rb, ScreenCache *screens, U16 filled, U32 colors, I16 y) {
+	XRectangle blocks[BOARD_WIDTH];
+	U16 count;
+
+	for(U8 c=0;c<CELL_COLORS;c++) {
+		count = 0;
+		for(U8 x=0;x<BOARD_WIDTH;x++) {
+			if((filled & (1 << x)) && ((colors >> (x * CELL_COLOR_BITS)) & CELL_COLOR_MASK) == c) {
+				blocks[count++] = (XRectangle){BOARD_OFFSET_LEFT + x * CELL_SIZE, y, CELL_SIZE-1, CELL_SIZE-1};
+			}
+		}
+		if(count > 0) {
+			draw_blocks(rb, screens, SURFACE_WINDOW, c, blocks, count);
+		}
+	}
+}
+
+/**
+ * @brief Returns the columns with a block in a board row, bit `x` for column `x`.
+ */
+static U16 row_cells(const GameBoard *board, U8 y) {
+	U16 filled = 0;
+
+	for(U8 x=0;x<BOARD_WIDTH;x++) {
+		filled |= (U16)(board->state[x][y] != 0) << x;
+	}
+	return filled;
+}
+
+/**
+ * @brief Clears a band of board rows and clips the drawing to it, inside the border.
+ *
+ * @param rb The render backend.
+ * @param top Window position of the top of the band (in px).
+ * @param bottom Window position below the band (in px).
+ * @param region Receives the band, destroyed by the caller after the drawing.
+ */
+static void clip_band(RenderBackend *rb, I16 top, I16 bottom, Region region) {
+	XRectangle band;
+
+	top = (top < BOARD_INNER_TOP) ? BOARD_INNER_TOP : top;
+	bottom = (bottom > BOARD_INNER_BOTTOM) ? BOARD_INNER_BOTTOM : bottom;
+	band = (XRectangle){BOARD_OFFSET_LEFT + LINE_WIDTH / 2, top, (BOARD_WIDTH_PX) - LINE_WIDTH, (bottom > top) ? bottom - top : 0};
+	XUnionRectWithRegion(&band, region, region);
+	rb->clear(rb->ctx, SURFACE_WINDOW, band.x, band.y, band.width, band.height);
+	rb->set_clip(rb->ctx, region);
+}
+
+/**
+ * @brief Draws the removed rows and the rows above them, during the flash and the collapse.
+ *
+ * The board of the frame already lost the removed rows. Its rows above the lowest removed one
+ * are drawn between the place they had before (`progress == 0`) and their place on the board
+ * (`progress == ANIM_COLLAPSE_FRAMES`). Only the band from the highest block to the lowest
+ * removed row is touched.
+ *
+ * @param rb The render backend.
+ * @param screens The cache holding the block atlas.
+ * @param effect The flash or collapse.
+ * @param board The board of the frame.
+ * @param progress Frames of the collapse done.
+ * @param blink Whether the removed rows are drawn white instead of in their colors.
+ */
+static void draw_collapse(RenderBackend *rb, ScreenCache *screens, const Effect *effect, const GameBoard *board, U16 progress, bool blink) {
+	const LockEvent *lock = &effect->lock;
+	U8 lowest = lock->clearedRows[lock->rowsCleared - 1];
+	I8 origin = lowest, top = lock->clearedRows[0];
+	I16 y;
+	U16 filled;
+	Region region = XCreateRegion();
+	XRectangle white[4 * BOARD_WIDTH];
+	U16 whites = 0;
+	U8 k;
+
+	// the highest block before the rows were removed
+	for(U8 row=0;row<=lowest;row++) {
+		if(row_cells(board, row) != 0) {
+			top = row - lock->rowsCleared;
+			top = (top < lock->clearedRows[0]) ? top : lock->clearedRows[0];
+			break;
+		}
+	}
+	clip_band(rb, BOARD_OFFSET_TOP + ((top < 0) ? 0 : top) * CELL_SIZE, BOARD_OFFSET_TOP + (lowest + 1) * CELL_SIZE, region);
+
+	// every row of the board above the lowest removed one came from the next row up that was not removed
+	k = lock->rowsCleared;
+	for(I8 row=lowest;row>=0;row--) {
+		while(k > 0 && origin == lock->clearedRows[k - 1]) {
+			origin--;
+			k--;
+		}
+		if(origin < 0) {
+			break;
+		}
+		filled = row_cells(board, row);
+		if(filled != 0) {
+			y = BOARD_OFFSET_TOP + origin * CELL_SIZE + (row - origin) * CELL_SIZE * progress / ANIM_COLLAPSE_FRAMES;
+			draw_row(rb, screens, filled, board->colors[row], y);
+		}
+		origin--;
+	}
+
+	if(progress == 0) {
+		for(k=0;k<lock->rowsCleared;k++) {
+			y = BOARD_OFFSET_TOP + lock->clearedRows[k] * CELL_SIZE;
+			if(!blink) {
+				draw_row(rb, screens, (1 << BOARD_WIDTH) - 1, lock->clearedColors[k], y);
+				continue;
+			}
+			for(U8 x=0;x<BOARD_WIDTH;x++) {
+				white[whites++] = (XRectangle){BOARD_OFFSET_LEFT + x * CELL_SIZE, y, CELL_SIZE-1, CELL_SIZE-1};
+			}
+		}
+		if(whites > 0) {
+			rb->fill_rects(rb->ctx, SURFACE_WINDOW, COLOR_FOREGROUND, white, whites);
+		}
+	}
+
+	rb->set_clip(rb->ctx, NULL);
+	XDestroyRegion(region);
+}
+
+/**
+ * @brief Draws the blocks of the placed Tetromino mixed with white, the last step in their own color.
+ */
+static void draw_lock_flash(RenderBackend *rb, ScreenCache *screens, const Effect *effect, U16 step) {
+	const LockEvent *lock = &effect->lock;
+	U16 shape = tetrominos[lock->type % TETROMINO_TYPES].rotations[lock->rotationState % 4];
+	XRectangle blocks[4];
+	U8 count = 0, color = lock->type % TETROMINO_TYPES + 1;
+	I8 x, y;
+
+	for(U8 i=0;i<4;i++) {
+		for(U8 j=0;j<4;j++) {
+			x = lock->col + j;
+			y = lock->row + i;
+			if((shape & (1 << (i * 4 + j))) != 0 && x >= 0 && x < BOARD_WIDTH && y >= 0 && y < BOARD_HEIGHT && count < 4) {
+				blocks[count++] = (XRectangle){BOARD_OFFSET_LEFT + x * CELL_SIZE, BOARD_OFFSET_TOP + y * CELL_SIZE, CELL_SIZE-1, CELL_SIZE-1};
+			}
+		}
+	}
+
+	if(step + 1 == effect->length) {
+		draw_blocks(rb, screens, SURFACE_WINDOW, color, blocks, count);
+	} else {
+		rb->fill_rects(rb->ctx, SURFACE_WINDOW, shade_color(cell_color(color), 256 - 256 * (step + 1) / effect->length), blocks, count);
+	}
+}
+
+/**
+ * @brief Fills the board from the bottom up with gray blocks, only the rows new since the last drawn step.
+ */
+static void draw_fill(RenderBackend *rb, ScreenCache *screens, const Effect *effect, U16 step) {
+	U16 done = effect->frame * BOARD_HEIGHT / effect->length;
+	U16 rows = (step + 1) * BOARD_HEIGHT / effect->length;
+
+	for(U16 row=done;row<rows;row++) {
+		draw_row(rb, screens, (1 << BOARD_WIDTH) - 1, 0, BOARD_OFFSET_TOP + (BOARD_HEIGHT - 1 - row) * CELL_SIZE);
+	}
+}
+
+/**
+ * @brief Draws the running effects over the frame at the tick of the frame.
+ *
+ * Called once per drawn frame after the frame itself, the simulation never waits for it. An
+ * effect takes one step per simulation tick, so it runs equally long at any frame rate: frames
+ * drawn within a tick draw the same step again (the moving Tetromino may have cleared parts of
+ * it), a step skipped by a slow frame is left out. The last step is always drawn, it leaves the
+ * plain frame behind. Each effect only touches its own rows or cells. The falling Tetromino is
+ * drawn again on top, so it shows without delay.
+ *
+ * @param anims The animations.
+ * @param rb The render backend.
+ * @param screens The cache holding the block atlas.
+ * @param cur The frame that was drawn.
+ * @return The number of effects still running.
+ */
+U8 draw_effects(Animations *anims, RenderBackend *rb, ScreenCache *screens, const Frame *cur) {
+	Effect *effect;
+	bool drawn = false;
+	U16 step;
+	U8 kept = 0;
+
+	for(U8 i=0;i<anims->count;i++) {
+		effect = &anims->effects[i];
+		if(cur->tick < effect->start) {
+			anims->effects[kept++] = *effect;
+			continue;
+		}
+		step = (cur->tick - effect->start < effect->length) ? (U16)(cur->tick - effect->start) : effect->length - 1;
+
+		switch(effect->type) {
+			case EFFECT_ROW_FLASH:
+				draw_collapse(rb, screens, effect, &cur->board, 0, (step / ANIM_FLASH_PERIOD) % 2 == 0);
+				break;
+			case EFFECT_COLLAPSE:
+				draw_collapse(rb, screens, effect, &cur->board, step + 1, false);
+				break;
+			case EFFECT_LOCK_FLASH:
+				draw_lock_flash(rb, screens, effect, step);
+				break;
+			case EFFECT_GAME_OVER_FILL:
+				draw_fill(rb, screens, effect, step);
+				break;
+		}
+		drawn = true;
+
+		effect->frame = step + 1;
+		if(effect->frame < effect->length) {
+			anims->effects[kept++] = *effect;
+		}
+	}
+	anims->count = kept;
+
+	if(drawn && cur->state == STATE_GAME && cur->hasPiece) {
+		draw_tetromino(rb, screens, SURFACE_WINDOW, &cur->piece);
+	}
+	return anims->count;
+}
@@ -0,0 +1,1354 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include <sched.h>
+#include <sys/wait.h>
+#include "cubes.h"
+
+#if BENCHMARK
+#define BENCH_DEFAULT_FRAMES 200
+#define BENCH_PATH_LENGTH 256
+#define BENCH_SOLVER_CASES 200		// boards in the perfect clear corpus
+#define BENCH_SOLVER_PIECES 14		// piece sequence of every board
+#define BENCH_SOLVER_BUDGET_US 50000
+#define BENCH_SOLVER_ATTEMPTS 32	// drops tried per piece while building a board
+#define BENCH_SOLVER_SEED 20241018
+#define BENCH_MOVEGEN_BOARDS 1000	// boards in the move generator corpus
+#define BENCH_MOVEGEN_MIN_ROWS 4	// garbage rows of a messy board
+#define BENCH_MOVEGEN_MAX_ROWS 14
+#define BENCH_MOVEGEN_DENSITY 60	// percentage of filled garbage cells
+#define BENCH_MOVEGEN_SEED 20241019
+#define BENCH_REWIND_GAMES 50		// games played with the move generator and rewound
+#define BENCH_REWIND_STACK 12		// rows the stack may grow to before a game is rewound
+#define BENCH_REWIND_NOISE 4		// random share of the depth a move is picked by
+#define BENCH_REWIND_RECORDS 1000000
+#define BENCH_REWIND_SEED 20241020
+#define BENCH_SHM_INPUTS 50000		// actions the bot process sends, it checks a state after each
+#define BENCH_GRID_TICKS 1200		// ticks played per board count (20 s of game time)
+#define BENCH_GRID_SEED 20241021
+#define BENCH_EVAL_BATCHES 4096		// batches of candidate boards, half after real moves, half random stacks
+#define BENCH_EVAL_PASSES 20		// times every kernel evaluates all batches
+#define BENCH_EVAL_SEED 20241022
+#define BENCH_INPUT_SEED 20241023
+#define BENCH_FRAMES_PER_TICK 4		// frames drawn per tick in the interpolated scene (240 Hz)
+#define BENCH_TARGET_HZ 240			// --x11: frame rate the p99 frame time has to allow
+
+typedef enum {
+	SCENE_START = 0,	///< Start screen rendered from scratch
+	SCENE_PAUSE,
+	SCENE_GAME_OVER,
+	SCENE_SCREEN_COPY,	///< Cached screen restored with a blit
+	SCENE_BOARD_EMPTY,	///< Full redraw of an empty board
+	SCENE_BOARD_FULL,	///< Full redraw of a board with every other cell filled
+	SCENE_LINE_CLEAR,	///< Redraw after the piece locked and two rows were removed
+	SCENE_PIECE_MOVE,	///< Incremental frame: the piece moved one row
+	SCENE_EXPOSE,		///< Repaint of a damaged area
+	SCENE_INTERPOLATED,	///< Frame between two ticks: the soft dropped piece moved a quarter of a tick
+	SCENE_COUNT
+} BenchScene;
+
+static const char *sceneNames[SCENE_COUNT] = {
+	"start", "pause", "game_over", "screen_copy", "board_empty", "board_full", "line_clear", "piece_move", "expose", "interpolated"
+};
+
+/**
+ * @brief Builds the frame drawn by the board scenes.
+ *
+ * @param frame The frame to fill.
+ * @param full If true every other cell of the lower half is filled, in all colors.
+ */
+static void bench_frame(Frame *frame, bool full) {
+	const Tetromino piece = {0, {0x4e00, 0x2320, 0x7200, 0x04c4}, SPAWN_COLUMN, 0, 0, 0x800080, 2}; // "T"
+
+	memset(frame, 0, sizeof(*frame));
+	init_game(&frame->board, 12345);
+	frame->state = STATE_GAME;
+	frame->board.score = 6700;
+	frame->board.level = 3;
+	frame->piece = piece;
+	frame->hasPiece = true;
+
+	if(full) {
+		for(U8 y=BOARD_HEIGHT/2;y<BOARD_HEIGHT;y++) {
+			for(U8 x=0;x<BOARD_WIDTH;x++) {
+				frame->board.state[x][y] = (x + y) % 2;
+				if(frame->board.state[x][y]) {
+					frame->board.colors[y] |= (U32)((x + y / 2) % CELL_COLORS) << (x * CELL_COLOR_BITS); // every color
+				}
+			}
+		}
+	}
+}
+
+/**
+ * @brief Builds the frames before and after a lock that removed the two bottom rows.
+ *
+ * @param prev Receives the frame with the full rows.
+ * @param cur Receives the frame after they were removed, its `lastLock` describes them.
+ */
+static void bench_line_clear(Frame *prev, Frame *cur) {
+	bench_frame(prev, true);
+	for(U8 x=0;x<BOARD_WIDTH;x++) {
+		prev->board.state[x][BOARD_HEIGHT - 1] = prev->board.state[x][BOARD_HEIGHT - 2] = 1;
+	}
+	prev->board.colors[BOARD_HEIGHT - 1] = prev->board.colors[BOARD_HEIGHT - 2] = CELL_COLOR_ROW_MASK;
+	*cur = *prev;
+	for(U8 y=BOARD_HEIGHT-1;y>=2;y--) {
+		for(U8 x=0;x<BOARD_WIDTH;x++) {
+			cur->board.state[x][y] = cur->board.state[x][y - 2];
+		}
+		cur->board.colors[y] = cur->board.colors[y - 2];
+	}
+	cur->board.score += 300;
+	cur->boardVersion++;
+	cur->hasPiece = false;
+	cur->lastLock.count = prev->lastLock.count + 1;
+	cur->lastLock.rowsCleared = 2;
+	for(U8 k=0;k<2;k++) {
+		cur->lastLock.clearedRows[k] = BOARD_HEIGHT - 2 + k;
+		cur->lastLock.clearedColors[k] = CELL_COLOR_ROW_MASK;
+	}
+}
+
+/**
+ * @brief Draws one frame of a scene.
+ *
+ * @param rb The render backend.
+ * @param screens The screen cache (used by `SCENE_SCREEN_COPY`).
+ * @param scene The scene.
+ * @param iteration Number of the frame, varies the incremental scenes.
+ */
+static void bench_draw(RenderBackend *rb, ScreenCache *screens, BenchScene scene, U32 iteration) {
+	Frame prev, cur, from, to;
+	XRectangle damage = {BOARD_OFFSET_LEFT - 40, BOARD_OFFSET_TOP + 200, 200, 150};
+	U32 phase = iteration % BENCH_FRAMES_PER_TICK;
+	U16 y;
+
+	switch(scene) {
+		case SCENE_START:
+			draw_start_screen(rb, SURFACE_WINDOW);
+			break;
+		case SCENE_PAUSE:
+			draw_pause_screen(rb, SURFACE_WINDOW);
+			break;
+		case SCENE_GAME_OVER:
+			draw_end_screen(rb, SURFACE_WINDOW);
+			break;
+		case SCENE_SCREEN_COPY:
+			draw_screen(rb, screens, SCREEN_START);
+			break;
+		case SCENE_BOARD_EMPTY:
+		case SCENE_BOARD_FULL:
+			bench_frame(&cur, scene == SCENE_BOARD_FULL);
+			prev = cur;
+			prev.state = STATE_START; // forces the full redraw
+			render_frame(rb, screens, NULL, &prev, &cur);
+			break;
+		case SCENE_LINE_CLEAR:
+			bench_line_clear(&prev, &cur);
+			render_frame(rb, screens, NULL, &prev, &cur);
+			break;
+		case SCENE_PIECE_MOVE:
+			bench_frame(&prev, true);
+			cur = prev;
+			prev.piece.row += iteration % (BOARD_HEIGHT / 2);
+			cur.piece.row = prev.piece.row + 1;
+			render_frame(rb, screens, NULL, &prev, &cur);
+			break;
+		case SCENE_EXPOSE:
+			bench_frame(&cur, true);
+			rb->clear(rb->ctx, SURFACE_WINDOW, damage.x, damage.y, damage.width, damage.height);
+			XUnionRectWithRegion(&damage, exposeRegion, exposeRegion);
+			prev = cur;
+			render_frame(rb, screens, NULL, &prev, &cur);
+			break;
+		case SCENE_INTERPOLATED:
+			bench_frame(&from, true);
+			from.tick = iteration / BENCH_FRAMES_PER_TICK;
+			y = from.tick % ((BOARD_HEIGHT / 2 - 4) * BLOCKSIZE / SOFT_DROP_SPEED) * SOFT_DROP_SPEED;
+			from.piece.row = y / BLOCKSIZE;
+			from.piece.fraction = y % BLOCKSIZE;
+			to = from;
+			to.tick++;
+			to.piece.row = (y + SOFT_DROP_SPEED) / BLOCKSIZE;
+			to.piece.fraction = (y + SOFT_DROP_SPEED) % BLOCKSIZE;
+			interpolate_frame(&from, &to, phase * TICK_NS / BENCH_FRAMES_PER_TICK, &prev);
+			interpolate_frame(&from, &to, (phase + 1) * TICK_NS / BENCH_FRAMES_PER_TICK, &cur);
+			render_frame(rb, screens, NULL, &prev, &cur);
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+ * @brief Measures the stack of a board.
+ *
+ * @param board The board.
+ * @param holes Receives whether an empty cell lies below a filled one.
+ * @return The number of rows up to the highest filled cell.
+ */
+static U8 bench_stack_height(const GameBoard *board, bool *holes) {
+	U8 height = 0;
+	bool filled;
+
+	*holes = false;
+	for(U8 x=0;x<BOARD_WIDTH;x++) {
+		filled = false;
+		for(U8 y=0;y<BOARD_HEIGHT;y++) {
+			if(board->state[x][y]) {
+				if(BOARD_HEIGHT - y > height) {
+					height = BOARD_HEIGHT - y;
+				}
+				filled = true;
+			} else {
+				*holes |= filled;
+			}
+		}
+	}
+	return height;
+}
+
+/**
+ * @brief Builds a board of the perfect clear corpus with the game's own movement.
+ *
+ * A few random pieces are rotated, shifted and hard dropped onto an empty board. Drops that
+ * would leave a hole or grow the stack above 4 rows are tried again elsewhere, a piece that
+ * fits nowhere is left out.
+ *
+ * @param rng The generator of this board.
+ * @param board Receives the board.
+ * @param pieces Receives the piece sequence to solve with.
+ */
+static void bench_solver_board(Rng *rng, GameBoard *board, U8 pieces[BENCH_SOLVER_PIECES]) {
+	GameBoard tried;
+	Tetromino *piece;
+	U8 count, rows;
+	bool holes;
+
+	init_game(board, 0);
+	count = 2 + rng_below(rng, 5);
+	for(U8 i=0;i<count;i++) {
+		for(U8 attempt=0;attempt<BENCH_SOLVER_ATTEMPTS;attempt++) {
+			if((piece = get_tetromino(rng_below(rng, TETROMINO_TYPES))) == NULL) {
+				return;
+			}
+			tried = *board;
+			for(U8 r=rng_below(rng, 4);r>0;r--) {
+				(void)move_tetromino(&tried, piece, KEY_UP);
+			}
+			for(I8 shift=(I8)rng_below(rng, BOARD_WIDTH) - BOARD_WIDTH / 2;shift!=0 && shift_tetromino(&tried, piece, (shift < 0) ? -1 : 1);shift+=(shift < 0) ? 1 : -1);
+			(void)move_tetromino(&tried, piece, KEY_SPACE);
+			free_tetromino(&piece);
+			(void)remove_full_row(&tried, &rows);
+
+			if(bench_stack_height(&tried, &holes) <= 4 && !holes) {
+				*board = tried;
+				break;
+			}
+		}
+	}
+
+	for(U8 i=0;i<BENCH_SOLVER_PIECES;i++) {
+		pieces[i] = rng_below(rng, TETROMINO_TYPES);
+	}
+}
+
+/**
+ * @brief Plays a solution with the game's own movement and checks that it clears the board.
+ *
+ * @param solver The solver holding the solution.
+ * @param board The board it was found for (a copy is played).
+ * @return `true` if every piece lands where the solver said and the board ends up empty.
+ */
+static bool bench_check_solution(const PcSolver *solver, const GameBoard *board) {
+	GameBoard played = *board;
+	Tetromino *piece;
+	U8 rows;
+	bool landed;
+
+	for(U8 i=0;i<solver->length;i++) {
+		if((piece = get_tetromino(solver->path[i].type)) == NULL) {
+			return false;
+		}
+		piece->rotationState = solver->path[i].rotationState;
+		piece->col = solver->path[i].col;
+		(void)move_tetromino(&played, piece, KEY_SPACE); // hard drop
+		landed = (piece->row == solver->path[i].row);
+		free_tetromino(&piece);
+		if(!landed) {
+			return false;
+		}
+		(void)remove_full_row(&played, &rows);
+	}
+
+	for(U8 x=0;x<BOARD_WIDTH;x++) {
+		for(U8 y=0;y<BOARD_HEIGHT;y++) {
+			if(played.state[x][y]) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * @brief Benchmarks the perfect clear solver on a fixed corpus of boards.
+ *
+ * @return `0` if every solution checked out, `-1` otherwise.
+ */
+static int bench_solver(void) {
+	PcSolver solver;
+	GameBoard board;
+	Rng base, rng;
+	U8 pieces[BENCH_SOLVER_PIECES];
+	U32 results[SOLVE_TOO_HIGH + 1] = {0};
+	U32 wrong = 0;
+	I64 start, elapsed = 0;
+	SolveResult result;
+
+	if(init_solver(&solver, SOLVER_MEMO_BITS) != 0) {
+		return -1;
+	}
+
+	init_rng(&base, RNG_COUNTER, BENCH_SOLVER_SEED);
+	for(U32 i=0;i<BENCH_SOLVER_CASES;i++) {
+		rng_stream(&base, i, &rng);
+		bench_solver_board(&rng, &board, pieces);
+
+		start = now_ns();
+		result = solve_perfect_clear(&solver, &board, pieces, BENCH_SOLVER_PIECES, BENCH_SOLVER_BUDGET_US);
+		elapsed += now_ns() - start;
+
+		results[result]++;
+		if(result == SOLVE_FOUND && !bench_check_solution(&solver, &board)) {
+			wrong++;
+		}
+	}
+
+	printf("perfect clear: %u boards, %u found, %u none, %u timeout (%d ms budget), %u wrong\n",
+		BENCH_SOLVER_CASES, results[SOLVE_FOUND], results[SOLVE_NONE], results[SOLVE_TIMEOUT], BENCH_SOLVER_BUDGET_US / 1000, wrong);
+	printf("%.1f solves/s, %.0f nodes/s, %.3f ms per board\n",
+		BENCH_SOLVER_CASES / (elapsed / 1e9), solver.nodes / (elapsed / 1e9), elapsed / 1e6 / BENCH_SOLVER_CASES);
+
+	free_solver(&solver);
+	return (wrong == 0) ? 0 : -1;
+}
+
+/**
+ * @brief Fills the lower part of a board with random garbage, full of holes and overhangs.
+ *
+ * @param rng The generator of this board.
+ * @param board Receives the board.
+ */
+static void bench_messy_board(Rng *rng, GameBoard *board) {
+	U8 rows = BENCH_MOVEGEN_MIN_ROWS + rng_below(rng, BENCH_MOVEGEN_MAX_ROWS - BENCH_MOVEGEN_MIN_ROWS + 1);
+	U8 filled;
+
+	init_game(board, 0);
+	for(U8 y=BOARD_HEIGHT-rows;y<BOARD_HEIGHT;y++) {
+		filled = 0;
+		for(U8 x=0;x<BOARD_WIDTH;x++) {
+			board->state[x][y] = (rng_below(rng, 100) < BENCH_MOVEGEN_DENSITY);
+			filled += board->state[x][y];
+		}
+		if(filled == BOARD_WIDTH) {
+			board->state[rng_below(rng, BOARD_WIDTH)][y] = 0; // full rows would have been cleared
+		}
+	}
+}
+
+/**
+ * @brief Packs the board cells of a placement into a key, equal for rotations that look the same.
+ */
+static U32 bench_placement_cells(const Placement *placement) {
+	U16 shape = tetrominos[placement->type].rotations[placement->rotationState];
+	U32 cells = 0;
+
+	for(U8 i=0;i<4;i++) {
+		for(U8 j=0;j<4;j++) {
+			if(shape & (1 << (i * 4 + j))) {
+				cells = (cells << 8) | (U8)((placement->row + i) * BOARD_WIDTH + placement->col + j);
+			}
+		}
+	}
+	return cells;
+}
+
+/**
+ * @brief Plays a move with the game's own movement and checks that it locks where it should.
+ *
+ * @param move The move.
+ * @param board The board it was generated for (a copy is played).
+ * @return `true` if every input had an effect and the piece locked at the placement.
+ */
+static bool bench_check_move(const Move *move, const GameBoard *board) {
+	GameBoard played = *board;
+	Tetromino *piece;
+	U8 rotation;
+	bool ok = true;
+
+	if((piece = get_tetromino(move->placement.type)) == NULL) {
+		return false;
+	}
+	for(U8 i=0;i<move->length && ok;i++) {
+		switch(move->inputs[i]) {
+			case KEY_LEFT:
+			case KEY_RIGHT:
+				ok = shift_tetromino(&played, piece, (move->inputs[i] == KEY_LEFT) ? -1 : 1);
+				break;
+			case KEY_UP:
+			case KEY_CTRL:
+				rotation = piece->rotationState;
+				ok = !move_tetromino(&played, piece, move->inputs[i]) && piece->rotationState != rotation;
+				break;
+			case KEY_DOWN:
+				ok = !drop_tetromino(&played, piece, BLOCKSIZE); // one row, must not lock
+				break;
+			case KEY_SPACE:
+				ok = move_tetromino(&played, piece, KEY_SPACE) && i + 1 == move->length;
+				break;
+			default:
+				ok = false;
+		}
+	}
+	ok &= (piece->col == move->placement.col && piece->row == move->placement.row && piece->rotationState == move->placement.rotationState);
+	free_tetromino(&piece);
+	return ok;
+}
+
+/**
+ * @brief Counts the plain drops (rotate, shift, hard drop) the move list misses.
+ *
+ * @param list The moves generated for the board.
+ * @param board The board.
+ * @param type The piece.
+ * @return The number of drops the game allows that are not in the list.
+ */
+static U32 bench_missing_drops(const MoveList *list, const GameBoard *board, U8 type) {
+	GameBoard played;
+	Tetromino *piece;
+	Placement placement;
+	U32 cells, missing = 0;
+	bool found;
+
+	for(U8 r=0;r<4;r++) {
+		for(I8 shift=-BOARD_WIDTH/2;shift<=BOARD_WIDTH/2;shift++) {
+			if((piece = get_tetromino(type)) == NULL) {
+				return missing;
+			}
+			played = *board;
+			for(U8 k=0;k<r;k++) {
+				(void)move_tetromino(&played, piece, KEY_UP);
+			}
+			for(I8 k=0;k!=shift && shift_tetromino(&played, piece, (shift < 0) ? -1 : 1);k+=(shift < 0) ? -1 : 1);
+			(void)move_tetromino(&played, piece, KEY_SPACE);
+			placement = (Placement){type, piece->rotationState, piece->col, piece->row};
+			free_tetromino(&piece);
+
+			cells = bench_placement_cells(&placement);
+			found = false;
+			for(U16 m=0;m<list->count && !found;m++) {
+				found = (bench_placement_cells(&list->moves[m].placement) == cells);
+			}
+			missing += !found;
+		}
+	}
+	return missing;
+}
+
+/**
+ * @brief Benchmarks the move generator on a fixed corpus of messy boards.
+ *
+ * Every move is played back with the game's movement, and every plain hard drop has to show up
+ * in the move list.
+ *
+ * @return `0` if all moves checked out, `-1` otherwise.
+ */
+static int bench_movegen(void) {
+	static GameBoard boards[BENCH_MOVEGEN_BOARDS];
+	static MoveList list;
+	Rng base, rng;
+	U64 moves = 0, states = 0, inputs = 0;
+	U32 wrong = 0, missing = 0;
+	I64 start, elapsed;
+
+	init_rng(&base, RNG_COUNTER, BENCH_MOVEGEN_SEED);
+	for(U32 i=0;i<BENCH_MOVEGEN_BOARDS;i++) {
+		rng_stream(&base, i, &rng);
+		bench_messy_board(&rng, &boards[i]);
+	}
+
+	start = now_ns();
+	for(U32 i=0;i<BENCH_MOVEGEN_BOARDS;i++) {
+		for(U8 type=0;type<TETROMINO_TYPES;type++) {
+			moves += generate_moves(&boards[i], type, &list);
+			states += list.states;
+		}
+	}
+	elapsed = now_ns() - start;
+
+	for(U32 i=0;i<BENCH_MOVEGEN_BOARDS;i++) {
+		for(U8 type=0;type<TETROMINO_TYPES;type++) {
+			(void)generate_moves(&boards[i], type, &list);
+			for(U16 m=0;m<list.count;m++) {
+				wrong += !bench_check_move(&list.moves[m], &boards[i]);
+				inputs += list.moves[m].length;
+			}
+			missing += bench_missing_drops(&list, &boards[i], type);
+		}
+	}
+
+	printf("move generator: %d boards x %d pieces, %.1f moves and %.0f states per piece, %.2f inputs per move\n",
+		BENCH_MOVEGEN_BOARDS, TETROMINO_TYPES, (double)moves / (BENCH_MOVEGEN_BOARDS * TETROMINO_TYPES),
+		(double)states / (BENCH_MOVEGEN_BOARDS * TETROMINO_TYPES), moves ? (double)inputs / moves : 0.0);
+	printf("%.0f ns per piece, %u wrong, %u hard drops missing\n", (double)elapsed / (BENCH_MOVEGEN_BOARDS * TETROMINO_TYPES), wrong, missing);
+	return (wrong == 0 && missing == 0) ? 0 : -1;
+}
+
+/**
+ * @brief Pushes one key press and its release into an input queue.
+ */
+static void bench_key(InputQueue *queue, KeyAction action) {
+	(void)push_input(queue, &(InputEvent){action, true, 0});
+	(void)push_input(queue, &(InputEvent){action, false, 0});
+}
+
+/**
+ * @brief Returns how far the falling Tetromino is below the top of the board (in px).
+ */
+static I32 bench_piece_y(const Game *game) {
+	return game->current->row * BLOCKSIZE + game->current->fraction;
+}
+
+/**
+ * @brief Checks how far the falling Tetromino moves on the ticks around a held down key.
+ *
+ * The tick of the press moves it by one soft drop step only (the press itself, no gravity on
+ * top), every further tick the key is held by one more, after the release gravity takes over.
+ *
+ * @return `0` if every tick moved the Tetromino as far as expected, `-1` otherwise.
+ */
+static int bench_input(void) {
+	static Game game;
+	static InputQueue queue;
+	Options options = {0};
+	const struct {
+		const char *name;
+		bool press, release;
+		I32 expected;
+	} ticks[] = {
+		{"press", true, false, SOFT_DROP_SPEED},
+		{"held", false, false, SOFT_DROP_SPEED},
+		{"held", false, false, SOFT_DROP_SPEED},
+		{"release", false, true, GRAVITY_SPEED},
+	};
+	I32 y, moved;
+	U32 wrong = 0;
+
+	options.dasMs = DEFAULT_DAS_MS;
+	options.arrMs = DEFAULT_ARR_MS;
+	options.seed = BENCH_INPUT_SEED;
+	init_session(&game, &options, NULL);
+	bench_key(&queue, KEY_ANY);
+	step_game(&game, &queue); // start screen
+	step_game(&game, &queue); // spawn
+	for(U8 i=0;i<sizeof(ticks)/sizeof(ticks[0]);i++) {
+		if(ticks[i].press) {
+			(void)push_input(&queue, &(InputEvent){KEY_DOWN, true, 0});
+		}
+		if(ticks[i].release) {
+			(void)push_input(&queue, &(InputEvent){KEY_DOWN, false, 0});
+		}
+		y = bench_piece_y(&game);
+		step_game(&game, &queue);
+		moved = (game.current != NULL) ? bench_piece_y(&game) - y : -1;
+		wrong += (moved != ticks[i].expected);
+		printf("%-8s tick: moved %3d px, expected %3d px\n", ticks[i].name, moved, ticks[i].expected);
+	}
+	free_session(&game);
+
+	printf("input: %u ticks wrong\n", wrong);
+	return (wrong == 0) ? 0 : -1;
+}
+
+/**
+ * @brief Compares the game with the state it had when a Tetromino spawned.
+ *
+ * @param game The game after a rewind.
+ * @param spawn Copy of the game taken right after the Tetromino spawned.
+ * @return `true` if board, score, queue, random generator and falling Tetromino are the same.
+ */
+static bool bench_same_spawn(const Game *game, const Game *spawn) {
+	return memcmp(game->board.state, spawn->board.state, sizeof(game->board.state)) == 0
+		&& memcmp(game->board.colors, spawn->board.colors, sizeof(game->board.colors)) == 0
+		&& game->board.score == spawn->board.score && game->board.level == spawn->board.level
+		&& memcmp(game->next, spawn->next, sizeof(game->next)) == 0
+		&& game->rng.counter == spawn->rng.counter && game->rng.state == spawn->rng.state
+		&& game->current != NULL && game->current->type == spawn->current->type
+		&& game->current->col == SPAWN_COLUMN && game->current->row == 0 && game->current->rotationState == 0;
+}
+
+/**
+ * @brief Picks a move for the bench games, mostly the one that lands deepest.
+ *
+ * Moves with a soft drop are left out, the game applies every input of a tick before gravity
+ * and a held down key would drop further than one row.
+ *
+ * @param rng The generator of the game's inputs.
+ * @param list The moves of the falling Tetromino.
+ * @return The move to play, `NULL` if there is none.
+ */
+static const Move *bench_pick_move(Rng *rng, const MoveList *list) {
+	const Move *best = NULL;
+	U16 shape;
+	U32 depth, bestDepth = 0;
+	bool soft;
+
+	for(U16 m=0;m<list->count;m++) {
+		soft = (memchr(list->moves[m].inputs, KEY_DOWN, list->moves[m].length) != NULL);
+		if(soft || list->moves[m].length > INPUT_QUEUE_SIZE / 2) {
+			continue;
+		}
+		shape = tetrominos[list->moves[m].placement.type].rotations[list->moves[m].placement.rotationState];
+		depth = rng_below(rng, BENCH_REWIND_NOISE);
+		for(U8 i=0;i<16;i++) {
+			depth += (shape & (1 << i)) ? (U32)(list->moves[m].placement.row + i / 4) * BENCH_REWIND_NOISE : 0;
+		}
+		if(best == NULL || depth > bestDepth) {
+			best = &list->moves[m];
+			bestDepth = depth;
+		}
+	}
+	return best;
+}
+
+/**
+ * @brief Plays games with the move generator and takes back every placement again.
+ *
+ * The games stop while the stack is still low, a placement that ends the game can not be
+ * taken back. After each rewind the game has to be exactly where it was when the Tetromino
+ * spawned. Also reports what recording a placement and a rewind cost.
+ *
+ * @return `0` if every rewind restored the game, `-1` otherwise.
+ */
+static int bench_rewind(void) {
+	static Game game;
+	static Game spawns[REWIND_LENGTH];
+	static Tetromino spawned[REWIND_LENGTH];
+	static InputQueue queue;
+	static MoveList list;
+	Options options = {0};
+	Rng inputs;
+	const Move *move;
+	U32 count, rewinds = 0, wrong = 0, lines = 0;
+	I64 start, rewindNs = 0, recordNs;
+	bool hadPiece, holes;
+
+	init_rng(&inputs, RNG_COUNTER, BENCH_REWIND_SEED);
+	for(U32 g=0;g<BENCH_REWIND_GAMES;g++) {
+		options.dasMs = DEFAULT_DAS_MS;
+		options.arrMs = DEFAULT_ARR_MS;
+		options.seed = BENCH_REWIND_SEED + g;
+		options.rngMode = (g % 2) ? RNG_BBS : RNG_COUNTER;
+		init_session(&game, &options, NULL);
+		memset(&queue, 0, sizeof(queue));
+		bench_key(&queue, KEY_ANY);
+		step_game(&game, &queue); // start screen
+
+		count = 0;
+		while(game.state == STATE_GAME && count < REWIND_LENGTH && bench_stack_height(&game.board, &holes) < BENCH_REWIND_STACK) {
+			hadPiece = (game.current != NULL);
+			step_game(&game, &queue);
+			if(hadPiece || game.current == NULL) {
+				continue;
+			}
+			spawns[count] = game;
+			spawned[count] = *game.current;
+			spawns[count].current = &spawned[count];
+			count++;
+
+			(void)generate_moves(&game.board, game.current->type, &list);
+			if((move = bench_pick_move(&inputs, &list)) != NULL) {
+				for(U8 i=0;i<move->length;i++) {
+					bench_key(&queue, move->inputs[i]);
+				}
+			}
+		}
+		for(U8 i=0;i<METRICS_LINE_SIZES;i++) {
+			lines += game.metrics.linesCleared[i] * (i + 1);
+		}
+
+		// the placed Tetrominos are the spawned ones, except one still falling
+		wrong += ((U32)game.rewind.count + (game.current != NULL) != count);
+		for(I32 k=game.rewind.count-1;k>=0;k--) {
+			start = now_ns();
+			if(rewind_placement(&game) != 0) {
+				wrong++;
+				break;
+			}
+			rewindNs += now_ns() - start;
+			rewinds++;
+			wrong += !bench_same_spawn(&game, &spawns[k]);
+		}
+		wrong += (rewind_placement(&game) == 0); // nothing left
+		free_session(&game);
+	}
+
+	init_game(&game.board, 0);
+	start = now_ns();
+	for(U32 i=0;i<BENCH_REWIND_RECORDS;i++) {
+		record_placement(&game);
+	}
+	recordNs = now_ns() - start;
+
+	printf("rewind: %d games, %u placements and %u lines taken back, %u wrong\n", BENCH_REWIND_GAMES, rewinds, lines, wrong);
+	printf("%zu bytes per placement, %zu bytes for %d placements, %.0f ns to record, %.0f ns to take back\n",
+		sizeof(RewindEntry), sizeof(RewindRing), REWIND_LENGTH, (double)recordNs / BENCH_REWIND_RECORDS, rewinds ? (double)rewindNs / rewinds : 0.0);
+	return (wrong == 0) ? 0 : -1;
+}
+
+/**
+ * @brief Fills a game whose every field follows from `i`, a torn read breaks the pattern.
+ */
+static void bench_shm_game(Game *game, U64 i) {
+	game->tick = i;
+	game->board.score = game->board.highscore = 3 * i;
+	game->board.level = game->boardVersion = (U32)i;
+	for(U8 y=0;y<BOARD_HEIGHT;y++) {
+		for(U8 x=0;x<BOARD_WIDTH;x++) {
+			game->board.state[x][y] = (i + x + y) & 1;
+		}
+		game->board.colors[y] = (U32)i;
+	}
+	for(U8 k=0;k<PIECE_QUEUE_LENGTH;k++) {
+		game->next[k] = (i + k) % TETROMINO_TYPES;
+	}
+}
+
+/**
+ * @brief Checks a state read from the shared memory against the pattern of `bench_shm_game`.
+ */
+static bool bench_shm_consistent(const ShmState *state) {
+	U64 i = state->tick;
+	bool ok = state->score == 3 * i && state->highscore == 3 * i && state->level == (U32)i && state->boardVersion == (U32)i;
+
+	for(U8 y=0;y<BOARD_HEIGHT;y++) {
+		for(U8 x=0;x<BOARD_WIDTH;x++) {
+			ok &= (state->cells[y][x] == ((i + x + y) & 1));
+		}
+		ok &= (state->colors[y] == (U32)i);
+	}
+	for(U8 k=0;k<PIECE_QUEUE_LENGTH;k++) {
+		ok &= (state->next[k] == (i + k) % TETROMINO_TYPES);
+	}
+	return ok;
+}
+
+/**
+ * @brief The bot process of `bench_shm`: sends actions and reads the state in between.
+ *
+ * @param region The shared memory, mapped by the parent.
+ * @return The exit status, `0` if every state read was consistent.
+ */
+static int bench_shm_bot(ShmRegion *region) {
+	ShmState state;
+	U32 torn = 0;
+	U64 lastTick = 0;
+	I64 start, readNs = 0;
+
+	for(U32 k=0;k<BENCH_SHM_INPUTS;k++) {
+		while(!send_shm_input(region, (KeyAction)(k % KEY_COUNT), k % 2)) {
+			sched_yield(); // the game takes them once per tick
+		}
+		start = now_ns();
+		read_shm_state(region, &state);
+		readNs += now_ns() - start;
+		torn += !bench_shm_consistent(&state) || state.tick < lastTick;
+		lastTick = state.tick;
+	}
+	printf("shm bot: %d states read, %.0f ns per read, %u inconsistent, %u sends retried on a full ring\n",
+		BENCH_SHM_INPUTS, (double)readNs / BENCH_SHM_INPUTS, torn, region->inputDropped);
+	return (torn == 0) ? 0 : 1;
+}
+
+/**
+ * @brief Runs the shared memory interface between this process and a forked bot process.
+ *
+ * The game side publishes states as fast as it can, the bot checks every state it reads for a
+ * torn copy and sends actions, which have to arrive in order in the game's input queue.
+ *
+ * @return `0` if the states were consistent and every action arrived in order, `-1` otherwise.
+ */
+static int bench_shm(void) {
+	static Game game;
+	static InputQueue queue;
+	ShmInterface shm;
+	InputEvent event;
+	char name[SHM_NAME_LENGTH];
+	pid_t bot;
+	int status;
+	U32 received = 0, wrong = 0;
+	U64 published = 0;
+	I64 start, publishNs = 0;
+
+	snprintf(name, sizeof(name), "/cubes-bench-%d", (int)getpid());
+	if(init_shm_interface(&shm, name) != 0) {
+		return -1;
+	}
+	bench_shm_game(&game, 0);
+	publish_shm_state(&shm, &game);
+
+	if((bot = fork()) < 0) {
+		fprintf(stderr, "Error: could not start the bot process\n");
+		free_shm_interface(&shm);
+		return -1;
+	}
+	if(bot == 0) {
+		exit(bench_shm_bot(shm.region));
+	}
+
+	while(received < BENCH_SHM_INPUTS) {
+		bench_shm_game(&game, ++published);
+		start = now_ns();
+		publish_shm_state(&shm, &game);
+		publishNs += now_ns() - start;
+
+		(void)pump_shm_inputs(&shm, &queue);
+		while(pop_input(&queue, &event)) {
+			wrong += (event.action != (KeyAction)(received % KEY_COUNT) || event.pressed != (received % 2));
+			received++;
+		}
+	}
+	waitpid(bot, &status, 0);
+	free_shm_interface(&shm);
+
+	printf("shm game: %lu states published, %.0f ns per state, %u actions received, %u out of order, %zu bytes shared\n",
+		(unsigned long)published, (double)publishNs / published, received, wrong, sizeof(ShmRegion));
+	return (wrong == 0 && WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : -1;
+}
+
+/**
+ * @brief Orders frame times for the percentiles.
+ */
+static int bench_compare_ns(const void *a, const void *b) {
+	I64 x = *(const I64 *)a, y = *(const I64 *)b;
+	return (x > y) - (x < y);
+}
+
+/**
+ * @brief Renders every scene on the X server of `DISPLAY` and reports the results as JSON.
+ *
+ * Meant for Xvfb on build machines. Every frame is fenced with `XSync`, so its time includes the
+ * work of the server. The X requests, bytes and round trips are counted per frame like `--xstats`
+ * does, the sync is not part of them.
+ *
+ * @param frames Frames per scene.
+ * @return `0` on success, `-1` if there is no X server or the fonts are missing.
+ */
+static int bench_x11(U32 frames) {
+	XWindow xw = {0};
+	XftFont *fonts[FONT_COUNT];
+	X11Backend x11;
+	RenderBackend rb;
+	ScreenCache screens;
+	I64 *times, start, total;
+	XStats traffic;
+	int status = 0;
+
+	if((times = malloc(frames * sizeof(*times))) == NULL) {
+		fprintf(stderr, "Error: could not allocate memory for %u frame times\n", frames);
+		return -1;
+	}
+	if((xw.display = XOpenDisplay(NULL)) == NULL) {
+		fprintf(stderr, "Error: could not open connection to X Server (i.e. default display)\n");
+		status = -1;
+		goto free_times;
+	}
+	start_font_loading();
+	xw.screenNumber = XDefaultScreen(xw.display);
+	xw.window = XCreateSimpleWindow(xw.display, XDefaultRootWindow(xw.display), 1, 1, WINDOW_WIDTH, WINDOW_HEIGHT, 0,
+		XBlackPixel(xw.display, xw.screenNumber), XWhitePixel(xw.display, xw.screenNumber));
+	if(init_main_window(xw.display, xw.window) != 0) {
+		status = -1;
+		goto destroy_window;
+	}
+	init_graphics(&xw);
+	if(finish_font_loading(&xw, fonts) != 0) {
+		fprintf(stderr, "Ensure your Fonts are installed correctly\n");
+		status = -1;
+		goto free_gc;
+	}
+	init_x11_backend(&rb, &x11, &xw, fonts[FONT_TEXT], fonts[FONT_HEADLINE]);
+	XSync(xw.display, True); // mapped, the first exposes are dropped
+	account_backend(&xAccounting, &rb, xw.display, false);
+	init_screens(&screens);
+	exposeRegion = XCreateRegion();
+
+	printf("{\n  \"display\": \"%s\",\n  \"width\": %d,\n  \"height\": %d,\n  \"frames\": %u,\n  \"scenes\": [\n",
+		DisplayString(xw.display), WINDOW_WIDTH, WINDOW_HEIGHT, frames);
+	for(U8 scene=0;scene<SCENE_COUNT;scene++) {
+		rb.clear(rb.ctx, SURFACE_WINDOW, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+		bench_draw(&rb, &screens, scene, 0); // warm up (renders the cached screens)
+		end_x_frame(&xAccounting);
+		sync_x_frame(&xAccounting);
+		memset(&xAccounting.total, 0, sizeof(xAccounting.total));
+		xAccounting.frames = 0;
+
+		total = 0;
+		for(U32 i=0;i<frames;i++) {
+			start = now_ns();
+			bench_draw(&rb, &screens, scene, i);
+			end_x_frame(&xAccounting);
+			sync_x_frame(&xAccounting);
+			times[i] = now_ns() - start;
+			total += times[i];
+		}
+		traffic = xAccounting.total;
+		qsort(times, frames, sizeof(*times), bench_compare_ns);
+
+		printf("    {\"name\": \"%s\", \"fps\": %.1f, ", sceneNames[scene], total > 0 ? frames * 1e9 / total : 0.0);
+		printf("\"ms_per_frame\": {\"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f}, ",
+			total / 1e6 / frames, times[(frames - 1) / 2] / 1e6, times[(frames - 1) * 90 / 100] / 1e6, times[(frames - 1) * 99 / 100] / 1e6, times[frames - 1] / 1e6);
+		printf("\"requests_per_frame\": %.1f, \"bytes_per_frame\": %.0f, \"round_trips_per_frame\": %.3f, ",
+			(double)traffic.requests / frames, (double)traffic.bytes / frames, (double)traffic.roundTrips / frames);
+		printf("\"p99_within_%dhz\": %s}%s\n", BENCH_TARGET_HZ, (times[(frames - 1) * 99 / 100] <= 1000000000L / BENCH_TARGET_HZ) ? "true" : "false", (scene + 1 < SCENE_COUNT) ? "," : "");
+	}
+	printf("  ]\n}\n");
+
+	free_screens(&rb, &screens);
+	XDestroyRegion(exposeRegion);
+	free_x11_backend(&x11);
+	for(U8 i=0;i<FONT_COUNT;i++) {
+		XftFontClose(xw.display, fonts[i]);
+	}
+free_gc:
+	XFreeGC(xw.display, xw.gc);
+destroy_window:
+	join_font_loader();
+	XDestroyWindow(xw.display, xw.window);
+	XCloseDisplay(xw.display);
+free_times:
+	free(times);
+	return status;
+}
+
+/**
+ * @brief Draws the frames of an effect until it ended and checks where it stopped.
+ *
+ * @param rb The render backend.
+ * @param headless The headless backend behind `rb`.
+ * @param screens The screen cache.
+ * @param name Name of the effect in the report.
+ * @param prev The frame that is visible in the window.
+ * @param cur The frame that starts the effect, only its tick advances while the effect runs.
+ * @param framesPerTick Frames drawn per simulation tick (the effect has to take as many ticks).
+ * @param expected Checksum of the window once the effect ended.
+ * @return `true` if the window ended on the expected checksum.
+ */
+static bool bench_anim_effect(RenderBackend *rb, HeadlessBackend *headless, ScreenCache *screens, const char *name, const Frame *prev, const Frame *cur, U32 framesPerTick, U32 expected) {
+	Animations anims;
+	Frame next = *cur;
+	U32 frames = 0, checksum;
+	U64 pixels = 0;
+	I64 start, elapsed = 0;
+
+	init_animations(&anims, prev);
+	needsRedraw = 1; // the window starts with the previous frame
+	render_frame(rb, screens, NULL, prev, prev);
+
+	render_frame(rb, screens, &anims, prev, cur);
+	frames++;
+	while(anims.count > 0) {
+		headless->pixelsWritten = 0;
+		next.tick += (frames % framesPerTick == 0);
+		start = now_ns();
+		render_frame(rb, screens, &anims, cur, &next);
+		elapsed += now_ns() - start;
+		pixels += headless->pixelsWritten;
+		frames++;
+	}
+
+	checksum = checksum_surface(headless, SURFACE_WINDOW);
+	printf("%-12s %3u Hz %6u frames %4lu ticks %10ld ns/frame %10lu pixels/frame  %s\n", name, framesPerTick * TICK_RATE, frames, (unsigned long)(next.tick - cur->tick + 1),
+		elapsed / (frames - 1), (unsigned long)(pixels / (frames - 1)),
+		(checksum == expected) ? "ends on the plain frame" : "ends on a wrong frame");
+	return checksum == expected;
+}
+
+/**
+ * @brief Runs the line clear, lock and game over effects and checks that each ends on the frame drawn without them.
+ *
+ * @return `0` if every effect ended on the plain frame, `-1` otherwise.
+ */
+static int bench_anim(void) {
+	RenderBackend rb;
+	HeadlessBackend headless;
+	ScreenCache screens;
+	Frame before, cleared, locked, over;
+	U16 shape;
+	U32 expected;
+	bool passed = true;
+
+	if(init_headless_backend(&rb, &headless, WINDOW_WIDTH, WINDOW_HEIGHT) != 0) {
+		return -1;
+	}
+	init_screens(&screens);
+	exposeRegion = XCreateRegion();
+
+	// two rows removed, the falling piece spawned while the rows flash
+	bench_line_clear(&before, &cleared);
+	cleared.hasPiece = true;
+	needsRedraw = 1;
+	headless.pixelsWritten = 0;
+	render_frame(&rb, &screens, NULL, &cleared, &cleared);
+	printf("%-12s %41s %10lu pixels/frame\n", "full redraw", "", (unsigned long)headless.pixelsWritten);
+	expected = checksum_surface(&headless, SURFACE_WINDOW);
+	passed &= bench_anim_effect(&rb, &headless, &screens, "line clear", &before, &cleared, 1, expected);
+	passed &= bench_anim_effect(&rb, &headless, &screens, "line clear", &before, &cleared, BENCH_FRAMES_PER_TICK, expected);
+
+	// the piece locked on top of the stack without removing a row
+	locked = cleared;
+	locked.piece.row = BOARD_HEIGHT / 2 - 2;
+	shape = locked.piece.rotations[locked.piece.rotationState];
+	for(U8 i=0;i<4;i++) {
+		for(U8 j=0;j<4;j++) {
+			if(shape & (1 << (i * 4 + j))) {
+				locked.board.state[locked.piece.col + j][locked.piece.row + i] = 1;
+				locked.board.colors[locked.piece.row + i] |= (U32)(locked.piece.type + 1) << ((locked.piece.col + j) * CELL_COLOR_BITS);
+			}
+		}
+	}
+	locked.lastLock = (LockEvent){cleared.lastLock.count + 1, {0}, {0}, 0, locked.piece.type, locked.piece.rotationState, locked.piece.col, locked.piece.row, false};
+	locked.piece.row = 0;
+	locked.boardVersion++;
+	needsRedraw = 1;
+	render_frame(&rb, &screens, NULL, &locked, &locked);
+	expected = checksum_surface(&headless, SURFACE_WINDOW);
+	passed &= bench_anim_effect(&rb, &headless, &screens, "lock", &cleared, &locked, 1, expected);
+	passed &= bench_anim_effect(&rb, &headless, &screens, "lock", &cleared, &locked, BENCH_FRAMES_PER_TICK, expected);
+
+	// the game ended, the board fills up before the end screen
+	over = locked;
+	over.state = STATE_GAME_OVER;
+	over.hasPiece = false;
+	draw_screen(&rb, &screens, SCREEN_GAME_OVER);
+	expected = checksum_surface(&headless, SURFACE_WINDOW);
+	passed &= bench_anim_effect(&rb, &headless, &screens, "game over", &locked, &over, 1, expected);
+	passed &= bench_anim_effect(&rb, &headless, &screens, "game over", &locked, &over, BENCH_FRAMES_PER_TICK, expected);
+
+	free_screens(&rb, &screens);
+	XDestroyRegion(exposeRegion);
+	free_headless_backend(&headless);
+	return passed ? 0 : -1;
+}
+
+/**
+ * @brief Plays grids of bot games and reports the frame time as a function of the board count.
+ *
+ * The games are stepped by the worker pool and drawn with the headless backend on every tick,
+ * the simulation and the drawing are timed separately. The first frame of a count is a full
+ * redraw, the others only draw the boards that changed.
+ *
+ * @return `0` if every count ran, `-1` otherwise.
+ */
+static int bench_grid(void) {
+	static const U16 counts[] = {1, 4, 9, 16, 36, 64};
+	static I64 frameNs[BENCH_GRID_TICKS];
+	RenderBackend rb;
+	HeadlessBackend headless;
+	Grid grid;
+	Options options = {0};
+	I64 start, simNs, drawNs, fullNs;
+	U64 pixels, boards, pieces, lines;
+
+	if(init_headless_backend(&rb, &headless, WINDOW_WIDTH, WINDOW_HEIGHT) != 0) {
+		return -1;
+	}
+	exposeRegion = XCreateRegion();
+	options.dasMs = DEFAULT_DAS_MS;
+	options.arrMs = DEFAULT_ARR_MS;
+	options.seed = BENCH_GRID_SEED;
+
+	printf("%-6s %4s %7s %10s %10s %10s %10s %12s %13s %14s %8s %8s\n", "boards", "cell", "workers", "sim ms", "draw ms", "frame ms", "frame p99", "full draw ms", "boards/frame", "pixels/frame", "pieces", "lines");
+	for(U8 n=0;n<sizeof(counts)/sizeof(counts[0]);n++) {
+		if(init_grid(&grid, counts[n], &options, 0) != 0) {
+			return -1;
+		}
+		start = now_ns();
+		(void)render_grid(&rb, &grid, true);
+		fullNs = now_ns() - start;
+
+		simNs = drawNs = 0;
+		pixels = boards = 0;
+		for(U32 t=0;t<BENCH_GRID_TICKS;t++) {
+			start = now_ns();
+			step_grid(&grid);
+			frameNs[t] = now_ns() - start;
+			simNs += frameNs[t];
+
+			headless.pixelsWritten = 0;
+			start = now_ns();
+			boards += render_grid(&rb, &grid, false);
+			frameNs[t] += now_ns() - start;
+			drawNs += now_ns() - start;
+			pixels += headless.pixelsWritten;
+		}
+		qsort(frameNs, BENCH_GRID_TICKS, sizeof(I64), bench_compare_ns);
+
+		pieces = lines = 0;
+		for(U16 i=0;i<grid.count;i++) {
+			pieces += grid.games[i].metrics.piecesPlaced;
+			for(U8 k=0;k<METRICS_LINE_SIZES;k++) {
+				lines += grid.games[i].metrics.linesCleared[k] * (k + 1);
+			}
+		}
+		printf("%-6u %4u %7u %10.3f %10.3f %10.3f %10.3f %12.3f %13.1f %14lu %8lu %8lu\n", grid.count, grid.layouts[0].cell, grid.pool.count + 1,
+			simNs / 1e6 / BENCH_GRID_TICKS, drawNs / 1e6 / BENCH_GRID_TICKS, (simNs + drawNs) / 1e6 / BENCH_GRID_TICKS,
+			frameNs[BENCH_GRID_TICKS * 99 / 100] / 1e6, fullNs / 1e6, (double)boards / BENCH_GRID_TICKS, (unsigned long)(pixels / BENCH_GRID_TICKS), (unsigned long)pieces, (unsigned long)lines);
+		free_grid(&grid);
+	}
+
+	XDestroyRegion(exposeRegion);
+	free_headless_backend(&headless);
+	return 0;
+}
+
+/**
+ * @brief Fills the batches for the evaluation benchmark.
+ *
+ * The first half are the boards after every move of a random Tetromino on messy boards, like
+ * the bots see them. The second half are random stacks of any height, including empty and
+ * nearly full boards, so the edge cases of the kernels are covered.
+ */
+static void bench_eval_batches(EvalBatch *batches) {
+	static MoveList list;
+	GameBoard board;
+	Rng rng;
+	U16 start[BOARD_HEIGHT], rows[BOARD_HEIGHT];
+	U32 b = 0, m = 0;
+	U8 top;
+
+	init_rng(&rng, RNG_COUNTER, BENCH_EVAL_SEED);
+	memset(batches, 0, BENCH_EVAL_BATCHES * sizeof(EvalBatch));
+	while(b < BENCH_EVAL_BATCHES / 2) {
+		if(m == list.count) {
+			bench_messy_board(&rng, &board);
+			board_rows(&board, start);
+			(void)generate_moves(&board, rng_below(&rng, TETROMINO_TYPES), &list);
+			m = 0;
+			continue;
+		}
+		memcpy(rows, start, sizeof(rows));
+		(void)place_rows(rows, &list.moves[m++].placement);
+		for(U8 y=0;y<BOARD_HEIGHT;y++) {
+			batches[b].rows[y][batches[b].count] = rows[y];
+		}
+		b += (++batches[b].count == EVAL_BATCH);
+	}
+	for(;b<BENCH_EVAL_BATCHES;b++) {
+		for(U8 i=0;i<EVAL_BATCH;i++) {
+			top = rng_below(&rng, BOARD_HEIGHT + 1);
+			for(U8 y=top;y<BOARD_HEIGHT;y++) {
+				batches[b].rows[y][i] = rng_below(&rng, EVAL_FULL_ROW); // never a full row
+			}
+		}
+		batches[b].count = EVAL_BATCH;
+	}
+}
+
+/**
+ * @brief Checks the vector kernels of the board evaluation against the scalar reference and measures them.
+ *
+ * @return `0` if every kernel this CPU supports gave the same features as the reference, `-1` otherwise.
+ */
+static int bench_eval(void) {
+	static const char *names[EVAL_KERNELS] = {"scalar", "sse2", "avx2"};
+	static EvalBatch batches[BENCH_EVAL_BATCHES];
+	static EvalFeatures reference[BENCH_EVAL_BATCHES];
+	EvalFeatures features;
+	I64 start, elapsed;
+	U32 mismatches, failed = 0;
+	U64 sum;
+
+	bench_eval_batches(batches);
+	for(U32 b=0;b<BENCH_EVAL_BATCHES;b++) {
+		evaluate_batch_scalar(&batches[b], &reference[b]);
+	}
+	printf("eval: %d boards, %d after moves on messy boards and %d random stacks, the bots use %s\n",
+		BENCH_EVAL_BATCHES * EVAL_BATCH, BENCH_EVAL_BATCHES * EVAL_BATCH / 2, BENCH_EVAL_BATCHES * EVAL_BATCH / 2, names[eval_kernel()]);
+
+	for(U8 k=0;k<EVAL_KERNELS;k++) {
+		if(!eval_kernel_supported(k)) {
+			printf("%-8s not supported by this CPU or build\n", names[k]);
+			continue;
+		}
+
+		mismatches = 0;
+		sum = 0;
+		start = now_ns();
+		for(U32 pass=0;pass<BENCH_EVAL_PASSES;pass++) {
+			for(U32 b=0;b<BENCH_EVAL_BATCHES;b++) {
+				switch(k) {
+#if EVAL_X86
+					case EVAL_SSE2:
+						evaluate_batch_sse2(&batches[b], &features);
+						break;
+					case EVAL_AVX2:
+						evaluate_batch_avx2(&batches[b], &features);
+						break;
+#endif
+					default:
+						evaluate_batch_scalar(&batches[b], &features);
+						break;
+				}
+				sum += features.holes[b % EVAL_BATCH]; // keeps the work
+				if(pass == 0) {
+					mismatches += (memcmp(&features, &reference[b], sizeof(features)) != 0);
+				}
+			}
+		}
+		elapsed = now_ns() - start;
+		failed += mismatches;
+
+		printf("%-8s %12.0f boards/s %8.2f ns/board  %u of %d batches differ from the reference (checksum %lu)\n", names[k],
+			(double)BENCH_EVAL_PASSES * BENCH_EVAL_BATCHES * EVAL_BATCH / (elapsed / 1e9), (double)elapsed / ((U64)BENCH_EVAL_PASSES * BENCH_EVAL_BATCHES * EVAL_BATCH),
+			mismatches, BENCH_EVAL_BATCHES, (unsigned long)sum);
+	}
+	return (failed == 0) ? 0 : -1;
+}
+
+/**
+ * @brief Prints the usage of the benchmark.
+ *
+ * @param name Name of the executable.
+ */
+static void bench_usage(const char *name) {
+	printf("Usage: %s [options]\n", name);
+	printf("Renders every scene with the headless backend and reports the draw cost per frame.\n\n");
+	printf("  --frames <n>      Frames per scene (default: %d)\n", BENCH_DEFAULT_FRAMES);
+	printf("  --ppm <dir>       Write the last frame of every scene as <dir>/<scene>.ppm\n");
+	printf("  --reference <dir> Compare the last frames with <dir>/<scene>.ppm, fails on any difference\n");
+	printf("  --x11             Render the scenes on the X server of DISPLAY instead (e.g. Xvfb), prints JSON\n");
+	printf("  --solver          Benchmark the perfect clear solver instead, every solution is played back\n");
+	printf("  --movegen         Benchmark the move generator on messy boards instead, every move is played back\n");
+	printf("  --rewind          Play games with random inputs and take every placement back instead\n");
+	printf("  --shm             Run the shared memory interface against a forked bot process instead\n");
+	printf("  --grid            Play grids of 1 to 64 bot games instead, reports the frame time by board count\n");
+	printf("  --eval            Check the vector kernels of the board evaluation against the scalar one and measure them instead\n");
+	printf("  --input           Check how far the piece falls on the ticks around a held down key instead\n");
+	printf("  --anim            Run the line clear, lock and game over effects instead, each has to end on the plain frame\n");
+	printf("  --help, -h        Show this help\n");
+}
+
+/**
+ * @brief Benchmarks the rendering without an X server and checks it against reference frames.
+ *
+ * Every scene is drawn `--frames` times into the headless backend, the time and the written pixels
+ * per frame are reported together with a checksum of the last frame. With `--reference` the last
+ * frames are compared pixel by pixel with previously written PPM images.
+ */
+int main(int argc, char **argv) {
+	RenderBackend rb;
+	HeadlessBackend headless;
+	ScreenCache screens;
+	U32 frames = BENCH_DEFAULT_FRAMES;
+	const char *ppmDir = NULL;
+	const char *referenceDir = NULL;
+	bool x11 = false;
+	char path[BENCH_PATH_LENGTH];
+	I64 start, elapsed, differences;
+	U64 pixels;
+	int failed = 0;
+
+	for(int i=1;i<argc;i++) {
+		if(strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+			frames = strtoul(argv[++i], NULL, 10);
+		} else if(strcmp(argv[i], "--ppm") == 0 && i + 1 < argc) {
+			ppmDir = argv[++i];
+		} else if(strcmp(argv[i], "--reference") == 0 && i + 1 < argc) {
+			referenceDir = argv[++i];
+		} else if(strcmp(argv[i], "--x11") == 0) {
+			x11 = true;
+		} else if(strcmp(argv[i], "--solver") == 0) {
+			return bench_solver();
+		} else if(strcmp(argv[i], "--movegen") == 0) {
+			return bench_movegen();
+		} else if(strcmp(argv[i], "--rewind") == 0) {
+			return bench_rewind();
+		} else if(strcmp(argv[i], "--shm") == 0) {
+			return bench_shm();
+		} else if(strcmp(argv[i], "--grid") == 0) {
+			return bench_grid();
+		} else if(strcmp(argv[i], "--eval") == 0) {
+			return bench_eval();
+		} else if(strcmp(argv[i], "--input") == 0) {
+			return bench_input();
+		} else if(strcmp(argv[i], "--anim") == 0) {
+			return bench_anim();
+		} else {
+			bench_usage(argv[0]);
+			return (strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) ? 0 : -1;
+		}
+	}
+	if(frames == 0) {
+		frames = 1;
+	}
+	if(x11) {
+		return bench_x11(frames);
+	}
+
+	if(init_headless_backend(&rb, &headless, WINDOW_WIDTH, WINDOW_HEIGHT) != 0) {
+		return -1;
+	}
+	init_screens(&screens);
+	exposeRegion = XCreateRegion();
+
+	printf("%-12s %12s %14s %10s\n", "scene", "ns/frame", "pixels/frame", "checksum");
+	for(U8 scene=0;scene<SCENE_COUNT;scene++) {
+		// every scene starts on a cleared window
+		rb.clear(rb.ctx, SURFACE_WINDOW, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+		bench_draw(&rb, &screens, scene, 0); // warm up (renders the cached screens)
+		headless.pixelsWritten = 0;
+
+		start = now_ns();
+		for(U32 i=0;i<frames;i++) {
+			bench_draw(&rb, &screens, scene, i);
+		}
+		elapsed = now_ns() - start;
+		pixels = headless.pixelsWritten;
+
+		// the checked frame must not depend on the number of frames
+		rb.clear(rb.ctx, SURFACE_WINDOW, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+		bench_draw(&rb, &screens, scene, 0);
+
+		printf("%-12s %12ld %14lu %10x", sceneNames[scene], elapsed / frames, pixels / frames, checksum_surface(&headless, SURFACE_WINDOW));
+
+		if(ppmDir != NULL) {
+			snprintf(path, sizeof(path), "%s/%s.ppm", ppmDir, sceneNames[scene]);
+			if(write_ppm(&headless, SURFACE_WINDOW, path) != 0) {
+				failed = 1;
+			}
+		}
+
+		if(referenceDir != NULL) {
+			snprintf(path, sizeof(path), "%s/%s.ppm", referenceDir, sceneNames[scene]);
+			differences = compare_ppm(&headless, SURFACE_WINDOW, path);
+			if(differences != 0) {
+				failed = 1;
+			}
+			if(differences < 0) {
+				printf("  no reference");
+			} else {
+				printf("  %ld pixels differ", differences);
+			}
+		}
+		printf("\n");
+	}
+
+	free_screens(&rb, &screens);
+	XDestroyRegion(exposeRegion);
+	free_headless_backend(&headless);
+	return failed ? -1 : 0;
+}
+#endif
@@ -0,0 +1,151 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include "bot.h"
+
+/**
+ * @brief Starts a bot that has nothing planned yet.
+ *
+ * @param bot The bot.
+ */
+void init_bot(Bot *bot) {
+	memset(bot, 0, sizeof(*bot));
+	bot->seen = STATE_START;
+}
+
+/**
+ * @brief Scores the evaluated boards of a batch and keeps the best.
+ *
+ * @param batch The boards after their placements.
+ * @param lines Rows the placement of every board removed.
+ * @param moves The move of every board.
+ * @param best The best move so far, updated.
+ * @param bestScore Its score, updated.
+ */
+static void score_batch(const EvalBatch *batch, const U8 lines[EVAL_BATCH], const Move *moves[EVAL_BATCH], const Move **best, I32 *bestScore) {
+	EvalFeatures features;
+	I32 score;
+
+	evaluate_batch(batch, &features);
+	for(U8 i=0;i<batch->count;i++) {
+		score = BOT_WEIGHT_LINES * lines[i] + BOT_WEIGHT_HEIGHT * features.height[i] + BOT_WEIGHT_HOLES * features.holes[i]
+			+ BOT_WEIGHT_BUMPINESS * features.bumpiness[i] + BOT_WEIGHT_WELLS * features.wells[i] + BOT_WEIGHT_ROW_TRANSITIONS * features.rowTransitions[i];
+		if(*best == NULL || score > *bestScore) {
+			*best = moves[i];
+			*bestScore = score;
+		}
+	}
+}
+
+/**
+ * @brief Picks the move with the best evaluation.
+ *
+ * The boards after the moves are collected into batches of `EVAL_BATCH` and evaluated together
+ * (see `evaluate_batch`). Moves with a soft drop are skipped: the bot sends one input every few
+ * ticks, meanwhile the Tetromino falls, so a tuck timed for a certain row would not work out.
+ * Ties go to the move with fewer inputs (the list is in order of input count).
+ *
+ * @param board The board the moves were generated on.
+ * @param list The moves of `generate_moves`.
+ * @return The best move, `NULL` if there is none.
+ */
+const Move *choose_move(const GameBoard *board, const MoveList *list) {
+	EvalBatch batch;
+	U16 start[BOARD_HEIGHT], rows[BOARD_HEIGHT];
+	U8 lines[EVAL_BATCH];
+	const Move *moves[EVAL_BATCH];
+	const Move *best = NULL;
+	I32 bestScore = 0;
+
+	memset(&batch, 0, sizeof(batch));
+	board_rows(board, start);
+	for(U16 m=0;m<list->count;m++) {
+		if(memchr(list->moves[m].inputs, KEY_DOWN, list->moves[m].length) != NULL) {
+			continue;
+		}
+		memcpy(rows, start, sizeof(rows));
+		lines[batch.count] = place_rows(rows, &list->moves[m].placement);
+		for(U8 y=0;y<BOARD_HEIGHT;y++) {
+			batch.rows[y][batch.count] = rows[y];
+		}
+		moves[batch.count++] = &list->moves[m];
+
+		if(batch.count == EVAL_BATCH) {
+			score_batch(&batch, lines, moves, &best, &bestScore);
+			batch.count = 0;
+		}
+	}
+	if(batch.count > 0) {
+		score_batch(&batch, lines, moves, &best, &bestScore);
+	}
+	return best;
+}
+
+/**
+ * @brief Queues a key press and its release.
+ */
+static void press_key(Bot *bot, KeyAction action) {
+	(void)push_input(&bot->queue, &(InputEvent){action, true, 0});
+	(void)push_input(&bot->queue, &(InputEvent){action, false, 0});
+}
+
+/**
+ * @brief Lets the bot play one tick, called right before `step_game` with the bot's queue.
+ *
+ * A new Tetromino gets its move planned at once, its inputs are then sent one every
+ * `BOT_INPUT_TICKS`. A finished game stays on screen for `BOT_RESTART_TICKS` before the
+ * next one is started.
+ *
+ * @param bot The bot.
+ * @param game The game it plays.
+ */
+void bot_tick(Bot *bot, Game *game) {
+	MoveList list;
+	const Move *move;
+
+	if(game->state != bot->seen) {
+		bot->seen = game->state;
+		bot->wait = (game->state == STATE_GAME_OVER) ? BOT_RESTART_TICKS : 0;
+	}
+
+	switch(game->state) {
+		case STATE_START:
+		case STATE_GAME_OVER:
+			if(bot->wait > 0) {
+				bot->wait--;
+			} else {
+				press_key(bot, KEY_ANY);
+				bot->wait = BOT_RESTART_TICKS; // until the key was taken
+			}
+			break;
+
+		case STATE_GAME:
+			if(game->current == NULL) {
+				bot->planned = false;
+				break;
+			}
+			if(!bot->planned) {
+				(void)generate_moves(&game->board, game->current->type, &list);
+				if((move = choose_move(&game->board, &list)) != NULL) {
+					memcpy(bot->inputs, move->inputs, move->length);
+					bot->length = move->length;
+				} else {
+					bot->inputs[0] = KEY_SPACE; // nowhere to go, the game is about to end
+					bot->length = 1;
+				}
+				bot->next = 0;
+				bot->wait = BOT_INPUT_TICKS;
+				bot->planned = true;
+			}
+			if(bot->wait > 0) {
+				bot->wait--;
+			} else if(bot->next < bot->length) {
+				press_key(bot, bot->inputs[bot->next++]);
+				bot->wait = BOT_INPUT_TICKS;
+			}
+			break;
+
+		default:
+			break;
+	}
+}
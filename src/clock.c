@@ -0,0 +1,23 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include "clock.h"
+
+/**
+ * @brief Returns the monotonic clock in nanoseconds, the time base of `Frame.time`.
+ */
+I64 now_ns(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (I64)now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+/**
+ * @brief Sleeps until a point in time of `now_ns`, returns at once if it passed.
+ */
+void sleep_until_ns(I64 when) {
+	struct timespec deadline = {when / 1000000000L, when % 1000000000L};
+
+	clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+}
@@ -0,0 +1,282 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include "eval.h"
+
+typedef void (*EvalFunction)(const EvalBatch *batch, EvalFeatures *features);
+
+static EvalFunction selected = NULL; // the kernel of `evaluate_batch`, chosen on first use
+
+/**
+ * @brief Converts a board into row masks, bit `x` for column `x`.
+ *
+ * @param board The board.
+ * @param rows Receives the rows, top row first.
+ */
+void board_rows(const GameBoard *board, U16 rows[BOARD_HEIGHT]) {
+	for(U8 y=0;y<BOARD_HEIGHT;y++) {
+		rows[y] = 0;
+		for(U8 x=0;x<BOARD_WIDTH;x++) {
+			rows[y] |= (U16)(board->state[x][y] != 0) << x;
+		}
+	}
+}
+
+/**
+ * @brief Adds a Tetromino to row masks and removes the full rows, the rows above fall down.
+ *
+ * @param rows The rows of the board, changed in place.
+ * @param placement Where the Tetromino locks (inside the board).
+ * @return The number of removed rows.
+ */
+U8 place_rows(U16 rows[BOARD_HEIGHT], const Placement *placement) {
+	U16 shape = tetrominos[placement->type % TETROMINO_TYPES].rotations[placement->rotationState % 4];
+	U8 lines = 0, kept = BOARD_HEIGHT;
+
+	for(U8 i=0;i<4;i++) {
+		for(U8 j=0;j<4;j++) {
+			if(shape & (1 << (i * 4 + j))) {
+				rows[placement->row + i] |= 1 << (placement->col + j);
+			}
+		}
+	}
+
+	for(I8 y=BOARD_HEIGHT-1;y>=0;y--) {
+		if(rows[y] == EVAL_FULL_ROW) {
+			lines++;
+		} else {
+			rows[--kept] = rows[y];
+		}
+	}
+	for(U8 y=0;y<kept;y++) {
+		rows[y] = 0;
+	}
+	return lines;
+}
+
+/**
+ * @brief Whether the cell in column `x` and row `y` of a board of the batch is filled, the walls are.
+ */
+static bool filled(const EvalBatch *batch, U8 board, I8 x, U8 y) {
+	return x < 0 || x >= BOARD_WIDTH || (batch->rows[y][board] & (1 << x)) != 0;
+}
+
+/**
+ * @brief Evaluates the boards cell by cell, the reference of the vector kernels.
+ *
+ * Follows the definitions of the features in `EvalFeatures` column by column, without any of
+ * the mask tricks of the kernels.
+ *
+ * @param batch The boards.
+ * @param features Receives the features of all `EVAL_BATCH` lanes.
+ */
+void evaluate_batch_scalar(const EvalBatch *batch, EvalFeatures *features) {
+	U8 heights[BOARD_WIDTH];
+	U8 top;
+
+	for(U8 i=0;i<EVAL_BATCH;i++) {
+		features->height[i] = features->holes[i] = features->bumpiness[i] = features->wells[i] = features->rowTransitions[i] = 0;
+
+		for(U8 x=0;x<BOARD_WIDTH;x++) {
+			for(top=0;top<BOARD_HEIGHT && !filled(batch, i, x, top);top++);
+			heights[x] = BOARD_HEIGHT - top;
+			features->height[i] += heights[x];
+			for(U8 y=0;y<BOARD_HEIGHT;y++) {
+				if(y > top && !filled(batch, i, x, y)) {
+					features->holes[i]++;
+				}
+				if(y < top && filled(batch, i, x - 1, y) && filled(batch, i, x + 1, y)) {
+					features->wells[i]++;
+				}
+			}
+			if(x > 0) {
+				features->bumpiness[i] += abs(heights[x] - heights[x - 1]);
+			}
+		}
+
+		for(U8 y=0;y<BOARD_HEIGHT;y++) {
+			for(I8 x=0;x<=BOARD_WIDTH;x++) {
+				features->rowTransitions[i] += filled(batch, i, x - 1, y) != filled(batch, i, x, y);
+			}
+		}
+	}
+}
+
+#if EVAL_X86
+/**
+ * @brief Counts the set bits of every 16 bit lane (SWAR, only SSE2 shifts, ANDs and adds).
+ */
+static inline __m128i popcount_epi16(__m128i v) {
+	v = _mm_sub_epi16(v, _mm_and_si128(_mm_srli_epi16(v, 1), _mm_set1_epi16(0x5555)));
+	v = _mm_add_epi16(_mm_and_si128(v, _mm_set1_epi16(0x3333)), _mm_and_si128(_mm_srli_epi16(v, 2), _mm_set1_epi16(0x3333)));
+	v = _mm_and_si128(_mm_add_epi16(v, _mm_srli_epi16(v, 4)), _mm_set1_epi16(0x0f0f));
+	return _mm_and_si128(_mm_add_epi16(v, _mm_srli_epi16(v, 8)), _mm_set1_epi16(0x001f));
+}
+
+/**
+ * @brief Evaluates 8 boards of a batch with SSE2, one board per 16 bit lane.
+ *
+ * The rows are visited from the top with the mask of the cells covered from above:
+ * - a column reaches its height where a row covers it first (`popcount * (BOARD_HEIGHT - y)`),
+ * - a hole is an empty cell that is already covered,
+ * - the columns of neighbours with different heights differ in exactly one bit of the covered
+ *   mask at as many rows as the heights differ, which sums up the bumpiness,
+ * - a well is an empty uncovered cell whose neighbours in the row (or the walls) are filled,
+ * - the row transitions are the changed bits of the row with both walls set, shifted by one.
+ */
+static void evaluate_half_sse2(const EvalBatch *batch, EvalFeatures *features, U8 offset) {
+	const __m128i full = _mm_set1_epi16(EVAL_FULL_ROW);
+	const __m128i inner = _mm_set1_epi16(EVAL_FULL_ROW >> 1);	// pairs of neighbouring columns
+	const __m128i walls = _mm_set1_epi16(1 | (1 << (BOARD_WIDTH + 1)));
+	const __m128i edges = _mm_set1_epi16((1 << (BOARD_WIDTH + 1)) - 1);
+	const __m128i leftWall = _mm_set1_epi16(1);
+	const __m128i rightWall = _mm_set1_epi16(1 << (BOARD_WIDTH - 1));
+	__m128i above = _mm_setzero_si128(), covered, row, sides, bordered;
+	__m128i height = _mm_setzero_si128(), holes = _mm_setzero_si128(), bumpiness = _mm_setzero_si128();
+	__m128i wells = _mm_setzero_si128(), transitions = _mm_setzero_si128();
+
+	for(U8 y=0;y<BOARD_HEIGHT;y++) {
+		row = _mm_loadu_si128((const __m128i *)&batch->rows[y][offset]);
+		covered = _mm_or_si128(above, row);
+
+		height = _mm_add_epi16(height, _mm_mullo_epi16(popcount_epi16(_mm_andnot_si128(above, row)), _mm_set1_epi16(BOARD_HEIGHT - y)));
+		holes = _mm_add_epi16(holes, popcount_epi16(_mm_andnot_si128(row, above)));
+		bumpiness = _mm_add_epi16(bumpiness, popcount_epi16(_mm_and_si128(_mm_xor_si128(covered, _mm_srli_epi16(covered, 1)), inner)));
+
+		sides = _mm_and_si128(_mm_or_si128(_mm_slli_epi16(row, 1), leftWall), _mm_or_si128(_mm_srli_epi16(row, 1), rightWall));
+		wells = _mm_add_epi16(wells, popcount_epi16(_mm_andnot_si128(covered, _mm_and_si128(sides, full))));
+
+		bordered = _mm_or_si128(_mm_slli_epi16(row, 1), walls);
+		transitions = _mm_add_epi16(transitions, popcount_epi16(_mm_and_si128(_mm_xor_si128(bordered, _mm_srli_epi16(bordered, 1)), edges)));
+
+		above = covered;
+	}
+
+	_mm_storeu_si128((__m128i *)&features->height[offset], height);
+	_mm_storeu_si128((__m128i *)&features->holes[offset], holes);
+	_mm_storeu_si128((__m128i *)&features->bumpiness[offset], bumpiness);
+	_mm_storeu_si128((__m128i *)&features->wells[offset], wells);
+	_mm_storeu_si128((__m128i *)&features->rowTransitions[offset], transitions);
+}
+
+/**
+ * @brief Evaluates the boards with SSE2, in two halves of 8 boards.
+ *
+ * @param batch The boards.
+ * @param features Receives the features of all `EVAL_BATCH` lanes.
+ */
+void evaluate_batch_sse2(const EvalBatch *batch, EvalFeatures *features) {
+	for(U8 offset=0;offset<EVAL_BATCH;offset+=8) {
+		evaluate_half_sse2(batch, features, offset);
+	}
+}
+
+/**
+ * @brief Counts the set bits of every 16 bit lane, AVX2 version of `popcount_epi16`.
+ */
+__attribute__((target("avx2"))) static inline __m256i popcount256_epi16(__m256i v) {
+	v = _mm256_sub_epi16(v, _mm256_and_si256(_mm256_srli_epi16(v, 1), _mm256_set1_epi16(0x5555)));
+	v = _mm256_add_epi16(_mm256_and_si256(v, _mm256_set1_epi16(0x3333)), _mm256_and_si256(_mm256_srli_epi16(v, 2), _mm256_set1_epi16(0x3333)));
+	v = _mm256_and_si256(_mm256_add_epi16(v, _mm256_srli_epi16(v, 4)), _mm256_set1_epi16(0x0f0f));
+	return _mm256_and_si256(_mm256_add_epi16(v, _mm256_srli_epi16(v, 8)), _mm256_set1_epi16(0x001f));
+}
+
+/**
+ * @brief Evaluates all 16 boards at once with AVX2, the same steps as `evaluate_half_sse2`.
+ *
+ * @param batch The boards.
+ * @param features Receives the features of all `EVAL_BATCH` lanes.
+ */
+__attribute__((target("avx2"))) void evaluate_batch_avx2(const EvalBatch *batch, EvalFeatures *features) {
+	const __m256i full = _mm256_set1_epi16(EVAL_FULL_ROW);
+	const __m256i inner = _mm256_set1_epi16(EVAL_FULL_ROW >> 1);
+	const __m256i walls = _mm256_set1_epi16(1 | (1 << (BOARD_WIDTH + 1)));
+	const __m256i edges = _mm256_set1_epi16((1 << (BOARD_WIDTH + 1)) - 1);
+	const __m256i leftWall = _mm256_set1_epi16(1);
+	const __m256i rightWall = _mm256_set1_epi16(1 << (BOARD_WIDTH - 1));
+	__m256i above = _mm256_setzero_si256(), covered, row, sides, bordered;
+	__m256i height = _mm256_setzero_si256(), holes = _mm256_setzero_si256(), bumpiness = _mm256_setzero_si256();
+	__m256i wells = _mm256_setzero_si256(), transitions = _mm256_setzero_si256();
+
+	for(U8 y=0;y<BOARD_HEIGHT;y++) {
+		row = _mm256_loadu_si256((const __m256i *)batch->rows[y]);
+		covered = _mm256_or_si256(above, row);
+
+		height = _mm256_add_epi16(height, _mm256_mullo_epi16(popcount256_epi16(_mm256_andnot_si256(above, row)), _mm256_set1_epi16(BOARD_HEIGHT - y)));
+		holes = _mm256_add_epi16(holes, popcount256_epi16(_mm256_andnot_si256(row, above)));
+		bumpiness = _mm256_add_epi16(bumpiness, popcount256_epi16(_mm256_and_si256(_mm256_xor_si256(covered, _mm256_srli_epi16(covered, 1)), inner)));
+
+		sides = _mm256_and_si256(_mm256_or_si256(_mm256_slli_epi16(row, 1), leftWall), _mm256_or_si256(_mm256_srli_epi16(row, 1), rightWall));
+		wells = _mm256_add_epi16(wells, popcount256_epi16(_mm256_andnot_si256(covered, _mm256_and_si256(sides, full))));
+
+		bordered = _mm256_or_si256(_mm256_slli_epi16(row, 1), walls);
+		transitions = _mm256_add_epi16(transitions, popcount256_epi16(_mm256_and_si256(_mm256_xor_si256(bordered, _mm256_srli_epi16(bordered, 1)), edges)));
+
+		above = covered;
+	}
+
+	_mm256_storeu_si256((__m256i *)features->height, height);
+	_mm256_storeu_si256((__m256i *)features->holes, holes);
+	_mm256_storeu_si256((__m256i *)features->bumpiness, bumpiness);
+	_mm256_storeu_si256((__m256i *)features->wells, wells);
+	_mm256_storeu_si256((__m256i *)features->rowTransitions, transitions);
+}
+#endif
+
+/**
+ * @brief Whether a kernel can run on this CPU.
+ *
+ * @param kernel The kernel.
+ * @return `true` if it was built and the CPU has its instructions.
+ */
+bool eval_kernel_supported(EvalKernel kernel) {
+	switch(kernel) {
+		case EVAL_SCALAR:
+			return true;
+#if EVAL_X86
+		case EVAL_SSE2:
+			return __builtin_cpu_supports("sse2");
+		case EVAL_AVX2:
+			return __builtin_cpu_supports("avx2");
+#endif
+		default:
+			return false;
+	}
+}
+
+/**
+ * @brief Returns the fastest kernel this CPU supports, the one `evaluate_batch` uses.
+ */
+EvalKernel eval_kernel(void) {
+	return eval_kernel_supported(EVAL_AVX2) ? EVAL_AVX2 : eval_kernel_supported(EVAL_SSE2) ? EVAL_SSE2 : EVAL_SCALAR;
+}
+
+/**
+ * @brief Evaluates a batch of boards with the fastest kernel, all kernels give the same features.
+ *
+ * The kernel is chosen on the first call, any thread may make it.
+ *
+ * @param batch The boards.
+ * @param features Receives the features of all `EVAL_BATCH` lanes.
+ */
+void evaluate_batch(const EvalBatch *batch, EvalFeatures *features) {
+	EvalFunction kernel = __atomic_load_n(&selected, __ATOMIC_RELAXED);
+
+	if(kernel == NULL) {
+		switch(eval_kernel()) {
+#if EVAL_X86
+			case EVAL_AVX2:
+				kernel = evaluate_batch_avx2;
+				break;
+			case EVAL_SSE2:
+				kernel = evaluate_batch_sse2;
+				break;
+#endif
+			default:
+				kernel = evaluate_batch_scalar;
+				break;
+		}
+		__atomic_store_n(&selected, kernel, __ATOMIC_RELAXED);
+	}
+	kernel(batch, features);
+}
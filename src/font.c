@@ -0,0 +1,258 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include "font.h"
+
+// Families tried in order, the last one accepts whatever fontconfig considers closest
+static const char *fontFamilies[] = {"Nimbus Sans L", "Nimbus Sans", "DejaVu Sans", "Liberation Sans", "sans-serif"};
+#define FONT_FAMILY_COUNT (sizeof(fontFamilies) / sizeof(fontFamilies[0]))
+
+static const double fontSizes[FONT_COUNT] = {12, 62}; // in points, FONT_TEXT and FONT_HEADLINE
+
+/**
+ * @brief Font file resolved for every FontId, filled by the loader thread.
+ */
+typedef struct {
+	char file[FONT_PATH_LENGTH];	///< Empty if no font was found
+	int index;						///< Face in the file
+	bool cached;					///< Taken from the cache file instead of matched by fontconfig
+} FontFile;
+
+static pthread_t loaderThread;
+static bool loaderRunning = false;
+static char cachePath[FONT_PATH_LENGTH];
+static FontFile fontFiles[FONT_COUNT];
+
+/**
+ * @brief Finds the font file for a FontId with fontconfig, following the fallback families.
+ *
+ * This is the slow part of opening a font by name (configuration, font list and matching),
+ * it needs no display, so it can run while the window is created.
+ *
+ * @param id The font.
+ * @param file Receives the file name and face.
+ * @return `0` on success, `-1` if fontconfig knows no font at all.
+ */
+static I8 match_font(FontId id, FontFile *file) {
+	FcPattern *pattern, *match;
+	FcResult result;
+	FcChar8 *family, *path;
+	int index;
+	bool accepted;
+
+	for(U8 i=0;i<FONT_FAMILY_COUNT;i++) {
+		if((pattern = FcPatternCreate()) == NULL) {
+			return -1;
+		}
+		FcPatternAddString(pattern, FC_FAMILY, (const FcChar8 *)fontFamilies[i]);
+		FcPatternAddDouble(pattern, FC_SIZE, fontSizes[id]);
+		FcConfigSubstitute(NULL, pattern, FcMatchPattern);
+		FcDefaultSubstitute(pattern);
+		match = FcFontMatch(NULL, pattern, &result);
+		FcPatternDestroy(pattern);
+		if(match == NULL) {
+			continue;
+		}
+
+		// fontconfig always returns its closest font, only the last family takes any of them
+		accepted = FcPatternGetString(match, FC_FILE, 0, &path) == FcResultMatch;
+		if(accepted && i + 1U < FONT_FAMILY_COUNT) {
+			accepted = FcPatternGetString(match, FC_FAMILY, 0, &family) == FcResultMatch && strcasecmp((const char *)family, fontFamilies[i]) == 0;
+		}
+		if(accepted) {
+			if(FcPatternGetInteger(match, FC_INDEX, 0, &index) != FcResultMatch) {
+				index = 0;
+			}
+			snprintf(file->file, sizeof(file->file), "%s", (const char *)path);
+			file->index = index;
+			file->cached = false;
+			FcPatternDestroy(match);
+			return 0;
+		}
+		FcPatternDestroy(match);
+	}
+
+	file->file[0] = '\0';
+	return -1;
+}
+
+/**
+ * @brief Reads the font files resolved by an earlier run.
+ *
+ * Lines are `<font id> <size> <face index> <file>`, entries for other sizes
+ * or files that no longer exist are ignored.
+ */
+static void read_font_cache(void) {
+	char line[FONT_PATH_LENGTH + 64];
+	unsigned int id, version;
+	double size;
+	int index, offset;
+	FILE *cache;
+
+	if(cachePath[0] == '\0' || (cache = fopen(cachePath, "r")) == NULL) {
+		return; // first run
+	}
+
+	if(fgets(line, sizeof(line), cache) == NULL || sscanf(line, "cubes-fonts %u", &version) != 1 || version != FONT_CACHE_VERSION) {
+		fclose(cache);
+		return;
+	}
+
+	while(fgets(line, sizeof(line), cache) != NULL) {
+		line[strcspn(line, "\n")] = '\0';
+		if(sscanf(line, "%u %lf %d %n", &id, &size, &index, &offset) != 3 || id >= FONT_COUNT || size != fontSizes[id]) {
+			continue;
+		}
+		if(access(line + offset, R_OK) != 0) {
+			continue; // the font was removed, match again
+		}
+
+		snprintf(fontFiles[id].file, sizeof(fontFiles[id].file), "%s", line + offset);
+		fontFiles[id].index = index;
+		fontFiles[id].cached = true;
+	}
+	fclose(cache);
+}
+
+/**
+ * @brief Writes the resolved font files for the next start.
+ */
+static void write_font_cache(void) {
+	char data[FONT_COUNT * (FONT_PATH_LENGTH + 64) + 32];
+	int length;
+
+	if(cachePath[0] == '\0') {
+		return;
+	}
+
+	length = snprintf(data, sizeof(data), "cubes-fonts %d\n", FONT_CACHE_VERSION);
+	for(U8 id=0;id<FONT_COUNT;id++) {
+		length += snprintf(data + length, sizeof(data) - length, "%u %g %d %s\n", id, fontSizes[id], fontFiles[id].index, fontFiles[id].file);
+	}
+	submit_write(WRITE_SLOT_FONTS, cachePath, data, length, false);
+}
+
+/**
+ * @brief Loader thread: resolves the font files, from the cache if possible.
+ *
+ * @param arg Unused.
+ * @return Always `NULL`.
+ */
+static void *font_loader(void *arg) {
+	(void)arg;
+
+	read_font_cache();
+	for(U8 id=0;id<FONT_COUNT;id++) {
+		if(!fontFiles[id].cached) {
+			(void)match_font(id, &fontFiles[id]);
+		}
+	}
+	return NULL;
+}
+
+/**
+ * @brief Opens a resolved font file without matching it again.
+ *
+ * The size and the render settings (DPI, antialiasing, hinting) are still applied
+ * from the display and the fontconfig configuration.
+ *
+ * @param xw Pointer to the XWindow the font is used on.
+ * @param id The font.
+ * @return The font, `NULL` if the file could not be opened.
+ */
+static XftFont *open_font(XWindow *xw, FontId id) {
+	FcPattern *pattern, *prepared;
+	XftFont *font;
+
+	if(fontFiles[id].file[0] == '\0' || (pattern = FcPatternCreate()) == NULL) {
+		return NULL;
+	}
+	FcPatternAddString(pattern, FC_FILE, (const FcChar8 *)fontFiles[id].file);
+	FcPatternAddInteger(pattern, FC_INDEX, fontFiles[id].index);
+	FcPatternAddDouble(pattern, FC_SIZE, fontSizes[id] * viewScale); // matched at scale 1, the files are the same
+	FcConfigSubstitute(NULL, pattern, FcMatchPattern);
+	XftDefaultSubstitute(xw->display, xw->screenNumber, pattern);
+	prepared = FcFontRenderPrepare(NULL, pattern, pattern);
+	FcPatternDestroy(pattern);
+	if(prepared == NULL) {
+		return NULL;
+	}
+
+	if((font = XftFontOpenPattern(xw->display, prepared)) == NULL) {
+		FcPatternDestroy(prepared); // owned by the font on success
+	}
+	return font;
+}
+
+/**
+ * @brief Starts resolving the font files in the background.
+ *
+ * Should be called as early as possible, the fonts are picked up by `finish_font_loading`
+ * once the window exists. If the thread cannot be started the fonts are resolved there.
+ */
+void start_font_loading(void) {
+	const char *home;
+
+	memset(fontFiles, 0, sizeof(fontFiles));
+	cachePath[0] = '\0';
+	if((home = getenv("HOME")) != NULL) {
+		snprintf(cachePath, sizeof(cachePath), "%s/%s", home, FONT_CACHE_FILE_NAME);
+	}
+
+	loaderRunning = (pthread_create(&loaderThread, NULL, font_loader, NULL) == 0);
+}
+
+/**
+ * @brief Waits for the resolved font files and opens the fonts.
+ *
+ * A cached file that cannot be opened any more is matched again. Newly matched files
+ * are written to the cache in the background.
+ *
+ * @param xw Pointer to the XWindow the fonts are used on.
+ * @param fonts Receives the fonts, indexed by FontId.
+ * @return `0` on success, `-1` if a font could not be opened (nothing has to be freed).
+ */
+I8 finish_font_loading(XWindow *xw, XftFont *fonts[FONT_COUNT]) {
+	bool matched = false;
+
+	if(loaderRunning) {
+		pthread_join(loaderThread, NULL);
+		loaderRunning = false;
+	} else {
+		(void)font_loader(NULL);
+	}
+
+	for(U8 id=0;id<FONT_COUNT;id++) {
+		if((fonts[id] = open_font(xw, id)) == NULL && fontFiles[id].cached) {
+			(void)match_font(id, &fontFiles[id]);
+			fonts[id] = open_font(xw, id);
+		}
+
+		if(fonts[id] == NULL) {
+			fprintf(stderr, "Error: no usable font found (tried %s ... %s)\n", fontFamilies[0], fontFamilies[FONT_FAMILY_COUNT - 1]);
+			for(U8 i=0;i<id;i++) {
+				XftFontClose(xw->display, fonts[i]);
+			}
+			return -1;
+		}
+		matched |= !fontFiles[id].cached;
+	}
+
+	if(matched) {
+		write_font_cache();
+	}
+	return 0;
+}
+
+/**
+ * @brief Waits for a loader thread that was started but whose fonts are not picked up.
+ *
+ * Must be called before exiting on a path that skipped `finish_font_loading`, does nothing
+ * after it.
+ */
+void join_font_loader(void) {
+	if(loaderRunning) {
+		pthread_join(loaderThread, NULL);
+		loaderRunning = false;
+	}
+}
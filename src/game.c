@@ -2,53 +2,32 @@
 
 #include "game.h"
 
-U32 seed = 0;
+// precomputed tetrominos with there spective rotation values (positions are set to 0 as default)
+Tetromino tetrominos[TETROMINO_TYPES] = {
+	{0, {0x0F00, 0x2222, 0x00F0, 0x4444}, 0, 0, 0, 0x00ffff, 0},  // "I"
+	{0, {0x6600, 0x6600, 0x6600, 0x6600}, 0, 0, 0, 0xffff00, 1},  // "O"
+	{0, {0x4e00, 0x2320, 0x7200, 0x04c4}, 0, 0, 0, 0x800080, 2},  // "T"
+	{0, {0x3600, 0x0231, 0x006c, 0x8c40}, 0, 0, 0, 0x00ff00, 3},  // "S"
+	{0, {0xc600, 0x1320, 0x0063, 0x04c8}, 0, 0, 0, 0xff0000, 4},  // "Z"
+	{0, {0x8e00, 0x3220, 0x0071, 0x044c}, 0, 0, 0, 0x0000ff, 5},  // "J"
+	{0, {0x2e00, 0x2230, 0x0074, 0x0c44}, 0, 0, 0, 0xff7f00, 6}   // "L"
+};
 
 /**
- * @brief Initializes the game board by allocating memory for its state.
+ * @brief Initializes the game board for a new round.
  * 
- * Allocates a 2D array for the game board state. If memory allocation fails, 
- * it cleans up any allocated memory and returns an error code.
+ * Empties the board state and resets score and level. The state is stored inside the
+ * GameBoard, so boards can be copied as a whole (e.g. into a frame snapshot).
  * 
  * @param board Pointer to the GameBoard structure to be initialized.
- * @return `0` on success, `-1` on memory allocation failure.
+ * @param highscore The highscore of the previous rounds.
  */
-I8 init_game(GameBoard *board) {
-	if((board->state = (U8**)calloc(BOARD_HEIGHT, sizeof(U8*))) == NULL) {
-		fprintf(stderr, "Error: faild to allocate mem for game board\n");
-		return -1;
-	}
-	
-	for(I8 i=0;i<BOARD_HEIGHT;i++) {
-		if((board->state[i] = (U8*)calloc(BOARD_WIDTH, sizeof(U8))) == NULL) {
-			fprintf(stderr, "Error: faild to allocate mem for game board\n");
-			// clean up what we just allocated
-			for(I8 j=0;j<i;j++) {
-				free(board->state[j]);
-			}
-			free(board->state);
-			return -1;
-		}
-	}
-
-	return 0;
-}
-
-
-/**
- * @brief Frees the allocated memory for the game board.
- * 
- * Releases all memory allocated for the game board state to prevent memory leaks.
- * 
- * @param board Pointer to the GameBoard structure to be freed.
- */
-void free_game(GameBoard *board) {
-	for(I8 i=0;i<BOARD_HEIGHT;i++) {
-		free(board->state[i]);
-	}
-
-	free(board->state);
-	return;
+void init_game(GameBoard *board, U64 highscore) {
+	memset(board->state, 0, sizeof(board->state));
+	memset(board->colors, 0, sizeof(board->colors));
+	board->score = 0;
+	board->level = 1;
+	board->highscore = highscore;
 }
 
 /**
@@ -58,11 +37,13 @@ void free_game(GameBoard *board) {
  * rows down, and updates the score and level accordingly. Also checks for game over condition.
  * 
  * @param board Pointer to the GameBoard structure being modified.
+ * @param rowsCleared Receives the number of removed rows.
  * @return `STATE_GAME_OVER` if the game is over, otherwise `STATE_GAME`.
  */
-GameState remove_full_row(GameBoard *board) {
+GameState remove_full_row(GameBoard *board, U8 *rowsCleared) {
     bool full;
-	U8 rowsCleared = 0;
+
+	*rowsCleared = 0;
 
     // Check the top row for any blocks
     for (U8 j = 0; j < BOARD_WIDTH; j++) {
@@ -86,17 +67,19 @@ GameState remove_full_row(GameBoard *board) {
                 for (U8 j = 0; j < BOARD_WIDTH; j++) {
                     board->state[j][k] = board->state[j][k-1];
                 }
+                board->colors[k] = board->colors[k-1];
             }
 
             // Clear the top row
             for (U8 j = 0; j < BOARD_WIDTH; j++) {
                 board->state[j][0] = 0;
             }
+            board->colors[0] = 0;
 
-			rowsCleared++;
+			(*rowsCleared)++;
 
 			// the user gets 100 points
-			board->score += 100 * rowsCleared;
+			board->score += 100 * *rowsCleared;
             // After removing a row, check the same row index again
             i--;
         }
@@ -116,28 +99,25 @@ GameState remove_full_row(GameBoard *board) {
 }
 
 /**
- * @brief Allocates and returns a new Tetromino with random type and initial state.
+ * @brief Draws the type of a future Tetromino from the generator of the game.
+ *
+ * @param game Pointer to the Game.
+ * @return Index into `tetrominos`.
+ */
+static U8 random_type(Game *game) {
+	return rng_below(&game->rng, TETROMINO_TYPES);
+}
+
+/**
+ * @brief Allocates and returns a new Tetromino of the given type in its spawn state.
  * 
- * This function selects a random Tetromino from a predefined set, allocs memory for it,
- * and initializes its position and rotation state. If memory allocation fails, it returns NULL.
- * Selection based on BBS (Blum Blum Shub) PRNG
+ * Allocs memory for the Tetromino and initializes its position and rotation state.
+ * If memory allocation fails, it returns NULL.
  * 
+ * @param type Index of the shape in `tetrominos`.
  * @return Pointer to the newly allocated Tetromino structure, or `NULL` on memory allocation failure.
  */
-Tetromino *get_tetromino() {
-	// precomputed tetrominos with there spective rotation values (positions are set to 0 as default)
-	U32 randVal;
-	U16 randomIndex;
-	Tetromino tetrominos[] = {
-        	{0, {0x0F00, 0x2222, 0x00F0, 0x4444}, 0, 0, 0x00ffff},  // "I"
-        	{0, {0x6600, 0x6600, 0x6600, 0x6600}, 0, 0, 0xffff00},  // "O"
-        	{0, {0x4e00, 0x2320, 0x7200, 0x04c4}, 0, 0, 0x800080},  // "T"
-        	{0, {0x3600, 0x0231, 0x006c, 0x8c40}, 0, 0, 0x00ff00},  // "S"
-        	{0, {0xc600, 0x1320, 0x0063, 0x04c8}, 0, 0, 0xff0000},  // "Z"
-        	{0, {0x8e00, 0x3220, 0x0071, 0x044c}, 0, 0, 0x0000ff},  // "J"
-        	{0, {0x2e00, 0x2230, 0x0074, 0x0c44}, 0, 0, 0xff7f00}   // "L"
-	};
-
+Tetromino *get_tetromino(U8 type) {
 	Tetromino *newTetromino;
 
 	if((newTetromino = calloc(1, sizeof(Tetromino))) == NULL) {
@@ -145,18 +125,13 @@ Tetromino *get_tetromino() {
 		return NULL;
 	}
 
-	if(seed == 0) {
-		seed = get_seed();
-	}
-
-	randVal = random_U32(&seed);
-	randomIndex = randVal % (sizeof(tetrominos) / sizeof(Tetromino));
-	*newTetromino = tetrominos[randomIndex];
+	*newTetromino = tetrominos[type % TETROMINO_TYPES];
 
 	// Set the initial position and rotation state
-	newTetromino->X = (BOARD_OFFSET_LEFT) + BLOCKSIZE * 4;
-	newTetromino->Y = BOARD_OFFSET_TOP;
-	newTetromino->rotationState = 0;	
+	newTetromino->col = SPAWN_COLUMN;
+	newTetromino->row = 0;
+	newTetromino->fraction = 0;
+	newTetromino->rotationState = 0;
 	return newTetromino;
 }
 
@@ -177,234 +152,427 @@ void free_tetromino(Tetromino **tetromino) {
 /**
  * @brief Places a Tetromino on the game board by updating the board state.
  * 
- * Converts the Tetromino's pixel coordinates to board coordinates and updates
- * the game board state to reflect the Tetromino's current shape and position.
+ * Marks the cells covered by the Tetromino's current shape at its board position and
+ * remembers its type in the color plane.
  * 
  * @param board Pointer to the GameBoard structure where the Tetromino will be placed.
  * @param tetromino Pointer to the Tetromino structure to be placed on the board.
  */
 void place_tetromino(GameBoard *board, Tetromino *tetromino) {
-    I16 x, y;
     U16 shape = tetromino->rotations[tetromino->rotationState];
+    I8 x, y;
 
-    // Convert pixel coordinates to board coordinates
-    x = (tetromino->X / BLOCKSIZE) - 10;
-    y = (tetromino->Y-BOARD_OFFSET_TOP) / BLOCKSIZE;
-	
     for (I8 i = 0; i < 4; i++) {
         for (I8 j = 0; j < 4; j++) {
-            if ((shape & (1 << (i * 4 + j))) != 0) {
-                board->state[x + j][y + i] = 1;
+            x = tetromino->col + j;
+            y = tetromino->row + i;
+            if ((shape & (1 << (i * 4 + j))) != 0 && x >= 0 && x < BOARD_WIDTH && y >= 0 && y < BOARD_HEIGHT) {
+                board->state[x][y] = 1;
+                board->colors[y] &= ~(CELL_COLOR_MASK << (x * CELL_COLOR_BITS));
+                board->colors[y] |= (U32)(tetromino->type % TETROMINO_TYPES + 1) << (x * CELL_COLOR_BITS);
             }
         }
     }
 }
 
 /**
- * @brief Checks if the Tetromino's new position and rotation would cause a collision.
+ * @brief Checks if a Tetromino would collide with the walls, the floor or placed blocks.
  *
- * This function verifies whether a Tetromino's new position or rotation would cause a collision
- * with the boundaries of the game board or with existing blocks. It returns a status code indicating
- * the type of collision, if any.
+ * A Tetromino that is between two rows (`fraction > 0`) covers the cells of both.
  *
  * @param board Pointer to the GameBoard structure.
  * @param tetromino Pointer to the Tetromino structure to be checked.
- * @param newX The new X coordinate in pixels.
- * @param newY The new Y coordinate in pixels.
- * @param newRotationState The new rotation state index.
- * @return `0` if no collision, `1` if colliding with the bottom or another block, `2` if colliding with the sides.
+ * @param col The column to check.
+ * @param row The row to check.
+ * @param rotationState The rotation state index to check.
+ * @param fraction The sub-cell progress to check.
+ * @return `true` if any covered cell is outside the board or occupied.
  */
-U8 check_bounds(GameBoard *board, Tetromino *tetromino, U16 newX, U16 newY, U8 newRotationState) {
-    // The shape of the Tetromino in its new rotation state
-	U16 shapeCurrent = tetromino->rotations[tetromino->rotationState];
-    U16 shapeNew = tetromino->rotations[newRotationState];
-    I16 newXB, newYB;
-	bool collisionWithBlock = false;
-
-    // Calculate board position in terms of blocks (not pixels)
-    newXB = (newX / BLOCKSIZE) - 10;
-    newYB = (newY - BOARD_OFFSET_TOP) / BLOCKSIZE;
-
-    // Ensure alignment to block grid if not perfectly aligned
-    if (newY % BLOCKSIZE != 0) {
-        newYB += 1;
-    }
-	if (newX % BLOCKSIZE != 0) {
-		newXB += 1;
-	}
+static bool collides(const GameBoard *board, const Tetromino *tetromino, I8 col, I8 row, U8 rotationState, U8 fraction) {
+    U16 shape = tetromino->rotations[rotationState];
+    I8 x, y;
 
-    // Iterate over the Tetromino's 4x4 grid representation
     for (I8 i = 0; i < 4; i++) {
         for (I8 j = 0; j < 4; j++) {
-            // Check if the current block of the Tetromino is filled in the new rotation
-            if ((shapeNew & (1 << (i * 4 + j))) != 0) {
-                // Check boundary collisions
-                if (newX + ((j + 1) * BLOCKSIZE) > BOARD_OFFSET_RIGHT || newX + (j * BLOCKSIZE) < BOARD_OFFSET_LEFT) {
-                    return 2; // Collision with side, move block
-                }
-
-                // Check if the Tetromino is colliding with the bottom or another block
-                if (newY + ((i + 1) * BLOCKSIZE) > (BOARD_HEIGHT_PX + BOARD_OFFSET_TOP) || board->state[newXB + j][newYB + i] == 1) {
-
-                    // If the rotation causes a collision with another block
-                    if (board->state[newXB + j][newYB + i] == 1) {
-                        collisionWithBlock = true;
-                    }
+            if ((shape & (1 << (i * 4 + j))) == 0) {
+                continue;
+            }
 
-                    // If colliding with the bottom of the board
-                    if (newY + ((i + 1) * BLOCKSIZE) >= (BOARD_HEIGHT_PX + BOARD_OFFSET_TOP)) {
-                        return 1; // Collision at the bottom, block should be placed
-                    }
-                }
+            x = col + j;
+            y = row + i;
+            if (x < 0 || x >= BOARD_WIDTH || y < 0 || y >= BOARD_HEIGHT || board->state[x][y] == 1) {
+                return true;
+            }
+            if (fraction > 0 && (y + 1 >= BOARD_HEIGHT || board->state[x][y + 1] == 1)) {
+                return true;
             }
         }
     }
 
-	if(collisionWithBlock) {
-		for (I8 i = 0; i < 4; i++) {
-			for (I8 j = 0; j < 4; j++) {
-				// Check if the current block of the Tetromino is filled in the new rotation
-				if ((shapeCurrent & (1 << (i * 4 + j))) != 0) {
-						// If the rotation causes a collision with another block
-						if (board->state[newXB + j][newYB + i] == 1) {
-							return 1;
-						}
-				}
-			}
+    return false;
+}
+
+/**
+ * @brief Lets the Tetromino fall and places it on the board when it lands.
+ *
+ * The fall is accumulated in the sub-cell fraction, the board is only checked when the
+ * Tetromino starts to enter the next row, so fast drops cost one check per row instead of
+ * one per pixel. It is placed as soon as the next row is blocked.
+ *
+ * @param board Pointer to the GameBoard structure.
+ * @param tetromino Pointer to the Tetromino structure to be moved.
+ * @param distance How many pixels the Tetromino falls at most.
+ * @return `true` if the Tetromino is placed on the board, `false` otherwise.
+ */
+bool drop_tetromino(GameBoard *board, Tetromino *tetromino, U16 distance) {
+	U16 step;
+
+	while (distance > 0) {
+		if (tetromino->fraction == 0 && collides(board, tetromino, tetromino->col, tetromino->row + 1, tetromino->rotationState, 0)) {
+			place_tetromino(board, tetromino);
+			return true; // has to be freeed
+		}
+
+		step = BLOCKSIZE - tetromino->fraction;
+		if (step > distance) {
+			step = distance;
+		}
+		tetromino->fraction += step;
+		distance -= step;
+
+		if (tetromino->fraction == BLOCKSIZE) {
+			tetromino->row++;
+			tetromino->fraction = 0;
 		}
 	}
 
-    return 0; // No collision, allow rotation and move freely
+	return false; // Tetromino not placed yet
 }
 
 /**
- * @brief Maps a string buffer containing key input to a corresponding KeyAction enum value.
+ * @brief Moves or rotates the Tetromino according to one key press.
  *
- * Converts the string representation of a key input to the corresponding KeyAction enum.
+ * Rotations and side moves are only applied if they cause no collision,
+ * drops place the Tetromino if it lands.
  *
- * @param keyBuf Pointer to the string containing the key input.
- * @return The corresponding `KeyAction` enum value, or `KEY_NOMOVE` if no match is found.
+ * @param board Pointer to the GameBoard structure.
+ * @param tetromino Pointer to the Tetromino structure to be moved.
+ * @param action The action of the pressed key.
+ * @return `true` if the Tetromino is placed on the board, `false` otherwise.
  */
-KeyAction getKeyAction(const char *keyBuf) {
-	if (strcmp(keyBuf, "Up") == 0) return KEY_UP;
-	if (strcmp(keyBuf, "Down") == 0) return KEY_DOWN;
-	if (strcmp(keyBuf, "Left") == 0) return KEY_LEFT;
-	if (strcmp(keyBuf, "Right") == 0) return KEY_RIGHT;
-	if (strcmp(keyBuf, "Control") == 0) return KEY_CTRL;
-	if (strcmp(keyBuf, " ") == 0) return KEY_SPACE;
-	return KEY_NOMOVE;
+bool move_tetromino(GameBoard *board, Tetromino *tetromino, KeyAction action) {
+	U8 newRotationState = tetromino->rotationState;
+
+	switch (action) {
+		case KEY_UP:
+			newRotationState = (tetromino->rotationState + 1) % 4; // clock wise rotation
+			break;
+		case KEY_CTRL:
+			newRotationState = (tetromino->rotationState + 3) % 4; // counter clock rotation
+			break;
+		case KEY_DOWN:
+			return drop_tetromino(board, tetromino, SOFT_DROP_SPEED);
+		case KEY_SPACE:
+			return drop_tetromino(board, tetromino, BOARD_HEIGHT * BLOCKSIZE);
+		case KEY_LEFT:
+			(void)shift_tetromino(board, tetromino, -1);
+			return false;
+		case KEY_RIGHT:
+			(void)shift_tetromino(board, tetromino, 1);
+			return false;
+		default:
+			return false;
+	}
+
+	if (!collides(board, tetromino, tetromino->col, tetromino->row, newRotationState, tetromino->fraction)) {
+		tetromino->rotationState = newRotationState;
+	}
+
+	return false; // Tetromino not placed yet
 }
 
 /**
- * @brief Moves and rotates the Tetromino based on user input and updates its position on the board.
+ * @brief Moves the Tetromino one cell to the side if nothing is in the way.
  *
- * This function handles the movement and rotation of a Tetromino based on user input,
- * checks for collisions using `check_bounds`, and places the Tetromino if it collides
- * with the bottom or another block.
+ * Used for the auto repeated moves of a held left/right key, which happen in addition
+ * to the regular movement of the frame.
  *
- * @param xw Pointer to the XWindow structure for rendering.
  * @param board Pointer to the GameBoard structure.
  * @param tetromino Pointer to the Tetromino structure to be moved.
- * @param keyBuf Pointer to the string containing the key input.
- * @return `true` if the Tetromino is placed on the board, `false` otherwise.
+ * @param direction `-1` to move to the left, `1` to move to the right.
+ * @return `true` if the Tetromino was moved, `false` if it is blocked.
  */
-bool move_tetromino(XWindow *xw, GameBoard *board, Tetromino *tetromino, const char *keyBuf) {
-    U8 newRotationState, boundCheck;
-    U16 speed;
-    U16 shape = tetromino->rotations[tetromino->rotationState];
-    U16 newX, newY, stepX, stepY;
-    
-    if(tetromino == NULL || keyBuf == NULL) {
-        fprintf(stderr, "Invalid input to move_tetromino\n");
-        return false;
-    }
+bool shift_tetromino(GameBoard *board, Tetromino *tetromino, I8 direction) {
+	if(collides(board, tetromino, tetromino->col + direction, tetromino->row, tetromino->rotationState, tetromino->fraction)) {
+		return false;
+	}
 
-    KeyAction action = getKeyAction(keyBuf);
-    newRotationState = tetromino->rotationState;
-    newX = tetromino->X;
-    newY = tetromino->Y;
+	tetromino->col += direction;
+	return true;
+}
 
-    // clear the old position of the tetromino blocks
-    for(I8 i=0; i<4; i++) {
-        for(I8 j=0; j<4; j++) {
-            if((shape & (1 << (i * 4 + j))) != 0) {
-                XClearArea(xw->display, xw->window, newX+(j*BLOCKSIZE), newY+(i*BLOCKSIZE), BLOCKSIZE, BLOCKSIZE, false);
-            }
-        }
-    }
+/**
+ * @brief Takes every queued input and tells if a specific key was pressed.
+ *
+ * Used on the start, pause and game over screens, the remaining inputs only update the held keys.
+ *
+ * @param queue The input queue filled by `recv_events`.
+ * @param input The held key state.
+ * @param key The key to look for, `KEY_ANY` matches every key.
+ * @return `true` if the key was pressed.
+ */
+static bool key_pressed(InputQueue *queue, InputState *input, KeyAction key) {
+	InputEvent event;
+	bool pressed = false;
 
-    speed = 1;
+	while (pop_input(queue, &event)) {
+		if (update_held(input, &event) && (key == KEY_ANY || event.action == key)) {
+			pressed = true;
+		}
+	}
+	return pressed;
+}
 
-    switch (action) {
-        case KEY_UP:
-            newRotationState = (tetromino->rotationState + 1) % 4; // clock wise rotation
-            break;
-        case KEY_DOWN:
-            speed = 0xf;
-            break;
-		case KEY_SPACE:
-			speed = BOARD_HEIGHT_PX;
-			break;
-        case KEY_CTRL:
-            newRotationState = (tetromino->rotationState + 3) % 4; // counter clock rotation
-            break;
-        case KEY_LEFT:
-            newX -= BLOCKSIZE;
-            break;
-        case KEY_RIGHT:
-            newX += BLOCKSIZE;
-            break;
-        default:
-            break;
-    }
+/**
+ * @brief Applies the queued inputs to the falling Tetromino in the order they arrived.
+ *
+ * Stops at the pause key or when the Tetromino is placed, the remaining inputs stay
+ * in the queue for the next tick (i.e. the next Tetromino).
+ *
+ * @param game Pointer to the Game the inputs are applied to.
+ * @param queue The input queue filled by `recv_events`.
+ * @param softDropped Set to `true` if a press of the down key moved the Tetromino this tick.
+ * @return `true` if the Tetromino was placed on the board.
+ */
+static bool apply_inputs(Game *game, InputQueue *queue, bool *softDropped) {
+	InputEvent event;
 
-    // Iterate from the current position to the new position in steps of speed
-    for (int step = 1; step <= speed; step++) {
-        stepX = newX;
-        stepY = newY + step;
-
-        boundCheck = check_bounds(board, tetromino, stepX, stepY, newRotationState);
-        if (boundCheck == 0) {
-            tetromino->X = stepX;
-            tetromino->Y = stepY;
-            tetromino->rotationState = newRotationState;
-
-		} else if(boundCheck == 1) {
-			if (action == KEY_LEFT) {
-				newX += 1;
-			} else if (action == KEY_RIGHT) {
-				newX -= 1;
-			} else {
-				place_tetromino(board, tetromino);
-				return true; // has to be freeed
-			}
+	*softDropped = false;
+	while (pop_input(queue, &event)) {
+		if (!update_held(&game->input, &event)) {
+			continue;
 		}
-    }
+		game->metrics.inputs++;
+		game->metrics.gameInputs++;
+
+		if (event.action == KEY_PAUSE) {
+			game->state = STATE_PAUSE;
+			return false;
+		}
+		if (event.action == KEY_REWIND) {
+			(void)rewind_placement(game); // the placed Tetromino falls again
+			continue;
+		}
+
+		*softDropped |= (event.action == KEY_DOWN);
+		if (move_tetromino(&game->board, game->current, event.action)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Initializes the game session shown on the start screen.
+ *
+ * @param game Pointer to the Game to initialize.
+ * @param options The command line settings (DAS/ARR, metrics file, seed).
+ * @param leaderboard The leaderboard finished games are recorded in (may be `NULL`).
+ */
+void init_session(Game *game, const Options *options, Leaderboard *leaderboard) {
+	memset(game, 0, sizeof(*game));
+	game->state = STATE_START;
+	game->leaderboard = leaderboard;
+	init_input(&game->input, options->dasMs, options->arrMs);
+	init_metrics(&game->metrics, options->metricsPath);
+	game->metrics.rewindBytes = sizeof(game->rewind);
+	init_game(&game->board, (leaderboard != NULL) ? best_score(leaderboard) : 0);
+	init_rng(&game->rng, options->rngMode, options->seed);
+	for(U8 i=0;i<PIECE_QUEUE_LENGTH;i++) {
+		game->next[i] = random_type(game);
+	}
+}
+
+/**
+ * @brief Takes the next Tetromino type from the queue and draws a new one for its end.
+ *
+ * @param game Pointer to the Game.
+ * @return The type of the Tetromino to spawn.
+ */
+static U8 take_next(Game *game) {
+	U8 type = game->next[0];
+
+	memmove(game->next, game->next + 1, PIECE_QUEUE_LENGTH - 1);
+	game->next[PIECE_QUEUE_LENGTH - 1] = random_type(game);
+	return type;
+}
 
-    return false; // Tetromino not placed yet
+/**
+ * @brief Notes the lock of the falling Tetromino before its full rows are removed.
+ *
+ * `remove_full_row` removes nothing once a block reached row 2 (game over), otherwise the full
+ * rows from the top down.
+ *
+ * @param game Pointer to the Game, the Tetromino is already on the board.
+ */
+static void note_lock(Game *game) {
+	LockEvent *lock = &game->lastLock;
+	bool full;
+
+	lock->count++;
+	lock->type = game->current->type;
+	lock->rotationState = game->current->rotationState;
+	lock->col = game->current->col;
+	lock->row = game->current->row;
+
+	lock->gameOver = false;
+	for(U8 x=0;x<BOARD_WIDTH && !lock->gameOver;x++) {
+		lock->gameOver = (game->board.state[x][2] != 0);
+	}
+	lock->rowsCleared = 0;
+	for(U8 y=0;y<BOARD_HEIGHT && lock->rowsCleared < 4 && !lock->gameOver;y++) {
+		full = true;
+		for(U8 x=0;x<BOARD_WIDTH && full;x++) {
+			full = (game->board.state[x][y] != 0);
+		}
+		if(full) {
+			lock->clearedRows[lock->rowsCleared] = y;
+			lock->clearedColors[lock->rowsCleared++] = game->board.colors[y];
+		}
+	}
 }
 
 /**
- * @brief Updates the game display by drawing the current Tetromino and board boundaries.
+ * @brief Advances the game by one simulation tick.
  *
- * Renders the current Tetromino on the game board and draws the boundaries of the board.
+ * Takes the inputs queued since the last tick, moves the falling Tetromino (inputs in order,
+ * gravity, auto repeated side moves), places it and removes full rows. No X calls are made here,
+ * the result is drawn from a snapshot (see `snapshot_game`), so the simulation can run on its own thread.
  *
- * @param xw Pointer to the XWindow structure for rendering.
- * @param currentTetromino Pointer to the pointer of the current Tetromino to be drawn.
+ * @param game Pointer to the Game to advance.
+ * @param queue The input queue filled by `recv_events`.
  */
-void update_game(XWindow *xw, Tetromino **currentTetromino) {
-	if(*currentTetromino == NULL) {
-		return;
+void step_game(Game *game, InputQueue *queue) {
+	KeyAction shiftKey;
+	U8 shifts;
+	U8 rowsCleared;
+	bool placed, softDropped;
+
+	game->tick++;
+	if(game->tick % METRICS_INTERVAL_TICKS == 0) {
+		export_metrics(&game->metrics);
 	}
+	if(game->tick % SNAPSHOT_INTERVAL_TICKS == 0 && (game->state == STATE_GAME || game->state == STATE_PAUSE)) {
+		save_game(game);
+	}
+
+	switch(game->state) {
+		case STATE_START:
+			if (key_pressed(queue, &game->input, KEY_ANY)) {
+				// the user pressed any key to start
+				init_game(&game->board, game->board.highscore);
+				game->boardVersion++;
+				game->state = STATE_GAME;
+
+				game->metrics.gamesStarted++;
+				game->metrics.gameTicks = 0;
+				game->metrics.gamePieces = 0;
+				game->metrics.gameInputs = 0;
+				memset(&game->rewind, 0, sizeof(game->rewind));
+				game->metrics.rewindEntries = 0;
+			}
+			break;
+
+		case STATE_GAME:
+			game->metrics.gameTicks++;
+			if(game->current == NULL) {
+				game->current = get_tetromino(take_next(game));
+				break;
+			}
+
+			placed = apply_inputs(game, queue, &softDropped);
+			if(game->state == STATE_PAUSE) {
+				save_game(game); // the player may not come back
+				break;
+			}
+
+			if(!placed && !softDropped) {
+				// gravity, soft drop as long as the key is held (from the tick after the press, which moved it already)
+				placed = drop_tetromino(&game->board, game->current, game->input.held[KEY_DOWN] ? SOFT_DROP_SPEED : GRAVITY_SPEED);
+			}
+
+			if(!placed) {
+				// auto repeated side moves of a held left/right key
+				shiftKey = get_repeat_shifts(&game->input, &shifts);
+				for(U8 i=0;i<shifts && shift_tetromino(&game->board, game->current, (shiftKey == KEY_LEFT) ? -1 : 1);i++);
+			}
+
+			if(placed) {
+				note_lock(game);
+				record_placement(game);
+				free_tetromino(&game->current);
+				game->state = remove_full_row(&game->board, &rowsCleared); // this function checks if the user is gameover
+				game->boardVersion++;
+
+				game->metrics.piecesPlaced++;
+				game->metrics.gamePieces++;
+				if(rowsCleared > 0 && rowsCleared <= METRICS_LINE_SIZES) {
+					game->metrics.linesCleared[rowsCleared - 1]++;
+				}
+
+				if(game->state == STATE_GAME_OVER) {
+					if(game->leaderboard != NULL) {
+						(void)save_score(game->leaderboard, game->board.score, game->board.level); // written in the background
+					}
+					export_metrics(&game->metrics); // the final numbers of the game
+					save_game(game); // nothing to resume any more
+				}
+			}
+			break;
 
-	draw_tetromino(xw->display, xw->window, xw->gc, *currentTetromino);
+		case STATE_PAUSE:
+			if(key_pressed(queue, &game->input, KEY_PAUSE)) {
+				game->state = STATE_GAME;
+			}
+			break;
+
+		case STATE_GAME_OVER:
+			if(key_pressed(queue, &game->input, KEY_ANY)) {
+				// the user pressed any key to start again
+				game->state = STATE_START;
+			}
+			break;
+
+		default:
+			break;
+	}
+}
 
-#if REVERSED_STREAM
-	XSetForeground(xw->display, xw->gc, WhitePixel(xw->display, xw->screenNumber));
-#else
-	XSetForeground(xw->display, xw->gc, BlackPixel(xw->display, xw->screenNumber));
-#endif
+/**
+ * @brief Copies everything the renderer needs into an immutable frame snapshot.
+ *
+ * @param game Pointer to the Game to copy.
+ * @param frame Receives the snapshot.
+ */
+void snapshot_game(const Game *game, Frame *frame) {
+	frame->state = game->state;
+	frame->board = game->board;
+	frame->boardVersion = game->boardVersion;
+	frame->tick = game->tick;
+	frame->lastLock = game->lastLock;
+	frame->hasPiece = (game->current != NULL);
+	if(frame->hasPiece) {
+		frame->piece = *game->current;
+	}
+}
 
-	XDrawRectangle(xw->display, xw->window, xw->gc, BOARD_OFFSET_LEFT, BOARD_OFFSET_TOP, BOARD_WIDTH_PX, BOARD_HEIGHT_PX); // TODO make more efficent method
-	return;	
+/**
+ * @brief Frees everything the game session allocated.
+ *
+ * @param game Pointer to the Game to free.
+ */
+void free_session(Game *game) {
+	if(game->current != NULL) {
+		free_tetromino(&game->current);
+	}
 }
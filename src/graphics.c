@@ -2,6 +2,29 @@
 
 #include "graphics.h"
 
+U16 viewScale = 1;
+BoardLayout boardLayout = {(WINDOW_BASE_WIDTH - BOARD_WIDTH * BLOCKSIZE) / 2, BOARD_BASE_TOP, BLOCKSIZE};
+
+/**
+ * @brief Scales the window and everything drawn in it by a whole factor.
+ *
+ * Has to be called before the window is created and the fonts are opened. The simulation
+ * keeps counting in pixels of scale 1 (`BLOCKSIZE`), only the drawing is scaled.
+ *
+ * @param scale Window pixels per pixel of the game (1 to `VIEW_SCALE_MAX`).
+ * @return 0 on success, -1 if the scale is out of range.
+ */
+I8 set_view_scale(U16 scale) {
+	if(scale < 1 || scale > VIEW_SCALE_MAX) {
+		fprintf(stderr, "Error: the view scale has to be between 1 and %d\n", VIEW_SCALE_MAX);
+		return -1;
+	}
+
+	viewScale = scale;
+	boardLayout = (BoardLayout){BOARD_OFFSET_LEFT, BOARD_OFFSET_TOP, CELL_SIZE};
+	return 0;
+}
+
 /**
  * @brief Initializes the graphical context for the XWindow.
  *
@@ -14,7 +37,7 @@
 void init_graphics(XWindow *xw) {
     unsigned long valuemask = 0; // GC creation mask
     XGCValues values;            // Initial values for GC
-    unsigned int line_width = 2; // Line width
+    unsigned int line_width = LINE_WIDTH; // Line width
     int line_style = LineSolid;  // Line style
     int cap_style = CapButt;     // Cap style
     int join_style = JoinBevel;  // Join style
@@ -35,79 +58,33 @@ void init_graphics(XWindow *xw) {
 
     XSetLineAttributes(xw->display, xw->gc, line_width, line_style, cap_style, join_style);
     XSetFillStyle(xw->display, xw->gc, FillSolid); // Solid fill
+    XSetGraphicsExposures(xw->display, xw->gc, False); // no NoExpose events for every cached screen copy
 }
 
 /**
- * @brief Initializes the font for rendering text in the XWindow.
+ * @brief Converts an axis-aligned polyline into filled rectangles.
  *
- * Load a font by name using Xft (X FreeType Interface) and returns a pointer
- * to the XftFont structure.
+ * Each segment becomes a `LINE_WIDTH` thick rectangle centered on it, which also covers
+ * the corners, so outlines can be drawn with a single fill request on every backend.
  *
- * @param xw A pointer to the XWindow structure containing display and window info.
- * @param fontname The name of the font to be loaded.
- * @return XftFont* A pointer to the loaded font, or NULL if loading fails.
+ * @param points The points of the polyline.
+ * @param count Number of points.
+ * @param rects Output buffer for `count - 1` rectangles.
+ * @return Number of rectangles written.
  */
-XftFont* init_font(XWindow *xw, const char* fontname) {
-    XftFont *font = XftFontOpenName(xw->display, xw->screenNumber, fontname);
-    if (!font) {
-        fprintf(stderr, "Unable to load font %s\n", fontname);
-        return NULL;
-    }
-    return font;
-}
+static U16 line_rects(const XPoint *points, U16 count, XRectangle *rects) {
+    U16 half = LINE_WIDTH / 2;
+    U16 n = 0;
 
-/**
- * @brief Draws a string of text at specified coordinates with an optional effect.
- *
- * This function draws UTF-8 encoded text using the specified font at the given
- * coordinates. Optionally, it can apply a glow effect around the text.
- *
- * @param display The X display.
- * @param window The target window for drawing.
- * @param font The font to use for drawing the text.
- * @param x The x-coordinate for the text.
- * @param y The y-coordinate for the text.
- * @param text The text string to draw.
- * @param effect If true, applies a glow effect around the text.
- */
-void draw_characters(Display *display, Window window, XftFont *font, U16 x, U16 y, const char *text, bool effect) {
-    XftDraw *xftDraw = XftDrawCreate(display, window, DefaultVisual(display, DefaultScreen(display)), DefaultColormap(display, DefaultScreen(display)));
+    for (U16 i = 1; i < count; ++i) {
+        I16 x0 = (points[i - 1].x < points[i].x) ? points[i - 1].x : points[i].x;
+        I16 y0 = (points[i - 1].y < points[i].y) ? points[i - 1].y : points[i].y;
+        U16 dx = abs(points[i].x - points[i - 1].x);
+        U16 dy = abs(points[i].y - points[i - 1].y);
 
-    if (effect) {
-        // Glow effect
-#if REVERSED_STREAM
-        XRenderColor glowColor = {0xffff, 0xffff, 0xffff, 0x6000}; 
-#else
-        XRenderColor glowColor = {0x0000, 0x0000, 0x0000, 0x6000}; 
-#endif
-        XftColor glowXftColor;
-        XftColorAllocValue(display, DefaultVisual(display, DefaultScreen(display)), DefaultColormap(display, DefaultScreen(display)), &glowColor, &glowXftColor);
-
-        I8 offsets[] = {-2, -1, 1, 2}; 
-        U8 numOffsets = sizeof(offsets) / sizeof(offsets[0]);
-
-        for (I8 ox = 0; ox < numOffsets; ++ox) {
-            for (I8 oy = 0; oy < numOffsets; ++oy) {
-                XftDrawString8(xftDraw, &glowXftColor, font, x + offsets[ox], y + font->ascent + offsets[oy], (FcChar8 *)text, strlen(text));
-            }
-        }
-
-        XftColorFree(display, DefaultVisual(display, DefaultScreen(display)), DefaultColormap(display, DefaultScreen(display)), &glowXftColor);
+        rects[n++] = (XRectangle){x0 - half, y0 - half, dx + LINE_WIDTH, dy + LINE_WIDTH};
     }
-
-    // Render text
-#if REVERSED_STREAM
-    XRenderColor renderColor = {0xffff, 0xffff, 0xffff, 0xf000};
-#else
-    XRenderColor renderColor = {0x0000, 0x0000, 0x0000, 0xf000};
-#endif
-    XftColor color;
-    XftColorAllocValue(display, DefaultVisual(display, DefaultScreen(display)), DefaultColormap(display, DefaultScreen(display)), &renderColor, &color);
-
-    XftDrawStringUtf8(xftDraw, &color, font, x, y + font->ascent, (FcChar8 *)text, strlen(text));
-
-    XftDrawDestroy(xftDraw);
-    XftColorFree(display, DefaultVisual(display, DefaultScreen(display)), DefaultColormap(display, DefaultScreen(display)), &color);
+    return n;
 }
 
 /**
@@ -116,19 +93,19 @@ void draw_characters(Display *display, Window window, XftFont *font, U16 x, U16
  * This function draws a T-shaped cube in the center of the window, with optional shadow effects.
  * (used for start screen could be also used for future settings menu)
  *
- * @param display The X display.
- * @param window The target window for drawing.
- * @param gc The graphical context used for drawing.
- * @param win_attr Pointer to the window attributes.
+ * @param rb The render backend.
+ * @param target The window or surface to draw on.
  * @param size The size of the T-cube.
  * @param y The y-coordinate for the top of the T-cube.
  */
-void draw_T_cube(Display *display, Window window, GC gc, XWindowAttributes *win_attr, int size, U16 y) {
+void draw_T_cube(RenderBackend *rb, Surface target, U16 size, U16 y) {
     U16 x;
+    XRectangle rects[9];
+    U16 count;
 
-    // Centered T-cube
-    U16 blockSize = size; 
-    x = (win_attr->width - blockSize * 3) / 2;
+    // Centered T-cube (the window can not be resized, see init_main_window)
+    U16 blockSize = size;
+    x = (WINDOW_WIDTH - blockSize * 3) / 2;
 
     XPoint points[] = {
         {x + blockSize, y},
@@ -144,24 +121,20 @@ void draw_T_cube(Display *display, Window window, GC gc, XWindowAttributes *win_
     };
 
     // Shadow
-#if REVERSED_STREAM
-    XSetForeground(display, gc, WhitePixel(display, DefaultScreen(display)));
-#else
-    XSetForeground(display, gc, BlackPixel(display, DefaultScreen(display)));
-#endif
     for (int i = 0; i < 10; ++i) {
-        points[i].x += 4;
-        points[i].y += 4;
+        points[i].x += 4 * viewScale;
+        points[i].y += 4 * viewScale;
     }
-    XDrawLines(display, window, gc, points, 10, CoordModeOrigin);
+    count = line_rects(points, 10, rects);
+    rb->fill_rects(rb->ctx, target, COLOR_FOREGROUND, rects, count);
 
     // T shape
     for (int i = 0; i < 10; ++i) {
-        points[i].x -= 4;
-        points[i].y -= 4;
+        points[i].x -= 4 * viewScale;
+        points[i].y -= 4 * viewScale;
     }
-    XSetLineAttributes(display, gc, 2, LineSolid, CapButt, JoinMiter);
-    XDrawLines(display, window, gc, points, 10, CoordModeOrigin);
+    count = line_rects(points, 10, rects);
+    rb->fill_rects(rb->ctx, target, COLOR_FOREGROUND, rects, count);
 }
 
 
@@ -171,139 +144,579 @@ void draw_T_cube(Display *display, Window window, GC gc, XWindowAttributes *win_
  * This function calculates the center of the window and draws text centered
  * horizontally. The vertical position can be adjusted with padding.
  *
- * @param display The X display.
- * @param window The target window for drawing.
+ * @param rb The render backend.
+ * @param target The window or surface to draw on.
  * @param font The font to use for drawing the text.
  * @param text The text string to draw.
  * @param yPadding Vertical padding as a percentage of the window height.
  * @param effect If true, applies a glow effect around the text.
  * @return U16 The y-coordinate where the text was drawn.
  */
-U16 draw_text_center(Display *display, Window window, XftFont *font, const char *text, I16 yPadding, bool effect) {
+U16 draw_text_center(RenderBackend *rb, Surface target, FontId font, const char *text, I16 yPadding, bool effect) {
     U16 x, y;
     XGlyphInfo extents;
 
-    XftTextExtentsUtf8(display, font, (FcChar8 *)text, strlen(text), &extents);
+    rb->text_extents(rb->ctx, font, text, &extents);
 
     yPadding = yPadding % 100;
     x = (WINDOW_WIDTH - extents.width) / 2;
     y = (WINDOW_HEIGHT / 2 + (extents.height / 2)) + (yPadding * WINDOW_HEIGHT / 100);
-    
-    draw_characters(display, window, font, x, y, text, effect);
+
+    rb->text(rb->ctx, target, font, x, y, text, effect);
     return y;
 }
 
 /**
- * @brief Draws the end screen with a "Game Over" message and a prompt for the user.
- * 
- * This function clears the current window content and then displays the start screen.
- * 
- * @param xw Pointer to the XWindow structure containing display and window info.
- * @param fontText A pointer to the XftFont structure used for rendering the user message text.
- * @param fontHeadlines A pointer to the XftFont structure used for rendering the "Game Over" headline.
+ * @brief Draws the start screen with the title and a prompt for the user.
+ *
+ * @param rb The render backend.
+ * @param target The window or surface to draw on.
  */
-void draw_start_screen(XWindow *xw, XftFont *fontText, XftFont *fontHeadlines) {
+void draw_start_screen(RenderBackend *rb, Surface target) {
 	char *startMessage = "Press any key to start";
 	char *title = "Cubes";
     U16 y;
 
-	XWindowAttributes win_attr;
-	XGetWindowAttributes(xw->display, xw->window, &win_attr);
-
-	XClearWindow(xw->display, xw->window); // clear old state
-	(void)draw_text_center(xw->display, xw->window, fontText, startMessage, 20, false);
+	rb->clear(rb->ctx, target, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT); // clear old state
+	(void)draw_text_center(rb, target, FONT_TEXT, startMessage, 20, false);
 
 	// align the T behind the title
-	y = draw_text_center(xw->display, xw->window, fontHeadlines, title, -29, true);
-	draw_T_cube(xw->display, xw->window, xw->gc, &win_attr, 100, y);
+	y = draw_text_center(rb, target, FONT_HEADLINE, title, -29, true);
+	draw_T_cube(rb, target, 100 * viewScale, y);
+}
+
+/**
+ * @brief Draws the pause screen with a "Paused" message and a prompt for the user.
+ *
+ * @param rb The render backend.
+ * @param target The window or surface to draw on.
+ */
+void draw_pause_screen(RenderBackend *rb, Surface target) {
+	char *pauseMessage = "Paused";
+	char *userMessage = "Press P to continue";
+
+	rb->clear(rb->ctx, target, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT); // clear old state
+	(void)draw_text_center(rb, target, FONT_TEXT, userMessage, 20, false);
+	(void)draw_text_center(rb, target, FONT_HEADLINE, pauseMessage, -20, true);
 }
 
 /**
  * @brief Draws the end screen with a "Game Over" message and a prompt for the user.
- * 
- * This function clears the current window content and then displays the "Game over" screen.
- * 
- * @param xw Pointer to the XWindow structure containing display and window info.
- * @param fontText A pointer to the XftFont structure used for rendering the user message text.
- * @param fontHeadlines A pointer to the XftFont structure used for rendering the "Game Over" headline.
+ *
+ * @param rb The render backend.
+ * @param target The window or surface to draw on.
  */
-void draw_end_screen(XWindow *xw, XftFont *fontText, XftFont *fontHeadlines) {
+void draw_end_screen(RenderBackend *rb, Surface target) {
 	char *endMessage = "Game Over";
 	char *userMessage = "Press any key to play again";
 
-	XClearWindow(xw->display, xw->window); // clear old state
-	(void)draw_text_center(xw->display, xw->window, fontText, userMessage, 20, false);
-	(void)draw_text_center(xw->display, xw->window, fontHeadlines, endMessage, -20, true);
+	rb->clear(rb->ctx, target, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT); // clear old state
+	(void)draw_text_center(rb, target, FONT_TEXT, userMessage, 20, false);
+	(void)draw_text_center(rb, target, FONT_HEADLINE, endMessage, -20, true);
 }
 
 /**
- * @brief Draws the game board with blocks and score information.
+ * @brief Prepares the cache for the static screens.
  *
- * This function draws the game board based on the given board.
- * It renders the blocks, score, high score, and level text on the screen.
+ * The screens themselves are rendered lazily by `draw_screen` the first time they are shown,
+ * the block atlas the first time a block is drawn.
+ *
+ * @param screens Pointer to the ScreenCache to initialize.
+ */
+void init_screens(ScreenCache *screens) {
+	for(U8 i=0;i<SCREEN_COUNT;i++) {
+		screens->screens[i] = SURFACE_WINDOW;
+	}
+	screens->atlas = SURFACE_WINDOW;
+	screens->atlasBlock = 0;
+}
+
+/**
+ * @brief Shows one of the static screens in the window.
+ *
+ * On first use the screen is rendered into a window sized surface, after that every
+ * redraw (screen transition or expose) is a single blit.
+ *
+ * @param rb The render backend.
+ * @param screens Pointer to the ScreenCache holding the surfaces.
+ * @param id The screen to show.
+ */
+void draw_screen(RenderBackend *rb, ScreenCache *screens, ScreenId id) {
+	Surface surface = screens->screens[id];
+
+	if(surface == SURFACE_WINDOW) {
+		surface = rb->create_surface(rb->ctx, WINDOW_WIDTH, WINDOW_HEIGHT);
+
+		switch(id) {
+			case SCREEN_START:
+				draw_start_screen(rb, surface);
+				break;
+			case SCREEN_PAUSE:
+				draw_pause_screen(rb, surface);
+				break;
+			case SCREEN_GAME_OVER:
+				draw_end_screen(rb, surface);
+				break;
+			default:
+				break;
+		}
+
+		screens->screens[id] = surface;
+		if(surface == SURFACE_WINDOW) {
+			return; // no surface could be created, the screen was drawn directly
+		}
+	}
+
+	rb->blit(rb->ctx, surface, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT, SURFACE_WINDOW, 0, 0);
+}
+
+/**
+ * @brief Frees all surfaces of the screen cache.
+ *
+ * @param rb The render backend.
+ * @param screens Pointer to the ScreenCache to free.
+ */
+void free_screens(RenderBackend *rb, ScreenCache *screens) {
+	for(U8 i=0;i<SCREEN_COUNT;i++) {
+		if(screens->screens[i] != SURFACE_WINDOW) {
+			rb->free_surface(rb->ctx, screens->screens[i]);
+			screens->screens[i] = SURFACE_WINDOW;
+		}
+	}
+	if(screens->atlas != SURFACE_WINDOW) {
+		rb->free_surface(rb->ctx, screens->atlas);
+		screens->atlas = SURFACE_WINDOW;
+	}
+	screens->atlasBlock = 0;
+}
+
+/**
+ * @brief Returns the color of a cell color index (see `CELL_COLOR`).
+ */
+U32 cell_color(U8 index) {
+	return (index == 0) ? COLOR_BLOCK : tetrominos[(index - 1) % TETROMINO_TYPES].color;
+}
+
+/**
+ * @brief Mixes a color with white (`amount > 0`) or black (`amount < 0`).
+ *
+ * @param color The color (0xRRGGBB).
+ * @param amount Share of white or black in 1/256.
+ * @return The mixed color.
+ */
+U32 shade_color(U32 color, I16 amount) {
+	U32 mixed = 0, channel;
+
+	for(U8 shift=0;shift<24;shift+=8) {
+		channel = (color >> shift) & 0xff;
+		channel = (amount > 0) ? channel + ((0xff - channel) * amount >> 8) : channel * (256 + amount) >> 8;
+		mixed |= channel << shift;
+	}
+	return mixed;
+}
+
+/**
+ * @brief Renders a bevelled block tile for every cell color side by side.
+ *
+ * Tile `i` covers `i*size` to `i*size + size-2` horizontally (the last row and column are the
+ * gap between two blocks). Only rectangles are used, so the tiles look the same on every
+ * backend and can be rendered for any block size.
+ *
+ * @param rb The render backend.
+ * @param target Surface of at least `CELL_COLORS*size` x `size` pixels.
+ * @param size The block size in pixels (the distance between two cells).
+ */
+void draw_block_atlas(RenderBackend *rb, Surface target, U16 size) {
+	U16 tile = size - 1;
+	U16 bevel = (size / BEVEL_DIVISOR > 0) ? size / BEVEL_DIVISOR : 1;
+	U32 color;
+	I16 x;
+
+	rb->clear(rb->ctx, target, 0, 0, CELL_COLORS * size, size);
+	for(U8 i=0;i<CELL_COLORS;i++) {
+		color = cell_color(i);
+		x = i * size;
+
+		XRectangle face = {x, 0, tile, tile};
+		XRectangle lit[] = {{x, 0, tile, bevel}, {x, 0, bevel, tile}};
+		XRectangle shaded[] = {{x + bevel, tile - bevel, tile - bevel, bevel}, {x + tile - bevel, bevel, bevel, tile - bevel}};
+		XRectangle shine = {x + 2 * bevel, 2 * bevel, bevel, bevel};
+
+		rb->fill_rects(rb->ctx, target, color, &face, 1);
+		rb->fill_rects(rb->ctx, target, shade_color(color, 128), lit, 2);
+		rb->fill_rects(rb->ctx, target, shade_color(color, -112), shaded, 2);
+		rb->fill_rects(rb->ctx, target, shade_color(color, 208), &shine, 1);
+	}
+}
+
+/**
+ * @brief Draws blocks of one color with one tiled fill from the block atlas.
+ *
+ * The tile of the color repeats every `CELL_SIZE` pixels from the first block, so all blocks
+ * have to lie on the same grid (the board cells or the cells of one piece). The atlas is
+ * rendered on first use. Without it (no surface could be created) the blocks are filled flat.
+ *
+ * @param rb The render backend.
+ * @param screens The cache holding the atlas.
+ * @param target The window or surface to draw on.
+ * @param color The cell color index.
+ * @param blocks The blocks (`CELL_SIZE-1` squares).
+ * @param count Number of blocks.
+ */
+void draw_blocks(RenderBackend *rb, ScreenCache *screens, Surface target, U8 color, const XRectangle *blocks, U16 count) {
+	XRectangle tile = {color * CELL_SIZE, 0, CELL_SIZE, CELL_SIZE};
+
+	if(count == 0) {
+		return;
+	}
+	if(screens->atlasBlock != CELL_SIZE) {
+		if(screens->atlas != SURFACE_WINDOW) {
+			rb->free_surface(rb->ctx, screens->atlas);
+		}
+		screens->atlas = rb->create_surface(rb->ctx, CELL_COLORS * CELL_SIZE, CELL_SIZE);
+		screens->atlasBlock = CELL_SIZE;
+		if(screens->atlas != SURFACE_WINDOW) {
+			draw_block_atlas(rb, screens->atlas, CELL_SIZE);
+		}
+	}
+
+	if(screens->atlas == SURFACE_WINDOW) {
+		rb->fill_rects(rb->ctx, target, cell_color(color), blocks, count);
+		return;
+	}
+	rb->fill_tiled(rb->ctx, target, screens->atlas, &tile, blocks[0].x, blocks[0].y, blocks, count);
+}
+
+/**
+ * @brief Formats the score, highscore and level lines shown next to the board.
  *
  * @param board Pointer to the Board structure containing game state information.
- * @param xw Pointer to the XWindow structure containing display and window info.
- * @param scoreFont Pointer to the font used for rendering the score.
- * @param scoreText The text displaying the current score.
- * @param highscoreText The text displaying the high score.
- * @param levelText The text displaying the current level.
+ * @param hud Output buffer for the `HUD_LINES` text lines.
  */
-void draw_board(XWindow *xw, GameBoard *board, XftFont *scoreFont) {
-	char scoreText[28];
-	char highscoreText[32];
-	char levelText[24];
+static void format_hud(const GameBoard *board, char hud[HUD_LINES][HUD_LINE_LENGTH]) {
+	snprintf(hud[0], HUD_LINE_LENGTH, "score: %lu", board->score);
+	snprintf(hud[1], HUD_LINE_LENGTH, "highscore: %lu", board->highscore);
+	snprintf(hud[2], HUD_LINE_LENGTH, "level: %u", board->level);
+}
 
-	// Format the scores
-    snprintf(scoreText, sizeof(scoreText), "score: %lu", board->score);
-	snprintf(highscoreText, sizeof(highscoreText), "highscore: %lu", board->highscore); 
-	snprintf(levelText, sizeof(levelText), "level: %u", board->level);
+/**
+ * @brief Computes the outline of a board as four filled rectangles (top, right, bottom, left).
+ *
+ * @param layout Where the board is drawn.
+ * @param rects Receives the rectangles.
+ */
+void border_rects(const BoardLayout *layout, XRectangle rects[4]) {
+	I16 right = layout->left + BOARD_WIDTH * layout->cell;
+	I16 bottom = layout->top + BOARD_HEIGHT * layout->cell;
+	XPoint points[] = {
+		{layout->left, layout->top},
+		{right, layout->top},
+		{right, bottom},
+		{layout->left, bottom},
+		{layout->left, layout->top}
+	};
+
+	(void)line_rects(points, 5, rects);
+}
+
+/**
+ * @brief Draws the outline of the board.
+ *
+ * @param rb The render backend.
+ */
+static void draw_border(RenderBackend *rb) {
+	XRectangle rects[4];
+
+	border_rects(&boardLayout, rects);
+	rb->fill_rects(rb->ctx, SURFACE_WINDOW, COLOR_FOREGROUND, rects, 4);
+}
+
+/**
+ * @brief Computes the blocks of the placed cubes, sorted by their color.
+ *
+ * The cells are sorted by their color index with a counting sort, so every color is one
+ * batch: the blocks of color `c` are `cells[start[c]]` up to (excluding) `cells[end[c]]`.
+ *
+ * @param layout Where the board is drawn.
+ * @param board The board.
+ * @param region Only cells intersecting this region are taken, `NULL` for all.
+ * @param cells Receives up to `BOARD_WIDTH * BOARD_HEIGHT` blocks.
+ * @param start Receives where the blocks of every color begin.
+ * @param end Receives where the blocks of every color end.
+ */
+void collect_cells(const BoardLayout *layout, const GameBoard *board, Region region, XRectangle *cells, U16 start[CELL_COLORS], U16 end[CELL_COLORS]) {
+	U16 counts[CELL_COLORS] = {0};
+	U16 size = layout->cell - 1;
+	U8 color;
+	I16 x, y;
 
-	// Render all cubes placed on the board
-	XSetForeground(xw->display, xw->gc, 0xc0c0c0);
 	for(U8 i=0;i<BOARD_HEIGHT;i++) {
 		for(U8 j=0;j<BOARD_WIDTH;j++) {
 			if(board->state[j][i] == 1) {
-				XFillRectangle(xw->display, xw->window, xw->gc, j*BLOCKSIZE + BOARD_OFFSET_LEFT, i*BLOCKSIZE + BOARD_OFFSET_TOP, BLOCKSIZE-1, BLOCKSIZE-1);
+				counts[CELL_COLOR(board, j, i)]++;
 			}
 		}
 	}
+	for(U8 c=0;c<CELL_COLORS;c++) {
+		start[c] = end[c] = (c == 0) ? 0 : start[c - 1] + counts[c - 1];
+	}
 
-	// Render text
-#if REVERSED_STREAM
-	XSetForeground(xw->display, xw->gc, WhitePixel(xw->display, xw->screenNumber));
-#else
-	XSetForeground(xw->display, xw->gc, BlackPixel(xw->display, xw->screenNumber));
-#endif
+	for(U8 i=0;i<BOARD_HEIGHT;i++) {
+		for(U8 j=0;j<BOARD_WIDTH;j++) {
+			x = j*layout->cell + layout->left;
+			y = i*layout->cell + layout->top;
+
+			if(board->state[j][i] == 1 && (region == NULL || XRectInRegion(region, x, y, size, size) != RectangleOut)) {
+				color = CELL_COLOR(board, j, i);
+				cells[end[color]++] = (XRectangle){x, y, size, size};
+			}
+		}
+	}
+}
+
+/**
+ * @brief Draws the placed cubes, grouped by color.
+ *
+ * @param rb The render backend.
+ * @param screens The cache holding the block atlas.
+ * @param board The board.
+ * @param region Only cells intersecting this region are drawn, `NULL` for all.
+ */
+static void draw_cells(RenderBackend *rb, ScreenCache *screens, const GameBoard *board, Region region) {
+	XRectangle cells[BOARD_WIDTH * BOARD_HEIGHT];
+	U16 start[CELL_COLORS], end[CELL_COLORS];
+
+	collect_cells(&boardLayout, board, region, cells, start, end);
+	for(U8 c=0;c<CELL_COLORS;c++) {
+		if(end[c] > start[c]) {
+			draw_blocks(rb, screens, SURFACE_WINDOW, c, &cells[start[c]], end[c] - start[c]);
+		}
+	}
+}
 
-	XDrawRectangle(xw->display, xw->window, xw->gc, BOARD_OFFSET_LEFT, BOARD_OFFSET_TOP, BOARD_WIDTH_PX, BOARD_HEIGHT_PX);
-	draw_characters(xw->display, xw->window, scoreFont, BOARD_OFFSET_RIGHT + BLOCKSIZE, BLOCKSIZE + BOARD_OFFSET_TOP, scoreText, false);
-	draw_characters(xw->display, xw->window, scoreFont, BOARD_OFFSET_RIGHT + BLOCKSIZE, BLOCKSIZE*2 + BOARD_OFFSET_TOP, highscoreText, false);
-	draw_characters(xw->display, xw->window, scoreFont, BOARD_OFFSET_RIGHT + BLOCKSIZE, BLOCKSIZE*3 + BOARD_OFFSET_TOP, levelText, false);
+/**
+ * @brief Draws the game board with blocks and score information.
+ *
+ * This function draws the game board based on the given board.
+ * It renders the blocks, score, high score, and level text on the screen.
+ *
+ * @param rb The render backend.
+ * @param screens The cache holding the block atlas.
+ * @param board Pointer to the Board structure containing game state information.
+ */
+void draw_board(RenderBackend *rb, ScreenCache *screens, const GameBoard *board) {
+	char hud[HUD_LINES][HUD_LINE_LENGTH];
+
+	// Format the scores
+	format_hud(board, hud);
+
+	// Render all cubes placed on the board, batched into one request per color
+	draw_cells(rb, screens, board, NULL);
+
+	// Render text
+	draw_border(rb);
+	for(U8 i=0;i<HUD_LINES;i++) {
+		rb->text(rb->ctx, SURFACE_WINDOW, FONT_TEXT, BOARD_OFFSET_RIGHT + CELL_SIZE, CELL_SIZE*(i+1) + BOARD_OFFSET_TOP, hud[i], false);
+	}
 }
 
-void draw_tetromino(Display *display, Window window, GC gc, Tetromino *tetromino) {
+/**
+ * @brief Repaints the parts of the game screen that intersect an exposed region.
+ *
+ * The X server already cleared the exposed areas to the window background, so only the
+ * board cells, border segments, HUD lines and tetromino blocks touching the region are
+ * drawn again (clipped to the region) instead of clearing and redrawing the whole window.
+ *
+ * @param rb The render backend.
+ * @param screens The cache holding the block atlas.
+ * @param board Pointer to the Board structure containing game state information.
+ * @param tetromino The falling tetromino (may be `NULL`).
+ * @param region The exposed region accumulated from the `Expose` events.
+ */
+void repaint_region(RenderBackend *rb, ScreenCache *screens, const GameBoard *board, const Tetromino *tetromino, Region region) {
+	XRectangle border[4];
+	U16 borderCount = 0;
+	char hud[HUD_LINES][HUD_LINE_LENGTH];
+	XGlyphInfo extents;
 	I16 x, y;
-	x = tetromino->X;
-	y = tetromino->Y;
 
-	U16 shape = tetromino->rotations[tetromino->rotationState];
+	rb->set_clip(rb->ctx, region);
 
-	XSetForeground(display, gc, tetromino->color);
+	// Placed cubes, batched into one request per color
+	draw_cells(rb, screens, board, region);
 
+	if(tetromino != NULL && XRectInRegion(region, TETROMINO_X(tetromino), TETROMINO_Y(tetromino), CELL_SIZE*4, CELL_SIZE*4) != RectangleOut) {
+		draw_tetromino(rb, screens, SURFACE_WINDOW, tetromino);
+	}
+
+	// Border segments touching the region
+	border_rects(&boardLayout, border);
 	for(U8 i=0;i<4;i++) {
-		for(U8 j=0;j<4;j++) {
+		if(XRectInRegion(region, border[i].x, border[i].y, border[i].width, border[i].height) != RectangleOut) {
+			border[borderCount++] = border[i];
+		}
+	}
+	if(borderCount > 0) {
+		rb->fill_rects(rb->ctx, SURFACE_WINDOW, COLOR_FOREGROUND, border, borderCount);
+	}
+
+	// HUD lines
+	format_hud(board, hud);
+	for(U8 i=0;i<HUD_LINES;i++) {
+		x = BOARD_OFFSET_RIGHT + CELL_SIZE;
+		y = CELL_SIZE*(i+1) + BOARD_OFFSET_TOP;
+		rb->text_extents(rb->ctx, FONT_TEXT, hud[i], &extents);
+
+		if(XRectInRegion(region, x, y, extents.xOff, rb->line_height(rb->ctx, FONT_TEXT)) != RectangleOut) {
+			rb->text(rb->ctx, SURFACE_WINDOW, FONT_TEXT, x, y, hud[i], false);
+		}
+	}
+
+	rb->set_clip(rb->ctx, NULL);
+}
+
+/**
+ * @brief Clears the blocks of a Tetromino from the window (before it is moved).
+ *
+ * @param rb The render backend.
+ * @param tetromino The Tetromino at the position it was drawn at.
+ */
+void clear_tetromino(RenderBackend *rb, const Tetromino *tetromino) {
+	U16 shape = tetromino->rotations[tetromino->rotationState];
+
+	for(I8 i=0; i<4; i++) {
+		for(I8 j=0; j<4; j++) {
 			if((shape & (1 << (i * 4 + j))) != 0) {
-				XFillRectangle(display, window, gc, tetromino->X, tetromino->Y, BLOCKSIZE-1, BLOCKSIZE-1);
+				rb->clear(rb->ctx, SURFACE_WINDOW, TETROMINO_X(tetromino)+(j*CELL_SIZE), TETROMINO_Y(tetromino)+(i*CELL_SIZE), CELL_SIZE, CELL_SIZE);
 			}
-			
-			tetromino->X = (tetromino->X + BLOCKSIZE);	
 		}
+	}
+}
 
-		tetromino->X = x;
-		tetromino->Y = (tetromino->Y + BLOCKSIZE);	
+/**
+ * @brief Computes the blocks of a Tetromino at its current position.
+ *
+ * The falling distance between two rows (`fraction`, in px of `BLOCKSIZE`) is scaled to the cell size.
+ *
+ * @param layout Where the board is drawn.
+ * @param tetromino The Tetromino.
+ * @param blocks Receives the blocks.
+ * @return The number of blocks.
+ */
+U8 tetromino_blocks(const BoardLayout *layout, const Tetromino *tetromino, XRectangle blocks[4]) {
+	U16 shape = tetromino->rotations[tetromino->rotationState];
+	I16 x = layout->left + tetromino->col * layout->cell;
+	I16 y = layout->top + tetromino->row * layout->cell + tetromino->fraction * layout->cell / BLOCKSIZE;
+	U8 count = 0;
+
+	for(U8 i=0;i<4;i++) {
+		for(U8 j=0;j<4;j++) {
+			if((shape & (1 << (i * 4 + j))) != 0 && count < 4) {
+				blocks[count++] = (XRectangle){x + j*layout->cell, y + i*layout->cell, layout->cell-1, layout->cell-1};
+			}
+		}
 	}
+	return count;
+}
+
+/**
+ * @brief Draws the blocks of a Tetromino at its current position.
+ *
+ * @param rb The render backend.
+ * @param screens The cache holding the block atlas.
+ * @param target The window or surface to draw on.
+ * @param tetromino The Tetromino to draw.
+ */
+void draw_tetromino(RenderBackend *rb, ScreenCache *screens, Surface target, const Tetromino *tetromino) {
+	XRectangle blocks[4];
 
-	tetromino->Y = y;
+	draw_blocks(rb, screens, target, tetromino->type % TETROMINO_TYPES + 1, blocks, tetromino_blocks(&boardLayout, tetromino, blocks));
 }
 
+/**
+ * @brief Forgets the exposed area, called whenever the window was repainted completely.
+ */
+void reset_expose_region(void) {
+	XDestroyRegion(exposeRegion);
+	exposeRegion = XCreateRegion();
+}
+
+/**
+ * @brief Draws a frame snapshot, only touching what changed since the previously drawn one.
+ *
+ * Screens are restored from the screen cache when the state changes or the window was exposed.
+ * During the game the board is redrawn completely only when the placed blocks changed, otherwise
+ * the Tetromino is cleared at its old position and drawn at the new one, and exposed areas are
+ * repainted with `repaint_region`. The running effects are drawn on top, the game over screen
+ * waits until the board filled up.
+ *
+ * @param rb The render backend.
+ * @param screens Pointer to the ScreenCache with the static screens.
+ * @param anims The effects started and advanced with the frames (`NULL`: no animations).
+ * @param prev The frame that is currently visible in the window.
+ * @param cur The frame to draw.
+ */
+void render_frame(RenderBackend *rb, ScreenCache *screens, Animations *anims, const Frame *prev, const Frame *cur) {
+	bool stateChanged = (prev->state != cur->state);
+	bool pieceMoved;
+
+	if(anims != NULL) {
+		schedule_effects(anims, prev, cur);
+		if(cur->state == STATE_GAME_OVER && anims->count > 0) {
+			if(draw_effects(anims, rb, screens, cur) > 0) {
+				return;
+			}
+			stateChanged = true; // the board is full, now the screen
+		}
+	}
+
+	switch(cur->state) {
+		case STATE_START:
+		case STATE_PAUSE:
+		case STATE_GAME_OVER:
+			if(stateChanged || needsRedraw) {
+				draw_screen(rb, screens, (cur->state == STATE_START) ? SCREEN_START : (cur->state == STATE_PAUSE) ? SCREEN_PAUSE : SCREEN_GAME_OVER);
+				needsRedraw = 0;
+				reset_expose_region();
+			}
+			break;
+
+		case STATE_GAME:
+			if(stateChanged || needsRedraw || prev->boardVersion != cur->boardVersion) {
+				// only redraw the board after the gameboard changed (i.e. a block was placed)
+				rb->clear(rb->ctx, SURFACE_WINDOW, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+				draw_board(rb, screens, &cur->board);
+				if(cur->hasPiece) {
+					draw_tetromino(rb, screens, SURFACE_WINDOW, &cur->piece);
+				}
+
+				needsRedraw = 0;
+				reset_expose_region();
+			} else {
+				pieceMoved = (prev->hasPiece != cur->hasPiece) || (cur->hasPiece && (prev->piece.col != cur->piece.col || prev->piece.row != cur->piece.row || prev->piece.fraction != cur->piece.fraction || prev->piece.rotationState != cur->piece.rotationState));
+				if(pieceMoved) {
+					if(prev->hasPiece) {
+						clear_tetromino(rb, &prev->piece);
+					}
+					if(cur->hasPiece) {
+						draw_tetromino(rb, screens, SURFACE_WINDOW, &cur->piece);
+					}
+					draw_border(rb); // clearing the blocks next to the border erases parts of it
+				}
+
+				if(!XEmptyRegion(exposeRegion)) {
+					// other windows passed over ours, repaint only what they damaged
+					repaint_region(rb, screens, &cur->board, cur->hasPiece ? &cur->piece : NULL, exposeRegion);
+					reset_expose_region();
+				}
+			}
+
+			if(anims != NULL && anims->count > 0) {
+				(void)draw_effects(anims, rb, screens, cur);
+			}
+			break;
+
+		default:
+			break;
+	}
+}
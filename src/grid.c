@@ -0,0 +1,354 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include "grid.h"
+
+/**
+ * @brief Lets the bot of a game play one tick and takes the snapshot that is drawn.
+ */
+static void step_one(Grid *grid, U32 index) {
+	bot_tick(&grid->bots[index], &grid->games[index]);
+	step_game(&grid->games[index], &grid->bots[index].queue);
+	snapshot_game(&grid->games[index], &grid->frames[index]);
+}
+
+/**
+ * @brief Steps games of the current tick until none is left, on any thread of the pool.
+ */
+static void run_games(Grid *grid) {
+	WorkerPool *pool = &grid->pool;
+	U32 index;
+
+	while((index = __atomic_fetch_add(&pool->claimed, 1, __ATOMIC_ACQ_REL)) < grid->count) {
+		step_one(grid, index);
+		if(__atomic_sub_fetch(&pool->pending, 1, __ATOMIC_ACQ_REL) == 0) {
+			pthread_mutex_lock(&pool->lock);
+			pthread_cond_signal(&pool->done);
+			pthread_mutex_unlock(&pool->lock);
+		}
+	}
+}
+
+/**
+ * @brief Worker thread: steps games whenever a tick begins.
+ *
+ * @param arg Pointer to the Grid.
+ * @return Always `NULL`.
+ */
+static void *grid_worker(void *arg) {
+	Grid *grid = arg;
+	WorkerPool *pool = &grid->pool;
+	U64 seen = 0;
+
+	while(true) {
+		pthread_mutex_lock(&pool->lock);
+		while(pool->running && pool->generation == seen) {
+			pthread_cond_wait(&pool->start, &pool->lock);
+		}
+		if(!pool->running) {
+			pthread_mutex_unlock(&pool->lock);
+			break;
+		}
+		seen = pool->generation;
+		pthread_mutex_unlock(&pool->lock);
+
+		run_games(grid);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Creates the games, their bots and the worker pool.
+ *
+ * Every game gets its own seed (`--seed` plus its index), so the boards differ. The boards
+ * are laid out for the game window, see `layout_grid`.
+ *
+ * @param grid The grid to initialize.
+ * @param count Number of games (1 to `GRID_MAX_BOARDS`).
+ * @param options The command line settings (seed, piece generator, DAS/ARR).
+ * @param workers Threads stepping the games including the caller of `step_grid` (`0`: one per CPU).
+ * @return `0` on success, `-1` on error.
+ */
+I8 init_grid(Grid *grid, U16 count, const Options *options, U8 workers) {
+	Options session = *options;
+	long cpus;
+	bool allocated;
+
+	memset(grid, 0, sizeof(*grid));
+	if(count == 0 || count > GRID_MAX_BOARDS) {
+		fprintf(stderr, "Error: the grid shows 1 to %d games\n", GRID_MAX_BOARDS);
+		return -1;
+	}
+
+	grid->count = count;
+	grid->games = calloc(count, sizeof(Game));
+	grid->bots = calloc(count, sizeof(Bot));
+	grid->frames = calloc(count, sizeof(Frame));
+	grid->drawn = calloc(count, sizeof(Frame));
+	allocated = (grid->games != NULL && grid->bots != NULL && grid->frames != NULL && grid->drawn != NULL);
+	for(U8 c=0;c<CELL_COLORS;c++) {
+		grid->batches[c] = malloc(count * (BOARD_WIDTH * BOARD_HEIGHT + 4) * sizeof(XRectangle));
+		allocated = allocated && (grid->batches[c] != NULL);
+	}
+	if(!allocated) {
+		fprintf(stderr, "Error: not enough memory for %u games\n", count);
+		free_grid(grid);
+		return -1;
+	}
+
+	session.metricsPath = NULL; // one file can not hold the metrics of every game
+	for(U16 i=0;i<count;i++) {
+		session.seed = (options->seed != 0) ? options->seed + i : 0;
+		init_session(&grid->games[i], &session, NULL);
+		init_bot(&grid->bots[i]);
+		snapshot_game(&grid->games[i], &grid->frames[i]);
+		grid->drawn[i] = grid->frames[i];
+	}
+	if(layout_grid(grid, WINDOW_WIDTH, WINDOW_HEIGHT) != 0) {
+		free_grid(grid);
+		return -1;
+	}
+
+	if(workers == 0) {
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		workers = (cpus > GRID_MAX_WORKERS) ? GRID_MAX_WORKERS : (cpus < 1) ? 1 : (U8)cpus;
+	}
+	workers = (workers > count) ? count : workers;
+	workers = (workers > GRID_MAX_WORKERS) ? GRID_MAX_WORKERS : workers;
+
+	pthread_mutex_init(&grid->pool.lock, NULL);
+	pthread_cond_init(&grid->pool.start, NULL);
+	pthread_cond_init(&grid->pool.done, NULL);
+	grid->pool.running = true;
+	grid->pool.claimed = count; // nothing to claim before the first tick
+	for(U8 i=1;i<workers;i++) {
+		if(pthread_create(&grid->pool.threads[grid->pool.count], NULL, grid_worker, grid) != 0) {
+			fprintf(stderr, "Error: could not start a grid worker, %u of %u are running\n", grid->pool.count + 1, workers);
+			break;
+		}
+		grid->pool.count++;
+	}
+	return 0;
+}
+
+/**
+ * @brief Places the boards in rows and columns with the biggest cells that fit.
+ *
+ * Every count of columns is tried, the boards keep one cell of space between each other.
+ * The cells never get bigger than in the single game window.
+ *
+ * @param grid The grid.
+ * @param width Width of the window (in px).
+ * @param height Height of the window (in px).
+ * @return `0` on success, `-1` if the boards do not fit.
+ */
+I8 layout_grid(Grid *grid, U16 width, U16 height) {
+	U16 cols, rows, bestCols = 1, cell, best = 0, left, top;
+
+	for(cols=1;cols<=grid->count;cols++) {
+		rows = (grid->count + cols - 1) / cols;
+		cell = (width - 2 * GRID_MARGIN) / (cols * (BOARD_WIDTH + 1));
+		cell = ((height - 2 * GRID_MARGIN) / (rows * (BOARD_HEIGHT + 1)) < cell) ? (height - 2 * GRID_MARGIN) / (rows * (BOARD_HEIGHT + 1)) : cell;
+		if(cell > best) {
+			best = cell;
+			bestCols = cols;
+		}
+	}
+	best = (best > CELL_SIZE) ? CELL_SIZE : best;
+	if(best < 2) {
+		fprintf(stderr, "Error: %u boards do not fit into %ux%u px\n", grid->count, width, height);
+		return -1;
+	}
+
+	rows = (grid->count + bestCols - 1) / bestCols;
+	left = (width - bestCols * (BOARD_WIDTH + 1) * best + best) / 2;
+	top = (height - rows * (BOARD_HEIGHT + 1) * best + best) / 2;
+	for(U16 i=0;i<grid->count;i++) {
+		grid->layouts[i] = (BoardLayout){left + (i % bestCols) * (BOARD_WIDTH + 1) * best, top + (i / bestCols) * (BOARD_HEIGHT + 1) * best, best};
+	}
+	return 0;
+}
+
+/**
+ * @brief Advances every game by one tick, spread over the worker pool.
+ *
+ * The calling thread steps games as well and returns once all of them were stepped, so
+ * the frames can be drawn right after.
+ *
+ * @param grid The grid.
+ */
+void step_grid(Grid *grid) {
+	WorkerPool *pool = &grid->pool;
+
+	if(pool->count == 0) {
+		for(U16 i=0;i<grid->count;i++) {
+			step_one(grid, i);
+		}
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	__atomic_store_n(&pool->pending, grid->count, __ATOMIC_RELEASE);
+	__atomic_store_n(&pool->claimed, 0, __ATOMIC_RELEASE); // a claim always sees the pending games
+	pool->generation++;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	run_games(grid);
+
+	pthread_mutex_lock(&pool->lock);
+	while(__atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE) > 0) {
+		pthread_cond_wait(&pool->done, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * @brief Whether a board has to be drawn again.
+ */
+static bool board_changed(const Frame *drawn, const Frame *frame) {
+	return drawn->state != frame->state || drawn->boardVersion != frame->boardVersion || drawn->hasPiece != frame->hasPiece
+		|| (frame->hasPiece && (drawn->piece.col != frame->piece.col || drawn->piece.row != frame->piece.row
+		|| drawn->piece.fraction != frame->piece.fraction || drawn->piece.rotationState != frame->piece.rotationState));
+}
+
+/**
+ * @brief Draws the boards that changed since they were drawn last, all in one batch per color.
+ *
+ * The changed boards are cleared and their blocks collected by color over the whole grid, so a
+ * frame costs one fill request per color however many boards there are. The blocks are flat,
+ * at the cell sizes of a grid the bevel of the atlas would be a single pixel and every block a
+ * copy request of its own. A finished game is drawn gray.
+ *
+ * @param rb The render backend.
+ * @param grid The grid with the frames of the last tick.
+ * @param full Draw the whole window (after it was exposed).
+ * @return The number of boards drawn.
+ */
+U16 render_grid(RenderBackend *rb, Grid *grid, bool full) {
+	XRectangle cells[BOARD_WIDTH * BOARD_HEIGHT];
+	XRectangle borders[4 * GRID_MAX_BOARDS];
+	XRectangle blocks[4];
+	U16 start[CELL_COLORS], end[CELL_COLORS];
+	U16 drawn = 0;
+	U8 count, color;
+	const BoardLayout *layout;
+	const Frame *frame;
+
+	memset(grid->batchCount, 0, sizeof(grid->batchCount));
+	if(full) {
+		rb->clear(rb->ctx, SURFACE_WINDOW, 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+	}
+
+	for(U16 i=0;i<grid->count;i++) {
+		frame = &grid->frames[i];
+		if(!full && !board_changed(&grid->drawn[i], frame)) {
+			continue;
+		}
+		layout = &grid->layouts[i];
+		if(!full) {
+			rb->clear(rb->ctx, SURFACE_WINDOW, layout->left, layout->top, BOARD_WIDTH * layout->cell, BOARD_HEIGHT * layout->cell);
+		}
+		border_rects(layout, &borders[4 * drawn]);
+
+		collect_cells(layout, &frame->board, NULL, cells, start, end);
+		for(U8 c=0;c<CELL_COLORS;c++) {
+			color = (frame->state == STATE_GAME_OVER) ? 0 : c;
+			memcpy(&grid->batches[color][grid->batchCount[color]], &cells[start[c]], (end[c] - start[c]) * sizeof(XRectangle));
+			grid->batchCount[color] += end[c] - start[c];
+		}
+		if(frame->hasPiece && frame->state == STATE_GAME) {
+			count = tetromino_blocks(layout, &frame->piece, blocks);
+			color = frame->piece.type % TETROMINO_TYPES + 1;
+			memcpy(&grid->batches[color][grid->batchCount[color]], blocks, count * sizeof(XRectangle));
+			grid->batchCount[color] += count;
+		}
+
+		grid->drawn[i] = *frame;
+		drawn++;
+	}
+
+	for(U8 c=0;c<CELL_COLORS;c++) {
+		if(grid->batchCount[c] > 0) {
+			rb->fill_rects(rb->ctx, SURFACE_WINDOW, cell_color(c), grid->batches[c], grid->batchCount[c]);
+		}
+	}
+	if(drawn > 0) {
+		rb->fill_rects(rb->ctx, SURFACE_WINDOW, COLOR_FOREGROUND, borders, 4 * drawn); // the blocks in the first row and column touch them
+	}
+	return drawn;
+}
+
+/**
+ * @brief Stops the worker pool and frees the games.
+ *
+ * @param grid The grid.
+ */
+void free_grid(Grid *grid) {
+	WorkerPool *pool = &grid->pool;
+
+	if(pool->running) {
+		pthread_mutex_lock(&pool->lock);
+		pool->running = false;
+		pthread_cond_broadcast(&pool->start);
+		pthread_mutex_unlock(&pool->lock);
+		for(U8 i=0;i<pool->count;i++) {
+			pthread_join(pool->threads[i], NULL);
+		}
+		pthread_mutex_destroy(&pool->lock);
+		pthread_cond_destroy(&pool->start);
+		pthread_cond_destroy(&pool->done);
+		pool->count = 0;
+	}
+
+	if(grid->games != NULL) {
+		for(U16 i=0;i<grid->count;i++) {
+			free_session(&grid->games[i]);
+		}
+	}
+	free(grid->games);
+	free(grid->bots);
+	free(grid->frames);
+	free(grid->drawn);
+	for(U8 c=0;c<CELL_COLORS;c++) {
+		free(grid->batches[c]);
+	}
+	memset(grid, 0, sizeof(*grid));
+}
+
+/**
+ * @brief Shows the bot games of the grid until the user closes the window.
+ *
+ * The games are stepped by the worker pool and drawn on a fixed tick, only the boards that
+ * changed are drawn again. Keys do nothing here.
+ *
+ * @param xw Pointer to the XWindow structure containing display and window info.
+ * @param rb The render backend drawing into the window.
+ * @param grid The initialized grid.
+ * @return `0` when the user exits.
+ */
+I8 run_grid(XWindow *xw, RenderBackend *rb, Grid *grid) {
+	InputQueue keys = {0};
+	InputEvent event;
+	U32 mousePos[2];
+	struct timespec deadline;
+	bool full;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	while(!recv_events(xw->display, &keys, mousePos)) {
+		while(pop_input(&keys, &event)); // the bots play, not the keyboard
+
+		step_grid(grid);
+		full = needsRedraw || !XEmptyRegion(exposeRegion);
+		(void)render_grid(rb, grid, full);
+		if(full) {
+			needsRedraw = 0;
+			reset_expose_region();
+		}
+		end_x_frame(&xAccounting);
+
+		wait_next_tick(&deadline, TICK_NS);
+	}
+	return 0;
+}
@@ -0,0 +1,33 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include "hash.h"
+
+/**
+ * @brief Continues an FNV-1a hash with more bytes.
+ *
+ * @param hash The hash of the bytes before (`FNV1A_BASIS` for none).
+ * @param data The bytes to hash.
+ * @param length Number of bytes.
+ * @return The 32 bit hash of all bytes.
+ */
+U32 fnv1a_update(U32 hash, const void *data, size_t length) {
+	const U8 *bytes = data;
+
+	for(size_t i=0;i<length;i++) {
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+/**
+ * @brief FNV-1a hash, the checksum of the files written by the game.
+ *
+ * @param data The bytes to hash.
+ * @param length Number of bytes.
+ * @return The 32 bit hash.
+ */
+U32 fnv1a(const void *data, size_t length) {
+	return fnv1a_update(FNV1A_BASIS, data, length);
+}
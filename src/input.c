@@ -1,28 +1,186 @@
 /// \file
+#define _POSIX_C_SOURCE 200809L
 
 #include "input.h"
 
+/**
+ * @brief Keys the game reacts to, every other key is reported as `KEY_ANY`.
+ */
+static const struct {
+	KeySym keysym;
+	KeyAction action;
+} keyMap[] = {
+	{XK_Up, KEY_UP},
+	{XK_Down, KEY_DOWN},
+	{XK_Left, KEY_LEFT},
+	{XK_Right, KEY_RIGHT},
+	{XK_Control_L, KEY_CTRL}, // both control keys should do the same thing (i.e. rotate against the clock)
+	{XK_Control_R, KEY_CTRL},
+	{XK_space, KEY_SPACE},
+	{XK_p, KEY_PAUSE},
+	{XK_P, KEY_PAUSE},
+	{XK_BackSpace, KEY_REWIND}
+};
+
+/**
+ * @brief Translates a KeySym into the action of the key.
+ *
+ * @param keysym The KeySym of the key event.
+ * @return The matching KeyAction, or `KEY_ANY` for keys without a function in the game.
+ */
+static KeyAction keysym_to_action(KeySym keysym) {
+	for(U8 i=0;i<sizeof(keyMap)/sizeof(keyMap[0]);i++) {
+		if(keyMap[i].keysym == keysym) {
+			return keyMap[i].action;
+		}
+	}
+	return KEY_ANY;
+}
+
+/**
+ * @brief Appends an event to the input queue.
+ *
+ * The queue is a lock-free single producer single consumer ring: only the producer writes
+ * `tail`, only the consumer writes `head`, the event is published with a release store.
+ *
+ * @param queue Pointer to the InputQueue.
+ * @param event The event to append.
+ * @return `true` on success, `false` if the queue is full (the event is dropped).
+ */
+bool push_input(InputQueue *queue, const InputEvent *event) {
+	U32 tail = queue->tail;
+
+	if(tail - __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) == INPUT_QUEUE_SIZE) {
+		queue->dropped++;
+		return false;
+	}
+
+	queue->events[tail & (INPUT_QUEUE_SIZE - 1)] = *event;
+	__atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+/**
+ * @brief Takes the oldest event out of the input queue.
+ *
+ * @param queue Pointer to the InputQueue.
+ * @param event Receives the event.
+ * @return `true` if an event was taken, `false` if the queue is empty.
+ */
+bool pop_input(InputQueue *queue, InputEvent *event) {
+	U32 head = queue->head;
+
+	if(head == __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE)) {
+		return false;
+	}
+
+	*event = queue->events[head & (INPUT_QUEUE_SIZE - 1)];
+	__atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+/**
+ * @brief Initializes the held key state with the configured repeat timing.
+ *
+ * @param input Pointer to the InputState to initialize.
+ * @param dasMs Delay before a held key starts to repeat (in ms).
+ * @param arrMs Interval between the repeated moves (in ms).
+ */
+void init_input(InputState *input, U32 dasMs, U32 arrMs) {
+	memset(input, 0, sizeof(*input));
+	input->dasMs = dasMs;
+	input->arrMs = arrMs;
+}
+
+/**
+ * @brief Evaluates the delayed auto shift for the held left/right keys.
+ *
+ * Called once per simulation tick. The first move happens on the key press itself, after
+ * `dasMs` the key repeats every `arrMs` (an ARR of 0 moves up to the wall at once). If both
+ * directions are held the most recently pressed one wins.
+ *
+ * @param input Pointer to the InputState holding the keys.
+ * @param shifts Receives the number of cells the tetromino has to be moved this tick.
+ * @return The direction to move in (`KEY_LEFT` or `KEY_RIGHT`), or `KEY_NOMOVE`.
+ */
+KeyAction get_repeat_shifts(InputState *input, U8 *shifts) {
+	KeyAction key;
+	I64 heldMs;
+	U32 due;
+
+	*shifts = 0;
+
+	if(input->held[KEY_LEFT] && (!input->held[KEY_RIGHT] || input->pressedNs[KEY_LEFT] > input->pressedNs[KEY_RIGHT])) {
+		key = KEY_LEFT;
+	} else if(input->held[KEY_RIGHT]) {
+		key = KEY_RIGHT;
+	} else {
+		return KEY_NOMOVE;
+	}
+
+	heldMs = (now_ns() - input->pressedNs[key]) / 1000000L;
+	if(heldMs < input->dasMs) {
+		return KEY_NOMOVE;
+	}
+
+	// number of repeats that should have happened by now
+	due = (input->arrMs == 0) ? BOARD_WIDTH : 1 + (U32)((heldMs - input->dasMs) / input->arrMs);
+	if(due > input->repeats[key]) {
+		*shifts = (due - input->repeats[key] > BOARD_WIDTH) ? BOARD_WIDTH : due - input->repeats[key];
+		input->repeats[key] = due;
+	}
+
+	return key;
+}
+
+/**
+ * @brief Updates the held key state with an event taken from the input queue.
+ *
+ * @param input Pointer to the InputState holding the keys.
+ * @param event The event taken from the queue.
+ * @return `true` if the event is a fresh key press the game should act on, `false` for releases
+ *         and for presses of keys that are already held (server side repeats).
+ */
+bool update_held(InputState *input, const InputEvent *event) {
+	if(event->action != KEY_LEFT && event->action != KEY_RIGHT && event->action != KEY_DOWN) {
+		return event->pressed;
+	}
+
+	if(!event->pressed) {
+		input->held[event->action] = false;
+		return false;
+	}
+
+	if(input->held[event->action]) {
+		return false;
+	}
+
+	input->held[event->action] = true;
+	input->pressedNs[event->action] = now_ns();
+	input->repeats[event->action] = 0;
+	return true;
+}
+
 /**
  * @brief Processes all pending X11 events, handling key presses, mouse clicks, window exposure, and client messages.
  *
- * This function retrieves and processes all pending events from the X server, handling different event types such as
- * key presses, mouse clicks, window exposures, and client messages. The function also updates the mouse position, 
- * modifies the key buffer with the appropriate input, and checks for exit conditions (e.g., pressing the Escape key or closing the window).
+ * This function retrieves and processes all pending events from the X server. Key presses and releases
+ * are translated through the key map and appended to the input queue in the order they arrived, so
+ * several inputs within one frame are all applied. The function also updates the mouse position
+ * and checks for exit conditions (e.g., pressing the Escape key or closing the window).
  *
  * @param display Pointer to the X11 Display structure representing the connection to the X server.
- * @param xic Input context used for handling input methods, such as translating key events into UTF-8 strings.
- * @param keyBuf Character buffer for storing key input, expected to be at least 32 bytes in size.
+ * @param queue Input queue the key and mouse events are appended to.
  * @param mousePos Array to store the x and y coordinates of the mouse when a ButtonPress event is detected.
  *
  * @return `True` if an exit condition is met (e.g., Escape key pressed or window closed), `False` otherwise.
  */
-bool recv_events(Display *display, XIC xic, char *keyBuf, U32 mousePos[2]) {
-	int length;
+bool recv_events(Display *display, InputQueue *queue, U32 mousePos[2]) {
+	KeySym keysym;      // Variable to store the KeySym
+	XEvent next;
 	bool exit = False; // Indicate whether to exit the proc
 
 	XEvent event = {0}; // Initialize the event structure
-	KeySym keysym;      // Variable to store the KeySym
-	Status status;      // Status variable for Xutf8LookupString
 
 	// Process all pending events from the X server
 	while (XPending(display) > 0) {
@@ -31,32 +189,33 @@ bool recv_events(Display *display, XIC xic, char *keyBuf, U32 mousePos[2]) {
 		switch (event.type) {
 			case KeyPress:
 				// Handle key press event
-
-				// Retrieve the key that was pressed and convert it to a UTF-8 string
-				length = Xutf8LookupString(xic, &event.xkey, keyBuf, (32 - 1), &keysym, &status);
+				keysym = XLookupKeysym(&event.xkey, 0);
 
 				if(keysym == XK_Escape) {
 					exit = True;
+					break;
 				}
 
-				if (status == XBufferOverflow) {
-					// Handle the case where the buffer is too small (should be rare with 32 bytes)
-					printf("Buffer overflow detected in Xutf8LookupString\n");
-				
-				} else if (status == XLookupChars || status == XLookupBoth) {
-					// Null-terminate the string if we got a valid UTF-8 string
-					keyBuf[length] = '\0';
-				
-				} else {
-					// Handle other statuses like Up Down etc. wich are not valid UTF-8 codes on its own
-					if(keysym == XK_Up || keysym == XK_Down || keysym == XK_Left || keysym == XK_Right) {
-						strcpy(keyBuf, XKeysymToString(keysym));
-
-					} else if(keysym == XK_Control_L || keysym == XK_Control_R) {
-						strcpy(keyBuf, "Control"); // both control keys should do the same thing (i.e. rotate against the clock)
+				push_input(queue, &(InputEvent){keysym_to_action(keysym), true, event.xkey.time});
+				break;
+
+			case KeyRelease:
+				// Without detectable auto repeat every repeat is a release directly followed by a press with the same time
+				if (XEventsQueued(display, QueuedAfterReading) > 0) {
+					XPeekEvent(display, &next);
+					if (next.type == KeyPress && next.xkey.time == event.xkey.time && next.xkey.keycode == event.xkey.keycode) {
+						break;
 					}
 				}
 
+				push_input(queue, &(InputEvent){keysym_to_action(XLookupKeysym(&event.xkey, 0)), false, event.xkey.time});
+				break;
+
+			case FocusOut:
+				// the release of a held key would go to another window, release them now
+				push_input(queue, &(InputEvent){KEY_LEFT, false, CurrentTime});
+				push_input(queue, &(InputEvent){KEY_RIGHT, false, CurrentTime});
+				push_input(queue, &(InputEvent){KEY_DOWN, false, CurrentTime});
 				break;
 
 			case ButtonPress:
@@ -65,12 +224,14 @@ bool recv_events(Display *display, XIC xic, char *keyBuf, U32 mousePos[2]) {
 					
 					mousePos[0] = (U32)event.xbutton.x;
 					mousePos[1] = (U32)event.xbutton.y;
-					strcpy(keyBuf, "MouseL");
+					push_input(queue, &(InputEvent){KEY_ANY, true, event.xbutton.time});
 				}
 				break;
 
 			case Expose:
-				// Handle window expose (redraw) event
+				// Handle window expose (redraw) event, collect the damaged rectangles for the game screen
+				XUnionRectWithRegion(&(XRectangle){event.xexpose.x, event.xexpose.y, event.xexpose.width, event.xexpose.height}, exposeRegion, exposeRegion);
+
 				if (event.xexpose.count == 0) {
 					// redraw the screen
 					needsRedraw = 1;
@@ -91,6 +252,7 @@ bool recv_events(Display *display, XIC xic, char *keyBuf, U32 mousePos[2]) {
 				break;
 		}
 	}
+	account_x_io(&xAccounting);
 	
 	return exit; // Return whether to exit the application
 }
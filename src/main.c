@@ -10,29 +10,30 @@
 
 Atom wm_delete_window;
 bool needsRedraw;
+Region exposeRegion;
+XAccounting xAccounting;
 
-
-// Function to calculate the time difference in nanoseconds
-long time_diff_ns(struct timespec start, struct timespec end) {
-    return (end.tv_sec - start.tv_sec) * 1000000000L + (end.tv_nsec - start.tv_nsec);
-}
-
-void handle_pause_key(char *keyBuffer, GameState *currentState) {
-    if (keyBuffer[0] == 'p' || keyBuffer[0] == 'P') {
-        *currentState = (*currentState == STATE_GAME) ? STATE_PAUSE : STATE_GAME;
-    }
-}
-
-int main(void) {
-	GameState currentState;
+#if !BENCHMARK // the benchmark has its own main, see bench.c
+int main(int argc, char **argv) {
 	Window parentWindow; // The root window of the screen
 	XWindow mainWindow;
-	XIM xim; // Input method
-	XIC xic; // Input context
-	XftFont *fontText; // Font for normal display text
-	XftFont *fontHeadlines; // Font for the headlines in the game
-	char keyBuffer[32]; // This Buffer will store all important events (UTF-8 keys, arrow keys or mousclick)
+	XftFont *fonts[FONT_COUNT]; // Fonts for normal display text and the headlines in the game
+	X11Backend x11; // Xlib/Xft drawing state
+	RenderBackend renderer; // Everything is drawn through this
+	ScreenCache screens; // Pre rendered start, pause and game over screens
+	InputQueue inputQueue = {0}; // Key presses and releases in the order they arrived
 	U32 mousePos[2];
+	Options options;
+	Game game; // The simulated game session
+	Leaderboard leaderboard; // Best games of all rounds, kept on disk
+	StreamServer stream; // Spectators watching the game (--serve)
+	ShmInterface shm = {0}; // Bots reading the game and sending inputs (--shm)
+	Grid grid; // Bot games shown instead of the own game (--grid)
+	Frame previousFrame; // The frame currently visible in the window
+	Frame currentFrame; // The snapshot of the latest tick
+	Frame tickFrame; // The snapshot of the tick before
+	Frame shownFrame; // The frame drawn next, the falling piece interpolated between the ticks
+	Animations animations; // The effects drawn over the frames
 
 	// Initial window position and size
 	U32 posX = 1;
@@ -41,21 +42,52 @@ int main(void) {
 	U64 bgColor; // background color
 	U64 bdColor; // border color
 
-	// delta time related
-	long deltaTimeNs;
-	struct timespec previousTime;
-	struct timespec currentTime;
-	struct timespec sleepTime;
+	// fixed simulation tick, the frames are drawn at their own rate
+	I64 now, nextTick, nextFrame;
+	long frameNs;
+	struct timespec started; // beginning of the startup
+	bool firstFrame;
+	int status = 0; // returned after the cleanup
+
+	clock_gettime(CLOCK_MONOTONIC, &started);
+	switch (parse_options(&options, argc, argv)) {
+		case 0: break;
+		case 1: return 0;  // only the usage was shown
+		default: return -1;
+	}
+	(void)set_view_scale(options.scale); // checked by parse_options
+	start_font_loading(); // fontconfig works in the background while the window is created
+	load_scores(&leaderboard, options.scoresPath);
+	(void)start_writer(); // without the thread the scores are written directly
+	init_session(&game, &options, &leaderboard);
+	begin_startup(&game.metrics, &started, options.traceStartup);
+	if (resume_game(&game, options.snapshotPath) == 0) {
+		printf("Resumed the saved game, press P to continue\n");
+	}
+	printf("Seed %lu\n", (unsigned long)game.rng.seed); // replay the pieces with --seed
+	if (options.servePath != NULL && init_stream_server(&stream, options.servePath) != 0) {
+		status = -1;
+		goto end_session;
+	}
+	if (options.shmName != NULL && init_shm_interface(&shm, options.shmName) != 0) {
+		status = -1;
+		goto free_stream;
+	}
+	mark_startup(&game.metrics, STARTUP_SESSION);
 
-	bool gameInit = 0;
-	U64 highscore = 0;
-	GameBoard board;
-	Tetromino *currentTetromino = NULL;
+	// has to be the first Xlib call, the display is shared by the X I/O and the render thread
+	if (options.threaded && !XInitThreads()) {
+		fprintf(stderr, "Error: Xlib has no thread support\n");
+		status = -1;
+		goto free_shm;
+	}
 
 	if ((mainWindow.display = XOpenDisplay(NULL)) == NULL) {
 		fprintf(stderr, "Error: could not open connection to X Server (i.e. default display)\n");
-		return -1;
+		status = -1;
+		goto free_shm;
 	}
+	mark_startup(&game.metrics, STARTUP_DISPLAY);
 
 	// Get the default root window (typically the entire screen)
 	parentWindow = XDefaultRootWindow(mainWindow.display);
@@ -77,129 +109,124 @@ int main(void) {
 	);
 	
 	// Initialize the window with required properties and mappings
-	if (init_main_window(mainWindow.display, mainWindow.window, &xim, &xic) != 0) {
-		return -1;
+	if (init_main_window(mainWindow.display, mainWindow.window) != 0) {
+		status = -1;
+		goto close_display;
 	}
 
 	init_graphics(&mainWindow); 
+	mark_startup(&game.metrics, STARTUP_WINDOW);
 	
-	// Load font
-	fontText = init_font(&mainWindow, "Nimbus Sans L-12");
-	fontHeadlines = init_font(&mainWindow, "Nimbus Sans L-62");
-	if(fontText == NULL || fontHeadlines == NULL) {
+	// Open the fonts resolved in the meantime
+	if (finish_font_loading(&mainWindow, fonts) != 0) {
 		fprintf(stderr, "Ensure your Fonts are installed correctly\n");
-		return -1;
+		status = -1;
+		goto free_gc;
 	}
+	init_x11_backend(&renderer, &x11, &mainWindow, fonts[FONT_TEXT], fonts[FONT_HEADLINE]);
+	mark_startup(&game.metrics, STARTUP_FONTS);
+	if (options.xStats) {
+		account_backend(&xAccounting, &renderer, mainWindow.display, true);
+	}
+	init_screens(&screens);
+	exposeRegion = XCreateRegion();
 
-	// load_score(); // TODO
-
-	currentState = STATE_START;
-	clock_gettime(CLOCK_MONOTONIC, &previousTime);
-	while(true) {
-		// Main event loop (not game loop)
-		memset(keyBuffer, 0, 32); // Reset the buffer after handling the key press
-		
-		// Process events and check if the user wants to exit
-		if (recv_events(mainWindow.display, xic, keyBuffer, mousePos)) {
-			break;
+	if (options.viewPath != NULL) {
+		if (run_viewer(&mainWindow, &renderer, &screens, options.viewPath) != 0) {
+			status = -1;
 		}
-		
-		// Calculate the delta time for this frame
-		clock_gettime(CLOCK_MONOTONIC, &currentTime);
-		deltaTimeNs = time_diff_ns(previousTime, currentTime);
-		previousTime = currentTime;
-
-		switch(currentState) {
-			
-			case STATE_START:
-				if(needsRedraw) {
-					draw_start_screen(&mainWindow, fontText, fontHeadlines);
-					needsRedraw = 0;
-				}
-
-				if (keyBuffer[0] != '\0') {
-					// the user pressed any key to start
-					XClearWindow(mainWindow.display, mainWindow.window);
-					currentState = STATE_GAME;
-					needsRedraw = 1;
-				}
-				break;
-
-			case STATE_GAME:
-				if(!gameInit) {
-					init_game(&board);
-					board.score = 0;
-					board.level = 1;
-					board.highscore = highscore;
-					gameInit = 1;
-				}
-
-				handle_pause_key(keyBuffer, &currentState);
 
-				if(currentTetromino == NULL) {
-					currentTetromino = get_tetromino();
-					// only redraw the board after the gamboard changed (i.e. a block was placed)
-					XClearWindow(mainWindow.display, mainWindow.window);
-					draw_board(&mainWindow, &board, fontText);
-				
-				} else {
-					if(move_tetromino(&mainWindow, &board, currentTetromino, keyBuffer)) {
-						free_tetromino(&currentTetromino);
-						currentState = remove_full_row(&board); // this function checks if the user is gameover
-					}
+	} else if (options.gridBoards > 0) {
+		if (init_grid(&grid, options.gridBoards, &options, 0) == 0) {
+			(void)run_grid(&mainWindow, &renderer, &grid);
+			free_grid(&grid);
+		} else {
+			status = -1;
+		}
 
-					update_game(&mainWindow, &currentTetromino); // draw the elements on the screen
-				}
-				break;
+	} else if (options.threaded) {
+		if (run_threaded(&mainWindow, &renderer, &game, &screens, options.servePath ? &stream : NULL, options.shmName ? &shm : NULL, options.frameRate) != 0) {
+			status = -1;
+		}
 
-			case STATE_PAUSE:
-				handle_pause_key(keyBuffer, &currentState);
+	} else {
+		frameNs = (options.frameRate > 0) ? 1000000000L / options.frameRate : 0;
+		snapshot_game(&game, &currentFrame);
+		nextTick = nextFrame = currentFrame.time = now_ns();
+		previousFrame = tickFrame = currentFrame;
+		init_animations(&animations, &previousFrame);
+		while(true) {
+			// Process events and check if the user wants to exit
+			if (recv_events(mainWindow.display, &inputQueue, mousePos)) {
 				break;
-			
-			case STATE_GAME_OVER:
-				if(needsRedraw) {
-					draw_end_screen(&mainWindow, fontText, fontHeadlines);
-					needsRedraw = 0;
+			}
+			(void)pump_shm_inputs(&shm, &inputQueue); // the inputs of bots (--shm)
+
+			// Run the ticks that are due, a tick late by too much is skipped
+			while ((now = now_ns()) >= nextTick) {
+				step_game(&game, &inputQueue);
+				tickFrame = currentFrame;
+				snapshot_game(&game, &currentFrame);
+				currentFrame.time = nextTick;
+				if (options.servePath != NULL) {
+					stream_frame(&stream, &currentFrame);
 				}
+				publish_shm_state(&shm, &game);
+				nextTick = (now - nextTick > MAX_CATCH_UP_TICKS * TICK_NS) ? now + TICK_NS : nextTick + TICK_NS;
+			}
 
-				if(keyBuffer[0] != '\0') {
-					// the user pressed any key to start again
-					XClearWindow(mainWindow.display, mainWindow.window);
-					currentState = STATE_START;
-					needsRedraw = 1;
-					highscore = board.highscore;
-					free_game(&board);
-					gameInit = 0;
-					break;
+			if (now >= nextFrame) {
+				if (frameNs < TICK_NS) {
+					interpolate_frame(&tickFrame, &currentFrame, now - currentFrame.time, &shownFrame);
+				} else {
+					shownFrame = currentFrame;
 				}
-
+				firstFrame = needsRedraw && game.metrics.startup[STARTUP_FIRST_FRAME] == 0; // the first expose of the window
+				render_frame(&renderer, &screens, &animations, &previousFrame, &shownFrame);
+				previousFrame = shownFrame;
+				if (firstFrame) {
+					renderer.flush(renderer.ctx);
+					mark_startup(&game.metrics, STARTUP_FIRST_FRAME);
+				}
+				end_x_frame(&xAccounting);
+				count_frame(&game.metrics, nextFrame, (frameNs > 0) ? frameNs : TICK_NS);
+				nextFrame = (now - nextFrame > MAX_CATCH_UP_TICKS * frameNs) ? now + frameNs : nextFrame + frameNs;
 			}
 
-
-		// Sleep to maintain approximately 60 FPS
-		const long frameTimeNs = 1000000000L / 60; // 60 FPS
-		if(deltaTimeNs < frameTimeNs) {
-			
-			sleepTime.tv_sec = 0;
-			sleepTime.tv_nsec = frameTimeNs - deltaTimeNs;
-			nanosleep(&sleepTime, NULL);
+			// Sleep until the next tick or frame is due (--fps 0 draws without a pause)
+			sleep_until_ns((nextTick < nextFrame) ? nextTick : nextFrame);
 		}
-		
 	}
 	
-	// Cleanup
-	if(gameInit) {
-		free_game(&board);
+	// Cleanup, a failed startup enters it at the first step that has something to release
+	save_game(&game); // resumed on the next start
+	export_metrics(&game.metrics);
+	if (options.xStats) {
+		print_x_summary(&xAccounting);
 	}
 
-	XftFontClose(mainWindow.display, fontText);
-	XftFontClose(mainWindow.display, fontHeadlines);
+	XDestroyRegion(exposeRegion);
+	free_screens(&renderer, &screens);
+	free_x11_backend(&x11);
+	for (U8 i = 0; i < FONT_COUNT; i++) {
+		XftFontClose(mainWindow.display, fonts[i]);
+	}
+free_gc:
 	XFreeGC(mainWindow.display, mainWindow.gc);
-	XDestroyIC(xic);
-	XCloseIM(xim);
+close_display:
 	XCloseDisplay(mainWindow.display);
+free_shm:
+	free_shm_interface(&shm);
+free_stream:
+	if (options.servePath != NULL) {
+		free_stream_server(&stream);
+	}
+end_session:
+	join_font_loader(); // still running if the window was never created
+	free_session(&game);
+	stop_writer(); // finish the pending leaderboard, snapshot and metrics updates
+	free_scores(&leaderboard);
 
-	// save_score(); // TODO
-   
-	return 0;
+	return status;
 }
+#endif
@@ -0,0 +1,169 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include "metrics.h"
+
+/**
+ * @brief Appends formatted text to the exposition buffer.
+ *
+ * @param buffer The buffer.
+ * @param capacity Size of the buffer.
+ * @param length Used length of the buffer, advanced by the appended text (stays at `capacity` once it is full).
+ * @param format printf format of the text.
+ */
+static void append(char *buffer, U32 capacity, U32 *length, const char *format, ...) {
+	va_list args;
+	int written;
+
+	if(*length >= capacity) {
+		return;
+	}
+
+	va_start(args, format);
+	written = vsnprintf(buffer + *length, capacity - *length, format, args);
+	va_end(args);
+
+	*length = (written < 0 || (U32)written >= capacity - *length) ? capacity : *length + (U32)written;
+}
+
+/**
+ * @brief Appends a metric without labels together with its HELP and TYPE lines.
+ *
+ * @param buffer The buffer.
+ * @param capacity Size of the buffer.
+ * @param length Used length of the buffer.
+ * @param name Name of the metric (without the `cubes_` prefix).
+ * @param type `counter` or `gauge`.
+ * @param help Description of the metric.
+ * @param value The current value.
+ */
+static void append_metric(char *buffer, U32 capacity, U32 *length, const char *name, const char *type, const char *help, double value) {
+	append(buffer, capacity, length, "# HELP cubes_%s %s\n# TYPE cubes_%s %s\ncubes_%s %.15g\n", name, help, name, type, name, value);
+}
+
+/**
+ * @brief Resets the counters of a session.
+ *
+ * @param metrics Pointer to the Metrics to initialize.
+ * @param path Textfile the metrics are exported to (`NULL`: only counted).
+ */
+void init_metrics(Metrics *metrics, const char *path) {
+	memset(metrics, 0, sizeof(*metrics));
+	metrics->path = path;
+}
+
+/**
+ * @brief Counts a rendered frame.
+ *
+ * Safe to call from the render thread while the simulation exports the metrics.
+ *
+ * @param metrics Pointer to the Metrics.
+ * @param due When the frame was due (its deadline, see `now_ns`), the frame is over budget if
+ *            it was finished more than `budgetNs` later.
+ * @param budgetNs The time between two frames (in ns).
+ */
+void count_frame(Metrics *metrics, I64 due, long budgetNs) {
+	__atomic_fetch_add(&metrics->framesRendered, 1, __ATOMIC_RELAXED);
+	if(now_ns() - due > budgetNs) {
+		__atomic_fetch_add(&metrics->framesOverBudget, 1, __ATOMIC_RELAXED);
+	}
+}
+
+/**
+ * @brief Writes the metrics in the Prometheus text exposition format.
+ *
+ * @param metrics Pointer to the Metrics.
+ * @param buffer Receives the text (always terminated).
+ * @param capacity Size of the buffer.
+ * @return Length of the text, `capacity` if it did not fit.
+ */
+U32 format_metrics(const Metrics *metrics, char *buffer, U32 capacity) {
+	double seconds = (double)metrics->gameTicks / TICK_RATE;
+	U32 length = 0;
+
+	append_metric(buffer, capacity, &length, "pieces_placed_total", "counter", "Tetrominos placed on the board.", metrics->piecesPlaced);
+
+	append(buffer, capacity, &length, "# HELP cubes_lines_cleared_total Rows cleared, by the number of rows cleared at once.\n# TYPE cubes_lines_cleared_total counter\n");
+	for(U8 i=0;i<METRICS_LINE_SIZES;i++) {
+		append(buffer, capacity, &length, "cubes_lines_cleared_total{size=\"%u\"} %lu\n", i + 1, (unsigned long)metrics->linesCleared[i]);
+	}
+
+	append_metric(buffer, capacity, &length, "inputs_total", "counter", "Key presses applied to a falling Tetromino.", metrics->inputs);
+	append_metric(buffer, capacity, &length, "games_started_total", "counter", "Games started.", metrics->gamesStarted);
+	append_metric(buffer, capacity, &length, "frames_rendered_total", "counter", "Frames rendered.", __atomic_load_n(&metrics->framesRendered, __ATOMIC_RELAXED));
+	append_metric(buffer, capacity, &length, "frames_over_budget_total", "counter", "Frames finished later than one frame period after they were due.", __atomic_load_n(&metrics->framesOverBudget, __ATOMIC_RELAXED));
+	append_metric(buffer, capacity, &length, "game_duration_seconds", "gauge", "Duration of the current or last game, pauses excluded.", seconds);
+	append_metric(buffer, capacity, &length, "pieces_per_second", "gauge", "Pieces placed per second in the current or last game.", (seconds > 0) ? metrics->gamePieces / seconds : 0);
+	append_metric(buffer, capacity, &length, "inputs_per_minute", "gauge", "Inputs per minute in the current or last game.", (seconds > 0) ? metrics->gameInputs * 60 / seconds : 0);
+	append_metric(buffer, capacity, &length, "rewinds_total", "counter", "Placements taken back with the rewind key.", metrics->rewinds);
+	append_metric(buffer, capacity, &length, "rewind_entries", "gauge", "Placements that can currently be taken back.", metrics->rewindEntries);
+	append_metric(buffer, capacity, &length, "rewind_bytes", "gauge", "Memory of the rewind buffer.", metrics->rewindBytes);
+	append_metric(buffer, capacity, &length, "startup_seconds", "gauge", "Time from the start of the process to the first frame (0 until it is drawn).",
+		__atomic_load_n(&metrics->startup[STARTUP_FIRST_FRAME], __ATOMIC_RELAXED) / 1e9);
+
+	return length;
+}
+
+/**
+ * @brief Writes the metrics to their textfile.
+ *
+ * The file is replaced atomically by the writer thread, so a textfile collector never
+ * reads a partial file. Nothing is done if no path was given.
+ *
+ * @param metrics Pointer to the Metrics.
+ */
+void export_metrics(const Metrics *metrics) {
+	char buffer[METRICS_BUFFER_SIZE];
+	U32 length;
+
+	if(metrics->path == NULL) {
+		return;
+	}
+
+	length = format_metrics(metrics, buffer, sizeof(buffer));
+	if(length >= sizeof(buffer)) {
+		fprintf(stderr, "Error: metrics do not fit into %d bytes\n", METRICS_BUFFER_SIZE);
+		return;
+	}
+	submit_write(WRITE_SLOT_METRICS, metrics->path, buffer, length, false);
+}
+
+/**
+ * @brief Sets the reference time of the startup phases.
+ *
+ * @param metrics Pointer to the Metrics (after `init_metrics`).
+ * @param begin When the process started its initialization.
+ * @param trace Print the phases once the first frame is drawn.
+ */
+void begin_startup(Metrics *metrics, const struct timespec *begin, bool trace) {
+	metrics->startupBegin = (I64)begin->tv_sec * 1000000000L + begin->tv_nsec;
+	metrics->traceStartup = trace;
+}
+
+/**
+ * @brief Records that a phase of the startup is done.
+ *
+ * The first frame is marked by the render thread when the pipeline is threaded.
+ * With tracing enabled all phases are printed when the first frame is marked.
+ *
+ * @param metrics Pointer to the Metrics.
+ * @param phase The finished phase.
+ */
+void mark_startup(Metrics *metrics, StartupPhase phase) {
+	static const char *phaseNames[STARTUP_PHASE_COUNT] = {"session", "display", "window", "fonts", "first frame"};
+	struct timespec now;
+	I64 previous = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	__atomic_store_n(&metrics->startup[phase], (I64)now.tv_sec * 1000000000L + now.tv_nsec - metrics->startupBegin, __ATOMIC_RELAXED);
+
+	if(phase != STARTUP_FIRST_FRAME || !metrics->traceStartup) {
+		return;
+	}
+
+	printf("Startup:");
+	for(U8 i=0;i<STARTUP_PHASE_COUNT;i++) {
+		printf(" %s %.1f ms (+%.1f)%s", phaseNames[i], metrics->startup[i] / 1e6, (metrics->startup[i] - previous) / 1e6, (i + 1 < STARTUP_PHASE_COUNT) ? "," : "\n");
+		previous = metrics->startup[i];
+	}
+}
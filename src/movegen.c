@@ -0,0 +1,221 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include "movegen.h"
+
+// index of a (col, row, rotation) state, col is the left edge of the 4x4 shape
+#define STATE_INDEX(col, row, rotation) ((((rotation) * BOARD_HEIGHT) + (row)) * MOVEGEN_COLS + (col) + 3)
+#define STATE_COL(index) ((I8)((index) % MOVEGEN_COLS) - 3)
+#define STATE_ROW(index) ((I8)((index) / MOVEGEN_COLS % BOARD_HEIGHT))
+#define STATE_ROTATION(index) ((U8)((index) / (MOVEGEN_COLS * BOARD_HEIGHT)))
+#define LOCK_KEYS (4 * BOARD_HEIGHT * BOARD_WIDTH)
+#define NO_PARENT 0xffff
+#define STEP_COUNT 5
+
+/**
+ * @brief An input and how it changes the state of the piece.
+ */
+typedef struct {
+	KeyAction action;
+	I8 col;
+	I8 row;
+	U8 rotation;	///< Quarter turns clockwise
+} MoveStep;
+
+static const MoveStep steps[STEP_COUNT] = {
+	{KEY_LEFT, -1, 0, 0},
+	{KEY_RIGHT, 1, 0, 0},
+	{KEY_UP, 0, 0, 1},	// clockwise
+	{KEY_CTRL, 0, 0, 3},	// counter clockwise
+	{KEY_DOWN, 0, 1, 0}	// one row of soft drop
+};
+
+/**
+ * @brief The board and piece as row masks, so a collision test is 4 ANDs.
+ */
+typedef struct {
+	U16 rows[BOARD_HEIGHT + 3];	///< Filled cells and walls, the rows below the board are solid
+	U16 shape[4][4];			///< Rows of every rotation of the 4x4 shape (bit j is column j)
+	U8 canonical[4];			///< First rotation with the same cells (O, I, S and Z repeat theirs)
+	I8 minCol[4];				///< Leftmost column of the cells inside the 4x4 shape
+	I8 minRow[4];				///< Topmost row of the cells inside the 4x4 shape
+	U8 sky;						///< Rows of open air below the spawn row, the 4x4 shape touches no cell above
+} MoveBoard;
+
+/**
+ * @brief Whether a piece state is free, the same rules as `collides` in game.c.
+ *
+ * Every cell has to be inside the board and on an empty cell, states are only searched at
+ * `fraction == 0` (the stricter test of a piece between two rows allows nothing more).
+ */
+static inline bool fits(const MoveBoard *mb, I8 col, I8 row, U8 rotation) {
+	return ((mb->rows[row] & (mb->shape[rotation][0] << (col + 3)))
+		| (mb->rows[row + 1] & (mb->shape[rotation][1] << (col + 3)))
+		| (mb->rows[row + 2] & (mb->shape[rotation][2] << (col + 3)))
+		| (mb->rows[row + 3] & (mb->shape[rotation][3] << (col + 3)))) == 0;
+}
+
+/**
+ * @brief Converts the board and the rotations of a tetromino into row masks.
+ */
+static void init_move_board(MoveBoard *mb, const GameBoard *board, U8 type) {
+	U16 rotation, cells[4];
+
+	U8 top = BOARD_HEIGHT;
+
+	for(U8 y=0;y<BOARD_HEIGHT;y++) {
+		mb->rows[y] = MOVEGEN_WALLS;
+		for(U8 x=0;x<BOARD_WIDTH;x++) {
+			mb->rows[y] |= (U16)(board->state[x][y] != 0) << (x + 3);
+		}
+		if(mb->rows[y] != MOVEGEN_WALLS && y < top) {
+			top = y;
+		}
+	}
+	mb->sky = (top > 4) ? top - 4 : 0;
+	for(U8 y=BOARD_HEIGHT;y<BOARD_HEIGHT+3;y++) {
+		mb->rows[y] = 0xffff;
+	}
+
+	for(U8 r=0;r<4;r++) {
+		rotation = tetrominos[type].rotations[r];
+		mb->minCol[r] = mb->minRow[r] = 3;
+		for(U8 i=0;i<4;i++) {
+			mb->shape[r][i] = (rotation >> (i * 4)) & 0xf;
+			if(mb->shape[r][i] != 0 && i < mb->minRow[r]) {
+				mb->minRow[r] = i;
+			}
+			for(U8 j=0;j<4;j++) {
+				if((mb->shape[r][i] & (1 << j)) && j < mb->minCol[r]) {
+					mb->minCol[r] = j;
+				}
+			}
+		}
+
+		// the cells moved to the top left corner, equal for rotations that look the same
+		cells[r] = 0;
+		for(U8 i=mb->minRow[r];i<4;i++) {
+			cells[r] |= (mb->shape[r][i] >> mb->minCol[r]) << ((i - mb->minRow[r]) * 4);
+		}
+		mb->canonical[r] = r;
+		for(U8 k=0;k<r;k++) {
+			if(cells[k] == cells[r]) {
+				mb->canonical[r] = mb->canonical[k];
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Finds every lock position of a piece with a breadth first search over its states.
+ *
+ * Starting at the spawn position the piece is shifted, rotated (no wall kicks, as in
+ * `move_tetromino`) and soft dropped one row at a time, each state is visited once. From every
+ * state that was not reached by a soft drop the piece is also hard dropped, which gives the
+ * lock positions including tucks and spins under overhangs. The search runs in order of input
+ * count, so the first sequence found for a lock position is a shortest one. Rotations with the
+ * same cells lock in the same position and are reported once.
+ *
+ * Above the stack only walls can stop the piece, every shift and rotation there is just as
+ * possible in the spawn row. So the soft drop from the spawn row goes through the open air in
+ * one step (as that many `KEY_DOWN` inputs), the states in between are never visited. These
+ * states wait in a second queue and are merged in by their input count.
+ *
+ * @param board The board the piece moves on.
+ * @param type The tetromino type, it spawns like `get_tetromino`.
+ * @param list Receives the moves, in order of input count.
+ * @return The number of moves (`0` if the piece can not spawn).
+ */
+U16 generate_moves(const GameBoard *board, U8 type, MoveList *list) {
+	MoveBoard mb;
+	U64 visited[(MOVEGEN_STATES + 63) / 64] = {0};
+	U64 locked[(LOCK_KEYS + 63) / 64] = {0};
+	U16 queue[MOVEGEN_STATES];
+	U16 seeds[4 * MOVEGEN_COLS];	// states at the bottom of the open air, by input count
+	U16 parent[MOVEGEN_STATES];
+	U8 via[MOVEGEN_STATES];
+	U8 depth[MOVEGEN_STATES];
+	U16 head = 0, tail = 0, seedHead = 0, seedTail = 0, state, next, key, walk;
+	I8 col, row, landed, nextCol, nextRow;
+	U8 rotation, canonical, nextRotation, nextDepth;
+	Move *move;
+
+	list->count = 0;
+	list->states = 0;
+	type %= TETROMINO_TYPES;
+	init_move_board(&mb, board, type);
+	if(!fits(&mb, SPAWN_COLUMN, 0, 0)) {
+		return 0;
+	}
+
+	state = STATE_INDEX(SPAWN_COLUMN, 0, 0);
+	visited[state / 64] |= 1ULL << (state % 64);
+	parent[state] = NO_PARENT;
+	via[state] = (U8)KEY_NOMOVE;
+	depth[state] = 0;
+	queue[tail++] = state;
+
+	while(head < tail || seedHead < seedTail) {
+		if(head < tail && (seedHead == seedTail || depth[queue[head]] <= depth[seeds[seedHead]])) {
+			state = queue[head++];
+		} else {
+			state = seeds[seedHead++];
+		}
+		col = STATE_COL(state);
+		row = STATE_ROW(state);
+		rotation = STATE_ROTATION(state);
+
+		for(U8 i=0;i<STEP_COUNT;i++) {
+			nextCol = col + steps[i].col;
+			nextRow = row + steps[i].row;
+			nextRotation = (rotation + steps[i].rotation) % 4;
+			nextDepth = depth[state] + 1;
+			if(steps[i].action == KEY_DOWN && row == 0 && mb.sky > 1) {
+				nextRow = mb.sky;
+				nextDepth = depth[state] + mb.sky;
+			}
+			// a longer sequence would not fit into a Move
+			if(nextDepth >= MOVEGEN_MAX_INPUTS || nextCol < -3 || nextCol >= BOARD_WIDTH || nextRow >= BOARD_HEIGHT) {
+				continue;
+			}
+			next = STATE_INDEX(nextCol, nextRow, nextRotation);
+			if((visited[next / 64] & (1ULL << (next % 64))) || !fits(&mb, nextCol, nextRow, nextRotation)) {
+				continue;
+			}
+			visited[next / 64] |= 1ULL << (next % 64);
+			parent[next] = state;
+			via[next] = steps[i].action;
+			depth[next] = nextDepth;
+			if(nextDepth == depth[state] + 1) {
+				queue[tail++] = next;
+			} else {
+				seeds[seedTail++] = next;
+			}
+		}
+
+		// a state below a free one locks in the same place as the one above, with one input more
+		if(via[state] == KEY_DOWN || list->count == MOVEGEN_MAX_MOVES) {
+			continue;
+		}
+		for(landed=(row < mb.sky) ? mb.sky : row;fits(&mb, col, landed + 1, rotation);landed++);
+
+		canonical = mb.canonical[rotation];
+		key = (canonical * BOARD_HEIGHT + landed + mb.minRow[rotation]) * BOARD_WIDTH + col + mb.minCol[rotation];
+		if(locked[key / 64] & (1ULL << (key % 64))) {
+			continue;
+		}
+		locked[key / 64] |= 1ULL << (key % 64);
+
+		move = &list->moves[list->count++];
+		move->placement = (Placement){type, rotation, col, landed};
+		move->length = depth[state] + 1;
+		move->inputs[depth[state]] = KEY_SPACE;
+		for(walk=state;parent[walk]!=NO_PARENT;walk=parent[walk]) {
+			memset(move->inputs + depth[parent[walk]], via[walk], depth[walk] - depth[parent[walk]]);
+		}
+	}
+
+	list->states = tail + seedTail;
+	return list->count;
+}
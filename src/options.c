@@ -0,0 +1,194 @@
+/// \file
+
+#include "options.h"
+
+/**
+ * @brief Prints the command line usage.
+ *
+ * @param name The name the binary was started with.
+ */
+static void print_usage(const char *name) {
+	printf("Usage: %s [options]\n", name);
+	printf("  --das <ms>        delay before a held left/right key repeats (default %d)\n", DEFAULT_DAS_MS);
+	printf("  --arr <ms>        interval of the repeated moves, 0 moves to the wall (default %d)\n", DEFAULT_ARR_MS);
+	printf("  --scores <file>   leaderboard file (default $HOME/%s)\n", SCORES_FILE_NAME);
+	printf("  --snapshot <file> running game saved on exit and resumed on start (default $HOME/%s)\n", SNAPSHOT_FILE_NAME);
+	printf("  --seed <n>        seed of the piece sequence, the same seed plays the same pieces (default: random)\n");
+	printf("  --rng <mode>      piece generator: counter (default) or bbs\n");
+	printf("  --threaded        read X events, simulate and render on separate threads\n");
+	printf("  --fps <n>         frames drawn per second, e.g. 120, 144 or 240 (0: unlimited, default %d)\n", TICK_RATE);
+	printf("  --scale <n>       draw the window n times larger (1 to %d, default 1)\n", VIEW_SCALE_MAX);
+	printf("  --serve <socket>  publish the game to spectators on a Unix socket\n");
+	printf("  --view <socket>   watch a game published with --serve\n");
+	printf("  --shm <name>      publish the game and take inputs in shared memory /<name> (for bots)\n");
+	printf("  --grid <n>        show n games played by bots in one window (1 to %d)\n", GRID_MAX_BOARDS);
+	printf("  --metrics <file>  write gameplay metrics to a Prometheus textfile\n");
+	printf("  --xstats          show the X requests, bytes and round trips per frame\n");
+	printf("  --trace-startup   print how long each phase of the startup took\n");
+	printf("  --help            show this message\n");
+}
+
+/**
+ * @brief Parses an unsigned number argument of an option.
+ *
+ * @param option The name of the option (for the error message).
+ * @param value The argument string.
+ * @param out Where the number is stored.
+ * @return `0` on success, `-1` if the argument is missing or not a number.
+ */
+static I8 parse_number(const char *option, const char *value, U32 *out) {
+	char *end;
+	unsigned long number;
+
+	if(value == NULL) {
+		fprintf(stderr, "Error: option %s needs a value\n", option);
+		return -1;
+	}
+
+	number = strtoul(value, &end, 10);
+	if(*value == '\0' || *end != '\0' || number > UINT32_MAX) {
+		fprintf(stderr, "Error: invalid value '%s' for option %s\n", value, option);
+		return -1;
+	}
+
+	*out = (U32)number;
+	return 0;
+}
+
+/**
+ * @brief Takes the string argument of an option.
+ *
+ * @param option The name of the option (for the error message).
+ * @param value The argument string.
+ * @param out Where the argument is stored.
+ * @return `0` on success, `-1` if the argument is missing.
+ */
+static I8 parse_string(const char *option, const char *value, const char **out) {
+	if(value == NULL) {
+		fprintf(stderr, "Error: option %s needs a value\n", option);
+		return -1;
+	}
+
+	*out = value;
+	return 0;
+}
+
+/**
+ * @brief Fills the options with their defaults and applies the command line on top.
+ *
+ * @param options Pointer to the Options structure to fill.
+ * @param argc Argument count from `main`.
+ * @param argv Argument vector from `main`.
+ * @return `0` to start the game, `1` if only the usage was requested, `-1` on invalid arguments.
+ */
+I8 parse_options(Options *options, int argc, char **argv) {
+	const char *mode;
+
+	options->dasMs = DEFAULT_DAS_MS;
+	options->arrMs = DEFAULT_ARR_MS;
+	options->threaded = false;
+	options->scoresPath = NULL;
+	options->snapshotPath = NULL;
+	options->seed = 0;
+	options->rngMode = RNG_COUNTER;
+	options->servePath = NULL;
+	options->viewPath = NULL;
+	options->shmName = NULL;
+	options->gridBoards = 0;
+	options->frameRate = TICK_RATE;
+	options->scale = 1;
+	options->metricsPath = NULL;
+	options->xStats = false;
+	options->traceStartup = false;
+
+	for(int i=1;i<argc;i++) {
+		if(strcmp(argv[i], "--das") == 0) {
+			if(parse_number(argv[i], argv[i+1], &options->dasMs) != 0) return -1;
+			i++;
+
+		} else if(strcmp(argv[i], "--arr") == 0) {
+			if(parse_number(argv[i], argv[i+1], &options->arrMs) != 0) return -1;
+			i++;
+
+		} else if(strcmp(argv[i], "--scores") == 0) {
+			if(parse_string(argv[i], argv[i+1], &options->scoresPath) != 0) return -1;
+			i++;
+
+		} else if(strcmp(argv[i], "--snapshot") == 0) {
+			if(parse_string(argv[i], argv[i+1], &options->snapshotPath) != 0) return -1;
+			i++;
+
+		} else if(strcmp(argv[i], "--seed") == 0) {
+			if(parse_number(argv[i], argv[i+1], &options->seed) != 0) return -1;
+			i++;
+
+		} else if(strcmp(argv[i], "--rng") == 0) {
+			if(parse_string(argv[i], argv[i+1], &mode) != 0) return -1;
+			if(strcmp(mode, "counter") == 0) {
+				options->rngMode = RNG_COUNTER;
+			} else if(strcmp(mode, "bbs") == 0) {
+				options->rngMode = RNG_BBS;
+			} else {
+				fprintf(stderr, "Error: invalid value '%s' for option %s\n", mode, argv[i]);
+				return -1;
+			}
+			i++;
+
+		} else if(strcmp(argv[i], "--serve") == 0) {
+			if(parse_string(argv[i], argv[i+1], &options->servePath) != 0) return -1;
+			i++;
+
+		} else if(strcmp(argv[i], "--shm") == 0) {
+			if(parse_string(argv[i], argv[i+1], &options->shmName) != 0) return -1;
+			i++;
+
+		} else if(strcmp(argv[i], "--grid") == 0) {
+			if(parse_number(argv[i], argv[i+1], &options->gridBoards) != 0) return -1;
+			if(options->gridBoards == 0 || options->gridBoards > GRID_MAX_BOARDS) {
+				fprintf(stderr, "Error: invalid value '%s' for option %s\n", argv[i+1], argv[i]);
+				return -1;
+			}
+			i++;
+
+		} else if(strcmp(argv[i], "--fps") == 0) {
+			if(parse_number(argv[i], argv[i+1], &options->frameRate) != 0) return -1;
+			i++;
+
+		} else if(strcmp(argv[i], "--scale") == 0) {
+			if(parse_number(argv[i], argv[i+1], &options->scale) != 0) return -1;
+			if(options->scale == 0 || options->scale > VIEW_SCALE_MAX) {
+				fprintf(stderr, "Error: invalid value '%s' for option %s\n", argv[i+1], argv[i]);
+				return -1;
+			}
+			i++;
+
+		} else if(strcmp(argv[i], "--view") == 0) {
+			if(parse_string(argv[i], argv[i+1], &options->viewPath) != 0) return -1;
+			i++;
+
+		} else if(strcmp(argv[i], "--metrics") == 0) {
+			if(parse_string(argv[i], argv[i+1], &options->metricsPath) != 0) return -1;
+			i++;
+
+		} else if(strcmp(argv[i], "--threaded") == 0) {
+			options->threaded = true;
+
+		} else if(strcmp(argv[i], "--xstats") == 0) {
+			options->xStats = true;
+
+		} else if(strcmp(argv[i], "--trace-startup") == 0) {
+			options->traceStartup = true;
+
+		} else if(strcmp(argv[i], "--help") == 0 || strcmp(argv[i], "-h") == 0) {
+			print_usage(argv[0]);
+			return 1;
+
+		} else {
+			fprintf(stderr, "Error: unknown option %s\n", argv[i]);
+			print_usage(argv[0]);
+			return -1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,350 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include "pipeline.h"
+
+/**
+ * @brief Shared state of the X I/O, simulation and render threads.
+ */
+typedef struct {
+	XWindow *xw;
+	Game *game;
+	RenderBackend *rb;
+	ScreenCache *screens;
+	ShmInterface *shm;		///< Bots reading the game and sending inputs (`NULL`: none)
+	InputQueue queue;		///< X I/O thread -> simulation (SPSC)
+	TripleBuffer frames;	///< simulation -> render thread
+	long frameNs;			///< Time between two drawn frames (0: unlimited)
+	bool running;			///< Cleared (atomically) by the X I/O thread when the user wants to exit
+	pthread_mutex_t handoff;	///< Guards `ioWaiting`
+	pthread_cond_t ioLocked;	///< Signalled when the X I/O thread got the display lock
+	bool ioWaiting;			///< The X I/O thread waits for the display lock, the render thread lets it go first
+} Pipeline;
+
+/**
+ * @brief Initializes the triple buffer, all three frames start as a copy of `initial`.
+ *
+ * @param buffer Pointer to the TripleBuffer to initialize.
+ * @param initial The frame the reader sees before anything was published.
+ */
+void init_triple_buffer(TripleBuffer *buffer, const Frame *initial) {
+	for(U8 i=0;i<3;i++) {
+		buffer->frames[i] = *initial;
+	}
+
+	buffer->front = 0;
+	buffer->middle = 1;
+	buffer->back = 2;
+}
+
+/**
+ * @brief Returns the frame the writer may fill next.
+ *
+ * @param buffer Pointer to the TripleBuffer.
+ * @return The back frame, owned by the writer until `publish_frame`.
+ */
+Frame *back_frame(TripleBuffer *buffer) {
+	return &buffer->frames[buffer->back];
+}
+
+/**
+ * @brief Publishes the back frame and takes over the previous middle frame as new back frame.
+ *
+ * @param buffer Pointer to the TripleBuffer.
+ */
+void publish_frame(TripleBuffer *buffer) {
+	U32 previous = __atomic_exchange_n(&buffer->middle, buffer->back | FRAME_FRESH, __ATOMIC_ACQ_REL);
+	buffer->back = previous & ~FRAME_FRESH;
+}
+
+/**
+ * @brief Returns the most recently published frame.
+ *
+ * @param buffer Pointer to the TripleBuffer.
+ * @param fresh Set to `true` if the frame was published since the last call.
+ * @return The front frame, valid until the next call.
+ */
+const Frame *latest_frame(TripleBuffer *buffer, bool *fresh) {
+	U32 previous;
+
+	*fresh = (__atomic_load_n(&buffer->middle, __ATOMIC_ACQUIRE) & FRAME_FRESH) != 0;
+	if(*fresh) {
+		previous = __atomic_exchange_n(&buffer->middle, buffer->front, __ATOMIC_ACQ_REL);
+		buffer->front = previous & ~FRAME_FRESH;
+	}
+
+	return &buffer->frames[buffer->front];
+}
+
+/**
+ * @brief Sleeps until the next tick of a fixed rate loop.
+ *
+ * The deadline is absolute, so the rate does not drift with the time spent in the loop.
+ * If the loop runs behind by more than `MAX_CATCH_UP_TICKS` the deadline skips ahead
+ * instead of running all missed ticks at once.
+ *
+ * @param deadline The deadline of the current tick, advanced to the next one.
+ * @param periodNs The length of one tick (in ns).
+ */
+void wait_next_tick(struct timespec *deadline, long periodNs) {
+	struct timespec now;
+
+	deadline->tv_nsec += periodNs;
+	while(deadline->tv_nsec >= 1000000000L) {
+		deadline->tv_nsec -= 1000000000L;
+		deadline->tv_sec++;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if((now.tv_sec - deadline->tv_sec) * 1000000000L + (now.tv_nsec - deadline->tv_nsec) > MAX_CATCH_UP_TICKS * periodNs) {
+		*deadline = now;
+		return;
+	}
+
+	clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, NULL);
+}
+
+/**
+ * @brief Converts a point in time into ns.
+ */
+static inline I64 timespec_ns(const struct timespec *time) {
+	return (I64)time->tv_sec * 1000000000L + time->tv_nsec;
+}
+
+/**
+ * @brief Places the falling Tetromino between its positions in two consecutive snapshots.
+ *
+ * Drawn faster than the simulation ticks, the Tetromino would fall in steps of one tick. Instead
+ * the frame shows `to` with the Tetromino at the height it passes `elapsed` ns after `from`'s
+ * position, which is reached one tick after `to` was taken (the motion lags one tick behind the
+ * simulation). Only the straight fall is interpolated: every height between two free positions of
+ * the same column and rotation is free as well. Shifts, rotations, locks and board changes show
+ * at once, `to` is copied unchanged.
+ *
+ * @param from The snapshot of the tick before `to`.
+ * @param to The latest snapshot.
+ * @param elapsed Time since `to` was due (in ns), a whole tick or more shows `to` as it is.
+ * @param out Receives the frame to draw.
+ */
+void interpolate_frame(const Frame *from, const Frame *to, I64 elapsed, Frame *out) {
+	I32 y0, y1, y;
+
+	*out = *to;
+	if(to->state != STATE_GAME || !from->hasPiece || !to->hasPiece || from->state != STATE_GAME || to->tick != from->tick + 1
+		|| from->boardVersion != to->boardVersion || from->lastLock.count != to->lastLock.count
+		|| from->piece.col != to->piece.col || from->piece.rotationState != to->piece.rotationState) {
+		return;
+	}
+
+	y0 = from->piece.row * BLOCKSIZE + from->piece.fraction;
+	y1 = to->piece.row * BLOCKSIZE + to->piece.fraction;
+	if(y0 < 0 || y1 <= y0 || elapsed >= TICK_NS) {
+		return;
+	}
+
+	y = y0 + (I32)((y1 - y0) * ((elapsed > 0) ? elapsed : 0) / TICK_NS);
+	out->piece.row = y / BLOCKSIZE;
+	out->piece.fraction = y % BLOCKSIZE;
+}
+
+/**
+ * @brief Takes the display lock for the X I/O thread, ahead of the render thread.
+ *
+ * `XLockDisplay` is not fair: drawing without a pause (`--fps 0`) the render thread would take
+ * the lock again right after releasing it and the events would never be read.
+ *
+ * @param pipeline The pipeline.
+ */
+static void lock_display_io(Pipeline *pipeline) {
+	pthread_mutex_lock(&pipeline->handoff);
+	pipeline->ioWaiting = true;
+	pthread_mutex_unlock(&pipeline->handoff);
+
+	XLockDisplay(pipeline->xw->display);
+
+	pthread_mutex_lock(&pipeline->handoff);
+	pipeline->ioWaiting = false;
+	pthread_cond_signal(&pipeline->ioLocked);
+	pthread_mutex_unlock(&pipeline->handoff);
+}
+
+/**
+ * @brief Takes the display lock for the render thread, after a waiting X I/O thread had it.
+ *
+ * @param pipeline The pipeline.
+ */
+static void lock_display_render(Pipeline *pipeline) {
+	pthread_mutex_lock(&pipeline->handoff);
+	while(pipeline->ioWaiting) {
+		pthread_cond_wait(&pipeline->ioLocked, &pipeline->handoff);
+	}
+	pthread_mutex_unlock(&pipeline->handoff);
+
+	XLockDisplay(pipeline->xw->display);
+}
+
+/**
+ * @brief X I/O thread: reads the X events into the input queue as soon as they arrive.
+ *
+ * The inputs of bots (`--shm`) are moved into the queue here as well, the queue has a single
+ * producer. The shared memory can not wake up the thread, it then polls every millisecond.
+ *
+ * @param arg Pointer to the Pipeline.
+ * @return Always `NULL`.
+ */
+static void *io_thread(void *arg) {
+	Pipeline *pipeline = arg;
+	Display *display = pipeline->xw->display;
+	struct pollfd pfd = {ConnectionNumber(display), POLLIN, 0};
+	U32 mousePos[2];
+	bool exit;
+
+	while(__atomic_load_n(&pipeline->running, __ATOMIC_ACQUIRE)) {
+		(void)poll(&pfd, 1, (pipeline->shm != NULL) ? 1 : 10); // wake up regularly to notice the other threads stopping
+
+		lock_display_io(pipeline);
+		exit = recv_events(display, &pipeline->queue, mousePos);
+		XUnlockDisplay(display);
+		if(pipeline->shm != NULL) {
+			(void)pump_shm_inputs(pipeline->shm, &pipeline->queue);
+		}
+
+		if(exit) {
+			__atomic_store_n(&pipeline->running, false, __ATOMIC_RELEASE);
+		}
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Render thread: draws the latest frame snapshot at the frame rate.
+ *
+ * Drawing faster than the simulation ticks, the falling Tetromino is interpolated between the
+ * two latest snapshots (see `interpolate_frame`). Holds the display lock while drawing, which
+ * also protects `needsRedraw` and the expose region against the X I/O thread.
+ *
+ * @param arg Pointer to the Pipeline.
+ * @return Always `NULL`.
+ */
+static void *render_thread(void *arg) {
+	Pipeline *pipeline = arg;
+	Display *display = pipeline->xw->display;
+	const Frame *frame;
+	Frame drawn, latest, before, shown;
+	Animations animations;
+	struct timespec deadline;
+	bool fresh, firstFrame, interpolate = (pipeline->frameNs < TICK_NS);
+
+	latest = *latest_frame(&pipeline->frames, &fresh);
+	before = drawn = latest;
+	init_animations(&animations, &drawn);
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+
+	while(__atomic_load_n(&pipeline->running, __ATOMIC_ACQUIRE)) {
+		frame = latest_frame(&pipeline->frames, &fresh);
+		if(fresh) {
+			before = latest;
+			latest = *frame;
+		}
+		if(interpolate) {
+			interpolate_frame(&before, &latest, now_ns() - latest.time, &shown);
+		} else {
+			shown = latest;
+		}
+
+		lock_display_render(pipeline);
+		if(fresh || needsRedraw || !XEmptyRegion(exposeRegion) || animations.count > 0 || shown.piece.row != drawn.piece.row || shown.piece.fraction != drawn.piece.fraction) {
+			firstFrame = needsRedraw && pipeline->game->metrics.startup[STARTUP_FIRST_FRAME] == 0; // the first expose of the window
+			render_frame(pipeline->rb, pipeline->screens, &animations, &drawn, &shown);
+			drawn = shown;
+			end_x_frame(&xAccounting);
+			pipeline->rb->flush(pipeline->rb->ctx);
+			count_frame(&pipeline->game->metrics, timespec_ns(&deadline), (pipeline->frameNs > 0) ? pipeline->frameNs : TICK_NS);
+			if(firstFrame) {
+				mark_startup(&pipeline->game->metrics, STARTUP_FIRST_FRAME);
+			}
+		}
+		XUnlockDisplay(display);
+
+		wait_next_tick(&deadline, pipeline->frameNs);
+	}
+
+	return NULL;
+}
+
+/**
+ * @brief Runs the game with X I/O, simulation and rendering on separate threads.
+ *
+ * The X I/O thread feeds the lock-free input queue, the simulation runs on the calling
+ * thread at a fixed tick and publishes frame snapshots through a triple buffer, which the
+ * render thread draws at its own rate. A slow X server therefore only delays the drawing, never
+ * the simulation. `XInitThreads` has to be called before the display was opened.
+ *
+ * @param xw Pointer to the XWindow structure containing display and window info.
+ * @param rb The render backend drawing into the window.
+ * @param game Pointer to the initialized Game.
+ * @param screens Pointer to the ScreenCache with the static screens.
+ * @param stream Spectator stream the frames are published to (`NULL`: none).
+ * @param shm Shared memory the game is published to and bots send inputs through (`NULL`: none).
+ * @param frameRate Frames drawn per second (0: unlimited).
+ * @return `0` when the user exits, `-1` if the threads could not be started.
+ */
+I8 run_threaded(XWindow *xw, RenderBackend *rb, Game *game, ScreenCache *screens, StreamServer *stream, ShmInterface *shm, U32 frameRate) {
+	Pipeline pipeline;
+	pthread_t ioThread, renderThread;
+	struct timespec deadline;
+	Frame initial;
+
+	memset(&pipeline, 0, sizeof(pipeline));
+	pipeline.xw = xw;
+	pipeline.game = game;
+	pipeline.rb = rb;
+	pipeline.screens = screens;
+	pipeline.shm = shm;
+	pipeline.frameNs = (frameRate > 0) ? 1000000000L / frameRate : 0;
+	pipeline.running = true;
+	pthread_mutex_init(&pipeline.handoff, NULL);
+	pthread_cond_init(&pipeline.ioLocked, NULL);
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	snapshot_game(game, &initial);
+	initial.time = timespec_ns(&deadline);
+	init_triple_buffer(&pipeline.frames, &initial);
+
+	if(pthread_create(&ioThread, NULL, io_thread, &pipeline) != 0) {
+		fprintf(stderr, "Error: could not start the X I/O thread\n");
+		return -1;
+	}
+
+	if(pthread_create(&renderThread, NULL, render_thread, &pipeline) != 0) {
+		fprintf(stderr, "Error: could not start the render thread\n");
+		__atomic_store_n(&pipeline.running, false, __ATOMIC_RELEASE);
+		pthread_join(ioThread, NULL);
+		pthread_cond_destroy(&pipeline.ioLocked);
+		pthread_mutex_destroy(&pipeline.handoff);
+		return -1;
+	}
+
+	// Simulation on a fixed tick
+	while(__atomic_load_n(&pipeline.running, __ATOMIC_ACQUIRE)) {
+		step_game(game, &pipeline.queue);
+		snapshot_game(game, back_frame(&pipeline.frames));
+		back_frame(&pipeline.frames)->time = timespec_ns(&deadline);
+		if(stream != NULL) {
+			stream_frame(stream, back_frame(&pipeline.frames));
+		}
+		if(shm != NULL) {
+			publish_shm_state(shm, game);
+		}
+		publish_frame(&pipeline.frames);
+
+		wait_next_tick(&deadline, TICK_NS);
+	}
+
+	pthread_join(ioThread, NULL);
+	pthread_join(renderThread, NULL);
+	pthread_cond_destroy(&pipeline.ioLocked);
+	pthread_mutex_destroy(&pipeline.handoff);
+	return 0;
+}
@@ -0,0 +1,482 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include "render.h"
+
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+
+/**
+ * @brief Fixed metrics of the headless fonts, roughly those of the real ones.
+ *
+ * Text is not rasterized, every character is drawn as a block ("greeked") so the layout
+ * of the screens can still be verified without any font files.
+ */
+typedef struct {
+	U16 advance;	///< Horizontal distance of two characters
+	U16 ascent;
+	U16 descent;
+	U16 glyphHeight;	///< Height of the block drawn for a character (above the baseline)
+} HeadlessFont;
+
+static const HeadlessFont headlessFonts[FONT_COUNT] = {
+	[FONT_TEXT] = {7, 12, 3, 9},
+	[FONT_HEADLINE] = {36, 58, 14, 45},
+};
+
+/**
+ * @brief Metrics of a headless font at the current view scale, like the real fonts they grow with it.
+ *
+ * @param font The font.
+ * @return The scaled metrics.
+ */
+static HeadlessFont headless_font(FontId font) {
+	const HeadlessFont *base = &headlessFonts[font];
+	return (HeadlessFont){base->advance * viewScale, base->ascent * viewScale, base->descent * viewScale, base->glyphHeight * viewScale};
+}
+
+#if REVERSED_STREAM
+#define HEADLESS_GLOW_COLOR 0x606060
+#else
+#define HEADLESS_GLOW_COLOR 0x9f9f9f
+#endif
+
+/**
+ * @brief Fills a rectangle of a surface, clipped to the surface and the clip region.
+ *
+ * @param headless The backend state.
+ * @param target The surface.
+ * @param color The color.
+ * @param x The x-coordinate of the rectangle.
+ * @param y The y-coordinate of the rectangle.
+ * @param width The width of the rectangle.
+ * @param height The height of the rectangle.
+ */
+static void headless_fill(HeadlessBackend *headless, Surface target, U32 color, I32 x, I32 y, I32 width, I32 height) {
+	U32 *pixels = headless->pixels[target];
+	I32 x0 = (x < 0) ? 0 : x;
+	I32 y0 = (y < 0) ? 0 : y;
+	I32 x1 = (x + width > headless->width[target]) ? headless->width[target] : x + width;
+	I32 y1 = (y + height > headless->height[target]) ? headless->height[target] : y + height;
+	int inside = RectangleIn;
+
+	if(pixels == NULL || x0 >= x1 || y0 >= y1) {
+		return;
+	}
+
+	if(headless->clip != NULL) {
+		inside = XRectInRegion(headless->clip, x0, y0, x1 - x0, y1 - y0);
+		if(inside == RectangleOut) {
+			return;
+		}
+	}
+
+	for(I32 row=y0;row<y1;row++) {
+		U32 *line = pixels + (size_t)row * headless->width[target];
+
+		for(I32 col=x0;col<x1;col++) {
+			// only partly covered rectangles need the expensive test per pixel
+			if(inside == RectangleIn || XPointInRegion(headless->clip, col, row)) {
+				line[col] = color;
+				headless->pixelsWritten++;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Creates an in-memory surface in the first free slot.
+ * @see RenderBackend
+ */
+static Surface headless_create_surface(void *ctx, U16 width, U16 height) {
+	HeadlessBackend *headless = ctx;
+
+	for(Surface i=1;i<HEADLESS_MAX_SURFACES;i++) {
+		if(headless->pixels[i] == NULL) {
+			headless->pixels[i] = calloc((size_t)width * height, sizeof(U32));
+			if(headless->pixels[i] == NULL) {
+				break;
+			}
+			headless->width[i] = width;
+			headless->height[i] = height;
+			return i;
+		}
+	}
+
+	// drawing then goes straight to the window surface, just without caching
+	fprintf(stderr, "Error: no headless surface available\n");
+	return SURFACE_WINDOW;
+}
+
+/**
+ * @brief Frees a surface created by `headless_create_surface`.
+ * @see RenderBackend
+ */
+static void headless_free_surface(void *ctx, Surface surface) {
+	HeadlessBackend *headless = ctx;
+
+	if(surface != SURFACE_WINDOW && surface < HEADLESS_MAX_SURFACES) {
+		free(headless->pixels[surface]);
+		headless->pixels[surface] = NULL;
+	}
+}
+
+/**
+ * @brief Fills an area with the background color.
+ * @see RenderBackend
+ */
+static void headless_clear(void *ctx, Surface target, I16 x, I16 y, U16 width, U16 height) {
+	HeadlessBackend *headless = ctx;
+	Region clip = headless->clip;
+
+	headless->clip = NULL; // like XClearArea, clearing ignores the clip region
+	headless_fill(headless, target, COLOR_BACKGROUND, x, y, width, height);
+	headless->clip = clip;
+}
+
+/**
+ * @brief Fills rectangles with one color.
+ * @see RenderBackend
+ */
+static void headless_fill_rects(void *ctx, Surface target, U32 color, const XRectangle *rects, U16 count) {
+	HeadlessBackend *headless = ctx;
+
+	for(U16 i=0;i<count;i++) {
+		headless_fill(headless, target, color, rects[i].x, rects[i].y, rects[i].width, rects[i].height);
+	}
+}
+
+/**
+ * @brief Copies an area between surfaces, clipped to the clip region.
+ * @see RenderBackend
+ */
+static void headless_blit(void *ctx, Surface source, I16 sourceX, I16 sourceY, U16 w, U16 h, Surface target, I16 x, I16 y) {
+	HeadlessBackend *headless = ctx;
+	const U32 *from = headless->pixels[source];
+	U32 *to = headless->pixels[target];
+	I32 width = w;
+	I32 height = h;
+
+	if(from == NULL || to == NULL) {
+		return;
+	}
+
+	// clamp to both surfaces
+	if(sourceX < 0) {
+		x -= sourceX;
+		width += sourceX;
+		sourceX = 0;
+	}
+	if(sourceY < 0) {
+		y -= sourceY;
+		height += sourceY;
+		sourceY = 0;
+	}
+	if(x < 0) {
+		sourceX -= x;
+		width += x;
+		x = 0;
+	}
+	if(y < 0) {
+		sourceY -= y;
+		height += y;
+		y = 0;
+	}
+	width = MIN(MIN(width, headless->width[source] - sourceX), headless->width[target] - x);
+	height = MIN(MIN(height, headless->height[source] - sourceY), headless->height[target] - y);
+	if(width <= 0 || height <= 0) {
+		return;
+	}
+
+	for(I32 row=0;row<height;row++) {
+		const U32 *line = from + (size_t)(sourceY + row) * headless->width[source] + sourceX;
+		U32 *out = to + (size_t)(y + row) * headless->width[target] + x;
+
+		if(headless->clip == NULL) {
+			memmove(out, line, (size_t)width * sizeof(U32));
+			headless->pixelsWritten += width;
+			continue;
+		}
+		for(I32 col=0;col<width;col++) {
+			if(XPointInRegion(headless->clip, x + col, y + row)) {
+				out[col] = line[col];
+				headless->pixelsWritten++;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Fills rectangles with a tile repeated from the origin, clipped to the clip region.
+ *
+ * Like a `FillTiled` GC: the pixel at (x, y) is taken from the tile at
+ * ((x - originX) mod width, (y - originY) mod height).
+ * @see RenderBackend
+ */
+static void headless_fill_tiled(void *ctx, Surface target, Surface source, const XRectangle *area, I16 originX, I16 originY, const XRectangle *rects, U16 count) {
+	HeadlessBackend *headless = ctx;
+	const U32 *from = headless->pixels[source];
+	U32 *to = headless->pixels[target];
+	I32 tileX, tileY;
+	int inside;
+
+	if(from == NULL || to == NULL || area->width == 0 || area->height == 0
+			|| area->x < 0 || area->y < 0 || area->x + area->width > headless->width[source] || area->y + area->height > headless->height[source]) {
+		return;
+	}
+
+	for(U16 i=0;i<count;i++) {
+		I32 x0 = (rects[i].x < 0) ? 0 : rects[i].x;
+		I32 y0 = (rects[i].y < 0) ? 0 : rects[i].y;
+		I32 x1 = MIN(rects[i].x + rects[i].width, headless->width[target]);
+		I32 y1 = MIN(rects[i].y + rects[i].height, headless->height[target]);
+
+		if(x0 >= x1 || y0 >= y1) {
+			continue;
+		}
+		inside = (headless->clip == NULL) ? RectangleIn : XRectInRegion(headless->clip, x0, y0, x1 - x0, y1 - y0);
+		if(inside == RectangleOut) {
+			continue;
+		}
+
+		for(I32 row=y0;row<y1;row++) {
+			U32 *out = to + (size_t)row * headless->width[target];
+
+			tileY = ((row - originY) % area->height + area->height) % area->height;
+			tileX = ((x0 - originX) % area->width + area->width) % area->width;
+			const U32 *line = from + (size_t)(area->y + tileY) * headless->width[source] + area->x;
+			for(I32 col=x0;col<x1;col++) {
+				if(inside == RectangleIn || XPointInRegion(headless->clip, col, row)) {
+					out[col] = line[tileX];
+					headless->pixelsWritten++;
+				}
+				tileX = (tileX + 1 == area->width) ? 0 : tileX + 1;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Draws a string as one block per character, `y` is the top of the line.
+ * @see RenderBackend
+ */
+static void headless_text(void *ctx, Surface target, FontId font, I16 x, I16 y, const char *text, bool glow) {
+	HeadlessBackend *headless = ctx;
+	HeadlessFont scaled = headless_font(font);
+	const HeadlessFont *metrics = &scaled;
+	I32 top = y + metrics->ascent - metrics->glyphHeight;
+	size_t length = strlen(text);
+
+	for(U8 pass=glow?0:1;pass<2;pass++) {
+		for(size_t i=0;i<length;i++) {
+			I32 left = x + (I32)i * metrics->advance;
+
+			if(text[i] == ' ') {
+				continue;
+			}
+			if(pass == 0) {
+				headless_fill(headless, target, HEADLESS_GLOW_COLOR, left - 2, top - 2, metrics->advance + 3, metrics->glyphHeight + 4);
+			} else {
+				headless_fill(headless, target, COLOR_FOREGROUND, left, top, metrics->advance - 1, metrics->glyphHeight);
+			}
+		}
+	}
+}
+
+/**
+ * @brief Measures a string with the fixed headless metrics.
+ * @see RenderBackend
+ */
+static void headless_text_extents(void *ctx, FontId font, const char *text, XGlyphInfo *extents) {
+	HeadlessFont scaled = headless_font(font);
+	const HeadlessFont *metrics = &scaled;
+	(void)ctx;
+
+	memset(extents, 0, sizeof(*extents));
+	extents->width = strlen(text) * metrics->advance;
+	extents->height = metrics->glyphHeight;
+	extents->y = metrics->glyphHeight;
+	extents->xOff = extents->width;
+}
+
+/**
+ * @brief Height of a line of text (ascent + descent).
+ * @see RenderBackend
+ */
+static U16 headless_line_height(void *ctx, FontId font) {
+	HeadlessFont metrics = headless_font(font);
+	(void)ctx;
+	return metrics.ascent + metrics.descent;
+}
+
+/**
+ * @brief Clips all drawing to a region (`NULL`: no clipping).
+ * @see RenderBackend
+ */
+static void headless_set_clip(void *ctx, Region clip) {
+	HeadlessBackend *headless = ctx;
+	headless->clip = clip;
+}
+
+/**
+ * @brief Nothing to flush, everything is drawn immediately.
+ * @see RenderBackend
+ */
+static void headless_flush(void *ctx) {
+	(void)ctx;
+}
+
+/**
+ * @brief Creates the in-memory render backend.
+ *
+ * Surface 0 (`SURFACE_WINDOW`) stands in for the window and starts with the background color.
+ *
+ * @param backend The backend to initialize.
+ * @param headless Storage for the backend state, has to outlive the backend.
+ * @param width The width of the window surface.
+ * @param height The height of the window surface.
+ * @return 0 on success, -1 if the memory could not be allocated.
+ */
+I8 init_headless_backend(RenderBackend *backend, HeadlessBackend *headless, U16 width, U16 height) {
+	memset(headless, 0, sizeof(*headless));
+
+	headless->pixels[SURFACE_WINDOW] = malloc((size_t)width * height * sizeof(U32));
+	if(headless->pixels[SURFACE_WINDOW] == NULL) {
+		fprintf(stderr, "Error: could not allocate the headless framebuffer\n");
+		return -1;
+	}
+	headless->width[SURFACE_WINDOW] = width;
+	headless->height[SURFACE_WINDOW] = height;
+	headless_fill(headless, SURFACE_WINDOW, COLOR_BACKGROUND, 0, 0, width, height);
+	headless->pixelsWritten = 0;
+
+	backend->ctx = headless;
+	backend->create_surface = headless_create_surface;
+	backend->free_surface = headless_free_surface;
+	backend->clear = headless_clear;
+	backend->fill_rects = headless_fill_rects;
+	backend->blit = headless_blit;
+	backend->fill_tiled = headless_fill_tiled;
+	backend->text = headless_text;
+	backend->text_extents = headless_text_extents;
+	backend->line_height = headless_line_height;
+	backend->set_clip = headless_set_clip;
+	backend->flush = headless_flush;
+	return 0;
+}
+
+/**
+ * @brief Frees all surfaces of the in-memory backend.
+ *
+ * @param headless The backend state.
+ */
+void free_headless_backend(HeadlessBackend *headless) {
+	for(U8 i=0;i<HEADLESS_MAX_SURFACES;i++) {
+		free(headless->pixels[i]);
+		headless->pixels[i] = NULL;
+	}
+}
+
+/**
+ * @brief FNV-1a hash over the pixels of a surface, compact reference for regression checks.
+ *
+ * @param headless The backend state.
+ * @param surface The surface.
+ * @return The hash (0 for an unused surface).
+ */
+U32 checksum_surface(const HeadlessBackend *headless, Surface surface) {
+	const U32 *pixels = headless->pixels[surface];
+	size_t count = (size_t)headless->width[surface] * headless->height[surface];
+	U32 hash = FNV1A_BASIS;
+	U8 channels[3];
+
+	if(pixels == NULL) {
+		return 0;
+	}
+
+	for(size_t i=0;i<count;i++) {
+		// hash the channels, the result does not depend on the byte order
+		channels[0] = (pixels[i] >> 16) & 0xff;
+		channels[1] = (pixels[i] >> 8) & 0xff;
+		channels[2] = pixels[i] & 0xff;
+		hash = fnv1a_update(hash, channels, sizeof(channels));
+	}
+	return hash;
+}
+
+/**
+ * @brief Writes a surface as binary PPM (P6) image.
+ *
+ * @param headless The backend state.
+ * @param surface The surface.
+ * @param path The file to write.
+ * @return 0 on success, -1 on error.
+ */
+I8 write_ppm(const HeadlessBackend *headless, Surface surface, const char *path) {
+	const U32 *pixels = headless->pixels[surface];
+	size_t count = (size_t)headless->width[surface] * headless->height[surface];
+	FILE *file;
+	U8 rgb[3];
+
+	if(pixels == NULL) {
+		return -1;
+	}
+
+	if((file = fopen(path, "wb")) == NULL) {
+		fprintf(stderr, "Error: could not write %s\n", path);
+		return -1;
+	}
+
+	fprintf(file, "P6\n%u %u\n255\n", headless->width[surface], headless->height[surface]);
+	for(size_t i=0;i<count;i++) {
+		rgb[0] = pixels[i] >> 16;
+		rgb[1] = pixels[i] >> 8;
+		rgb[2] = pixels[i];
+		fwrite(rgb, sizeof(rgb), 1, file);
+	}
+
+	if(fclose(file) != 0) {
+		fprintf(stderr, "Error: could not write %s\n", path);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Compares a surface with a PPM image written by `write_ppm` (pixel diff).
+ *
+ * @param headless The backend state.
+ * @param surface The surface.
+ * @param path The reference image.
+ * @return Number of differing pixels, -1 if the reference is missing or has another size.
+ */
+I64 compare_ppm(const HeadlessBackend *headless, Surface surface, const char *path) {
+	const U32 *pixels = headless->pixels[surface];
+	size_t count = (size_t)headless->width[surface] * headless->height[surface];
+	unsigned width, height, maxValue;
+	I64 differences = 0;
+	FILE *file;
+	U8 rgb[3];
+
+	if(pixels == NULL || (file = fopen(path, "rb")) == NULL) {
+		return -1;
+	}
+
+	if(fscanf(file, "P6 %u %u %u", &width, &height, &maxValue) != 3 || fgetc(file) == EOF
+		|| width != headless->width[surface] || height != headless->height[surface] || maxValue != 255) {
+		fclose(file);
+		return -1;
+	}
+
+	for(size_t i=0;i<count;i++) {
+		if(fread(rgb, sizeof(rgb), 1, file) != 1) {
+			fclose(file);
+			return -1;
+		}
+		if((((U32)rgb[0] << 16) | ((U32)rgb[1] << 8) | rgb[2]) != (pixels[i] & 0xffffff)) {
+			differences++;
+		}
+	}
+
+	fclose(file);
+	return differences;
+}
@@ -0,0 +1,313 @@
+/// \file
+
+#include "render.h"
+
+/**
+ * @brief Maps a surface to the X drawable behind it.
+ *
+ * @param x11 The backend state.
+ * @param surface The surface (`SURFACE_WINDOW` or a pixmap).
+ * @return The drawable.
+ */
+static Drawable x11_drawable(const X11Backend *x11, Surface surface) {
+	return (surface == SURFACE_WINDOW) ? x11->xw->window : (Drawable)surface;
+}
+
+/**
+ * @brief Sets the foreground of the GC, skipping the request if it is already set.
+ *
+ * @param x11 The backend state.
+ * @param color The color (0xRRGGBB, used as pixel value on the TrueColor visual).
+ */
+static void x11_foreground(X11Backend *x11, U32 color) {
+	if(x11->foreground != color) {
+		XSetForeground(x11->xw->display, x11->xw->gc, color);
+		x11->foreground = color;
+	}
+}
+
+/**
+ * @brief Frees a cached tile and marks its slot unused.
+ *
+ * @param x11 The backend state.
+ * @param tile The tile.
+ */
+static void x11_drop_tile(X11Backend *x11, X11Tile *tile) {
+	if(tile->source != SURFACE_WINDOW) {
+		XFreeGC(x11->xw->display, tile->gc);
+		XFreePixmap(x11->xw->display, tile->pixmap);
+		tile->source = SURFACE_WINDOW;
+	}
+}
+
+/**
+ * @brief Finds the tile for an area of a surface, copying it into a new pixmap on first use.
+ *
+ * The copy uses the GC of the tile, which is not clipped yet, so a clip on the window does not
+ * cut the tile. When the cache is full the slots are replaced in turn.
+ *
+ * @param x11 The backend state.
+ * @param source The surface the tile is taken from.
+ * @param area The area of `source`.
+ * @return The tile.
+ */
+static X11Tile *x11_tile(X11Backend *x11, Surface source, const XRectangle *area) {
+	Display *display = x11->xw->display;
+	X11Tile *tile;
+
+	for(U8 i=0;i<X11_TILE_CACHE;i++) {
+		tile = &x11->tiles[i];
+		if(tile->source == source && tile->area.x == area->x && tile->area.y == area->y && tile->area.width == area->width && tile->area.height == area->height) {
+			return tile;
+		}
+	}
+
+	tile = &x11->tiles[x11->nextTile];
+	x11->nextTile = (x11->nextTile + 1) % X11_TILE_CACHE;
+	x11_drop_tile(x11, tile);
+
+	tile->pixmap = XCreatePixmap(display, x11->xw->window, area->width, area->height, DefaultDepth(display, x11->xw->screenNumber));
+	tile->gc = XCreateGC(display, tile->pixmap, 0, NULL);
+	XSetGraphicsExposures(display, tile->gc, False);
+	XCopyArea(display, x11_drawable(x11, source), tile->pixmap, tile->gc, area->x, area->y, area->width, area->height, 0, 0);
+	XSetTile(display, tile->gc, tile->pixmap);
+	XSetFillStyle(display, tile->gc, FillTiled);
+	tile->source = source;
+	tile->area = *area;
+	tile->originX = tile->originY = 0;
+	tile->clipVersion = x11->clipVersion - 1; // apply the current clip on first use
+	return tile;
+}
+
+/**
+ * @brief Creates a pixmap with the depth of the window.
+ * @see RenderBackend
+ */
+static Surface x11_create_surface(void *ctx, U16 width, U16 height) {
+	X11Backend *x11 = ctx;
+	return XCreatePixmap(x11->xw->display, x11->xw->window, width, height, DefaultDepth(x11->xw->display, x11->xw->screenNumber));
+}
+
+/**
+ * @brief Frees a pixmap created by `x11_create_surface`.
+ * @see RenderBackend
+ */
+static void x11_free_surface(void *ctx, Surface surface) {
+	X11Backend *x11 = ctx;
+
+	if(x11->drawTarget == surface) {
+		// never leave the XftDraw pointing to a freed pixmap
+		XftDrawChange(x11->draw, x11->xw->window);
+		x11->drawTarget = x11->xw->window;
+	}
+	for(U8 i=0;i<X11_TILE_CACHE;i++) {
+		if(x11->tiles[i].source == surface) {
+			x11_drop_tile(x11, &x11->tiles[i]);
+		}
+	}
+	XFreePixmap(x11->xw->display, surface);
+}
+
+/**
+ * @brief Fills an area with the background color.
+ * @see RenderBackend
+ */
+static void x11_clear(void *ctx, Surface target, I16 x, I16 y, U16 width, U16 height) {
+	X11Backend *x11 = ctx;
+
+	if(target == SURFACE_WINDOW) {
+		// the server fills with the window background, no GC changes needed
+		XClearArea(x11->xw->display, x11->xw->window, x, y, width, height, false);
+		return;
+	}
+
+	// pixmaps have no background
+	x11_foreground(x11, COLOR_BACKGROUND);
+	XFillRectangle(x11->xw->display, target, x11->xw->gc, x, y, width, height);
+}
+
+/**
+ * @brief Fills rectangles with one `XFillRectangles` request.
+ * @see RenderBackend
+ */
+static void x11_fill_rects(void *ctx, Surface target, U32 color, const XRectangle *rects, U16 count) {
+	X11Backend *x11 = ctx;
+
+	x11_foreground(x11, color);
+	XFillRectangles(x11->xw->display, x11_drawable(x11, target), x11->xw->gc, (XRectangle *)rects, count);
+}
+
+/**
+ * @brief Copies an area between the window and pixmaps.
+ * @see RenderBackend
+ */
+static void x11_blit(void *ctx, Surface source, I16 sourceX, I16 sourceY, U16 width, U16 height, Surface target, I16 x, I16 y) {
+	X11Backend *x11 = ctx;
+	XCopyArea(x11->xw->display, x11_drawable(x11, source), x11_drawable(x11, target), x11->xw->gc, sourceX, sourceY, width, height, x, y);
+}
+
+/**
+ * @brief Fills rectangles with a tile in one `XFillRectangles` request, through a `FillTiled` GC per tile.
+ * @see RenderBackend
+ */
+static void x11_fill_tiled(void *ctx, Surface target, Surface source, const XRectangle *area, I16 originX, I16 originY, const XRectangle *rects, U16 count) {
+	X11Backend *x11 = ctx;
+	Display *display = x11->xw->display;
+	X11Tile *tile = x11_tile(x11, source, area);
+
+	if(tile->clipVersion != x11->clipVersion) {
+		if(x11->clip != NULL) {
+			XSetRegion(display, tile->gc, x11->clip);
+		} else {
+			XSetClipMask(display, tile->gc, None);
+		}
+		tile->clipVersion = x11->clipVersion;
+	}
+	if(tile->originX != originX || tile->originY != originY) {
+		XSetTSOrigin(display, tile->gc, originX, originY);
+		tile->originX = originX;
+		tile->originY = originY;
+	}
+	XFillRectangles(display, x11_drawable(x11, target), tile->gc, (XRectangle *)rects, count);
+}
+
+/**
+ * @brief Draws a string with Xft, `y` is the top of the line.
+ * @see RenderBackend
+ */
+static void x11_text(void *ctx, Surface target, FontId fontId, I16 x, I16 y, const char *text, bool glow) {
+	X11Backend *x11 = ctx;
+	XftFont *font = x11->fonts[fontId];
+	Drawable drawable = x11_drawable(x11, target);
+	I8 offsets[] = {-2, -1, 1, 2};
+	U8 numOffsets = sizeof(offsets) / sizeof(offsets[0]);
+
+	if(x11->drawTarget != drawable) {
+		XftDrawChange(x11->draw, drawable);
+		x11->drawTarget = drawable;
+	}
+
+	if(glow) {
+		for(I8 ox = 0; ox < numOffsets; ++ox) {
+			for(I8 oy = 0; oy < numOffsets; ++oy) {
+				XftDrawString8(x11->draw, &x11->glowColor, font, x + offsets[ox], y + font->ascent + offsets[oy], (FcChar8 *)text, strlen(text));
+			}
+		}
+	}
+
+	XftDrawStringUtf8(x11->draw, &x11->textColor, font, x, y + font->ascent, (FcChar8 *)text, strlen(text));
+}
+
+/**
+ * @brief Measures a string.
+ * @see RenderBackend
+ */
+static void x11_text_extents(void *ctx, FontId font, const char *text, XGlyphInfo *extents) {
+	X11Backend *x11 = ctx;
+	XftTextExtentsUtf8(x11->xw->display, x11->fonts[font], (FcChar8 *)text, strlen(text), extents);
+}
+
+/**
+ * @brief Height of a line of text (ascent + descent).
+ * @see RenderBackend
+ */
+static U16 x11_line_height(void *ctx, FontId font) {
+	X11Backend *x11 = ctx;
+	return x11->fonts[font]->ascent + x11->fonts[font]->descent;
+}
+
+/**
+ * @brief Clips the GC and the XftDraw to a region (`NULL`: no clipping).
+ * @see RenderBackend
+ */
+static void x11_set_clip(void *ctx, Region clip) {
+	X11Backend *x11 = ctx;
+
+	if(clip != NULL) {
+		XSetRegion(x11->xw->display, x11->xw->gc, clip);
+		XftDrawSetClip(x11->draw, clip);
+	} else {
+		XSetClipMask(x11->xw->display, x11->xw->gc, None);
+		XftDrawSetClip(x11->draw, NULL);
+	}
+	x11->clip = clip;
+	x11->clipVersion++;
+}
+
+/**
+ * @brief Sends the buffered requests to the X server.
+ * @see RenderBackend
+ */
+static void x11_flush(void *ctx) {
+	X11Backend *x11 = ctx;
+	XFlush(x11->xw->display);
+}
+
+/**
+ * @brief Creates the render backend drawing with Xlib and Xft into the game window.
+ *
+ * The GC has to be initialized with `init_graphics` first. The text colors and the XftDraw are
+ * allocated once here instead of for every string.
+ *
+ * @param backend The backend to initialize.
+ * @param x11 Storage for the backend state, has to outlive the backend.
+ * @param xw Pointer to the XWindow structure containing display and window info.
+ * @param fontText Font for normal display text.
+ * @param fontHeadlines Font for the headlines.
+ */
+void init_x11_backend(RenderBackend *backend, X11Backend *x11, XWindow *xw, XftFont *fontText, XftFont *fontHeadlines) {
+	Visual *visual = DefaultVisual(xw->display, xw->screenNumber);
+	Colormap colormap = DefaultColormap(xw->display, xw->screenNumber);
+#if REVERSED_STREAM
+	XRenderColor renderColor = {0xffff, 0xffff, 0xffff, 0xf000};
+	XRenderColor glowColor = {0xffff, 0xffff, 0xffff, 0x6000};
+#else
+	XRenderColor renderColor = {0x0000, 0x0000, 0x0000, 0xf000};
+	XRenderColor glowColor = {0x0000, 0x0000, 0x0000, 0x6000};
+#endif
+
+	x11->xw = xw;
+	x11->fonts[FONT_TEXT] = fontText;
+	x11->fonts[FONT_HEADLINE] = fontHeadlines;
+	x11->draw = XftDrawCreate(xw->display, xw->window, visual, colormap);
+	x11->drawTarget = xw->window;
+	x11->foreground = COLOR_FOREGROUND; // set by init_graphics
+	x11->clip = NULL;
+	x11->clipVersion = 0;
+	for(U8 i=0;i<X11_TILE_CACHE;i++) {
+		x11->tiles[i].source = SURFACE_WINDOW;
+	}
+	x11->nextTile = 0;
+	XftColorAllocValue(xw->display, visual, colormap, &renderColor, &x11->textColor);
+	XftColorAllocValue(xw->display, visual, colormap, &glowColor, &x11->glowColor);
+
+	backend->ctx = x11;
+	backend->create_surface = x11_create_surface;
+	backend->free_surface = x11_free_surface;
+	backend->clear = x11_clear;
+	backend->fill_rects = x11_fill_rects;
+	backend->blit = x11_blit;
+	backend->fill_tiled = x11_fill_tiled;
+	backend->text = x11_text;
+	backend->text_extents = x11_text_extents;
+	backend->line_height = x11_line_height;
+	backend->set_clip = x11_set_clip;
+	backend->flush = x11_flush;
+}
+
+/**
+ * @brief Frees the resources of the Xlib/Xft backend (the fonts stay open).
+ *
+ * @param x11 The backend state.
+ */
+void free_x11_backend(X11Backend *x11) {
+	Visual *visual = DefaultVisual(x11->xw->display, x11->xw->screenNumber);
+	Colormap colormap = DefaultColormap(x11->xw->display, x11->xw->screenNumber);
+
+	for(U8 i=0;i<X11_TILE_CACHE;i++) {
+		x11_drop_tile(x11, &x11->tiles[i]);
+	}
+	XftColorFree(x11->xw->display, visual, colormap, &x11->textColor);
+	XftColorFree(x11->xw->display, visual, colormap, &x11->glowColor);
+	XftDrawDestroy(x11->draw);
+}
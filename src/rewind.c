@@ -0,0 +1,105 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include "rewind.h"
+
+/**
+ * @brief Remembers a placement before its full rows are removed.
+ *
+ * Called with the Tetromino already on the board and its lock noted in `lastLock`, the next one
+ * not drawn yet. The entry is a fixed 56 bytes, recording it is a handful of stores.
+ *
+ * @param game Pointer to the Game.
+ */
+void record_placement(Game *game) {
+	RewindRing *ring = &game->rewind;
+	RewindEntry *entry = &ring->entries[ring->head];
+
+	// a placement that ended the game can not be rewound, the Tetromino may have spawned into the stack
+	if(game->lastLock.gameOver) {
+		return;
+	}
+
+	entry->score = game->board.score;
+	entry->level = game->board.level;
+	entry->rngCounter = game->rng.counter;
+	entry->rngState = game->rng.state;
+	entry->lock = game->lastLock;
+
+	ring->head = (ring->head + 1) % REWIND_LENGTH;
+	if(ring->count < REWIND_LENGTH) {
+		ring->count++;
+	}
+	game->metrics.rewindEntries = ring->count;
+}
+
+/**
+ * @brief Takes back the last placement.
+ *
+ * The removed rows are put back and the blocks of the Tetromino taken off the board, the
+ * Tetromino falls again from the top. The falling one goes back to the front of the queue and
+ * the random generator is rewound, so the same pieces come again.
+ *
+ * @param game Pointer to the Game.
+ * @return `0` on success, `-1` if there is nothing to take back.
+ */
+I8 rewind_placement(Game *game) {
+	RewindRing *ring = &game->rewind;
+	const RewindEntry *entry;
+	Tetromino *piece;
+	U16 shape;
+	I8 x, y;
+
+	if(ring->count == 0) {
+		return -1;
+	}
+	if((piece = get_tetromino(ring->entries[(ring->head + REWIND_LENGTH - 1) % REWIND_LENGTH].lock.type)) == NULL) {
+		return -1;
+	}
+	ring->head = (ring->head + REWIND_LENGTH - 1) % REWIND_LENGTH;
+	ring->count--;
+	entry = &ring->entries[ring->head];
+
+	// put the removed rows back, the last removed first
+	for(I8 k=entry->lock.rowsCleared-1;k>=0;k--) {
+		for(U8 j=0;j<entry->lock.clearedRows[k];j++) {
+			for(U8 i=0;i<BOARD_WIDTH;i++) {
+				game->board.state[i][j] = game->board.state[i][j + 1];
+			}
+			game->board.colors[j] = game->board.colors[j + 1];
+		}
+		for(U8 i=0;i<BOARD_WIDTH;i++) {
+			game->board.state[i][entry->lock.clearedRows[k]] = 1;
+		}
+		game->board.colors[entry->lock.clearedRows[k]] = entry->lock.clearedColors[k];
+	}
+
+	shape = tetrominos[entry->lock.type % TETROMINO_TYPES].rotations[entry->lock.rotationState % 4];
+	for(I8 i=0;i<4;i++) {
+		for(I8 j=0;j<4;j++) {
+			x = entry->lock.col + j;
+			y = entry->lock.row + i;
+			if((shape & (1 << (i * 4 + j))) != 0 && x >= 0 && x < BOARD_WIDTH && y >= 0 && y < BOARD_HEIGHT) {
+				game->board.state[x][y] = 0;
+				game->board.colors[y] &= ~(CELL_COLOR_MASK << (x * CELL_COLOR_BITS));
+			}
+		}
+	}
+	game->board.score = entry->score;
+	game->board.level = entry->level;
+
+	// the falling Tetromino was drawn after the placement
+	if(game->current != NULL) {
+		memmove(game->next + 1, game->next, PIECE_QUEUE_LENGTH - 1);
+		game->next[0] = game->current->type;
+		free_tetromino(&game->current);
+	}
+	game->rng.counter = entry->rngCounter;
+	game->rng.state = entry->rngState;
+	game->current = piece;
+	game->boardVersion++;
+
+	game->metrics.rewinds++;
+	game->metrics.rewindEntries = ring->count;
+	return 0;
+}
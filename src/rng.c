@@ -0,0 +1,99 @@
+/// \file
+
+#include "rng.h"
+
+/**
+ * @brief SplitMix64 finalizer, a bijective 64 bit mixing function.
+ *
+ * @param z The value to mix.
+ * @return The mixed value.
+ */
+static U64 mix64(U64 z) {
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+/**
+ * @brief Initializes a random generator.
+ *
+ * @param rng The generator.
+ * @param mode `RNG_COUNTER` or the sequential `RNG_BBS`.
+ * @param seed The seed, `0` for a random one (RDRAND or the time).
+ */
+void init_rng(Rng *rng, RngMode mode, U64 seed) {
+	memset(rng, 0, sizeof(*rng));
+	rng->mode = mode;
+	rng->seed = (seed != 0) ? seed : get_seed();
+	rng->key = mix64(rng->seed);
+	rng->state = (U32)rng->seed;
+	if(rng->state == 0) {
+		rng->state = (U32)rng->key | 1; // 0 is a fixed point of BBS
+	}
+}
+
+/**
+ * @brief Returns the next 32 random bits.
+ *
+ * In counter mode the n-th value is a pure function of the key and n, so any position
+ * of the stream can be computed directly.
+ *
+ * @param rng The generator.
+ * @return The random value.
+ */
+U32 rng_next(Rng *rng) {
+	if(rng->mode == RNG_BBS) {
+		return random_U32(&rng->state);
+	}
+
+	rng->counter++;
+	return (U32)(mix64(rng->key + rng->counter * RNG_GAMMA) >> 32);
+}
+
+/**
+ * @brief Returns a random value below a bound.
+ *
+ * @param rng The generator.
+ * @param bound Number of possible values (`> 0`).
+ * @return The value in `[0, bound)`.
+ */
+U32 rng_below(Rng *rng, U32 bound) {
+	return (U32)(((U64)rng_next(rng) * bound) >> 32); // multiply-shift, no division
+}
+
+/**
+ * @brief Skips values of the stream.
+ *
+ * Constant time in counter mode, BBS has to step through them.
+ *
+ * @param rng The generator.
+ * @param steps Number of values to skip.
+ */
+void rng_jump(Rng *rng, U64 steps) {
+	if(rng->mode == RNG_BBS) {
+		for(U64 i=0;i<steps;i++) {
+			(void)random_U32(&rng->state);
+		}
+		return;
+	}
+	rng->counter += steps;
+}
+
+/**
+ * @brief Derives an independent stream, e.g. one per thread or per simulated game.
+ *
+ * The stream only depends on the seed of the generator and the id, never on how many values
+ * were taken from it, so parallel simulations are reproducible without sharing a generator.
+ *
+ * @param rng The generator the stream is derived from.
+ * @param id Number of the stream.
+ * @param stream Receives the new generator (same mode, positioned at its start).
+ */
+void rng_stream(const Rng *rng, U64 id, Rng *stream) {
+	memset(stream, 0, sizeof(*stream));
+	stream->mode = rng->mode;
+	stream->seed = rng->seed;
+	stream->id = id;
+	stream->key = mix64(mix64(rng->seed) ^ mix64(id * RNG_GAMMA + 1));
+	stream->state = (U32)stream->key | 1;
+}
@@ -0,0 +1,152 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include "score.h"
+
+/**
+ * @brief Computes the checksum of a record (everything in front of the checksum field).
+ *
+ * @param record The record.
+ * @return The checksum the record has to carry.
+ */
+static U32 record_checksum(const ScoreRecord *record) {
+	return fnv1a(record, offsetof(ScoreRecord, checksum));
+}
+
+/**
+ * @brief Maps the leaderboard file into memory.
+ *
+ * The file has a fixed layout, so there is nothing to parse: the header is checked and the
+ * records are used in place, startup cost does not depend on the number of stored games.
+ * A missing or invalid file starts an empty leaderboard, records with a wrong checksum
+ * (e.g. torn by a crash) are ignored.
+ *
+ * @param leaderboard Pointer to the Leaderboard to initialize.
+ * @param path Location of the file, `NULL` for `$HOME/.cubes_scores`.
+ */
+void load_scores(Leaderboard *leaderboard, const char *path) {
+	const LeaderboardFile *file;
+	const char *home;
+	struct stat info;
+	int fd;
+
+	memset(leaderboard, 0, sizeof(*leaderboard));
+	leaderboard->image.magic = LEADERBOARD_MAGIC;
+	leaderboard->image.version = LEADERBOARD_VERSION;
+	leaderboard->image.capacity = LEADERBOARD_SIZE;
+	leaderboard->view = &leaderboard->image;
+
+	if(path != NULL) {
+		snprintf(leaderboard->path, sizeof(leaderboard->path), "%s", path);
+	} else if((home = getenv("HOME")) != NULL) {
+		snprintf(leaderboard->path, sizeof(leaderboard->path), "%s/%s", home, SCORES_FILE_NAME);
+	} else {
+		return; // nowhere to keep the scores
+	}
+
+	if((fd = open(leaderboard->path, O_RDONLY)) < 0) {
+		return; // first run
+	}
+
+	if(fstat(fd, &info) != 0 || info.st_size != sizeof(LeaderboardFile)) {
+		fprintf(stderr, "Warning: ignoring invalid leaderboard %s\n", leaderboard->path);
+		close(fd);
+		return;
+	}
+
+	leaderboard->mapping = mmap(NULL, sizeof(LeaderboardFile), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if(leaderboard->mapping == MAP_FAILED) {
+		leaderboard->mapping = NULL;
+		return;
+	}
+
+	file = leaderboard->mapping;
+	if(file->magic != LEADERBOARD_MAGIC || file->version != LEADERBOARD_VERSION || file->capacity != LEADERBOARD_SIZE || file->count > LEADERBOARD_SIZE) {
+		fprintf(stderr, "Warning: ignoring invalid leaderboard %s\n", leaderboard->path);
+		munmap(leaderboard->mapping, sizeof(LeaderboardFile));
+		leaderboard->mapping = NULL;
+		return;
+	}
+
+	leaderboard->view = file;
+}
+
+/**
+ * @brief Returns the best valid score of the leaderboard.
+ *
+ * @param leaderboard Pointer to the Leaderboard.
+ * @return The highscore, `0` if no game was recorded yet.
+ */
+U64 best_score(const Leaderboard *leaderboard) {
+	const LeaderboardFile *file = leaderboard->view;
+
+	for(U32 i=0;i<file->count;i++) {
+		if(file->records[i].checksum == record_checksum(&file->records[i])) {
+			return file->records[i].score;
+		}
+	}
+	return 0;
+}
+
+/**
+ * @brief Records a finished game and persists the leaderboard in the background.
+ *
+ * The new leaderboard is built in memory (invalid records are dropped on the way) and handed
+ * to the writer thread, which replaces the file atomically. The caller never waits for the disk.
+ *
+ * @param leaderboard Pointer to the Leaderboard.
+ * @param score Final score of the game.
+ * @param level Level reached.
+ * @return The rank of the game (0 = best), `-1` if it did not make it into the leaderboard.
+ */
+I8 save_score(Leaderboard *leaderboard, U64 score, U32 level) {
+	const LeaderboardFile *old = leaderboard->view;
+	LeaderboardFile updated = {0};
+	ScoreRecord record = {score, (I64)time(NULL), level, 0};
+	I8 rank = -1;
+
+	record.checksum = record_checksum(&record);
+
+	updated.magic = LEADERBOARD_MAGIC;
+	updated.version = LEADERBOARD_VERSION;
+	updated.capacity = LEADERBOARD_SIZE;
+	updated.generation = old->generation + 1;
+
+	// merge the new record into the sorted list
+	for(U32 i=0;i<=old->count && updated.count<LEADERBOARD_SIZE;i++) {
+		if(rank < 0 && (i == old->count || score > old->records[i].score)) {
+			rank = (I8)updated.count;
+			updated.records[updated.count++] = record;
+		}
+
+		if(i < old->count && updated.count < LEADERBOARD_SIZE && old->records[i].checksum == record_checksum(&old->records[i])) {
+			updated.records[updated.count++] = old->records[i];
+		}
+	}
+
+	if(rank < 0) {
+		return -1;
+	}
+
+	leaderboard->image = updated;
+	leaderboard->view = &leaderboard->image;
+
+	if(leaderboard->path[0] != '\0') {
+		submit_write(WRITE_SLOT_SCORES, leaderboard->path, &leaderboard->image, sizeof(LeaderboardFile), true);
+	}
+	return rank;
+}
+
+/**
+ * @brief Unmaps the leaderboard file.
+ *
+ * @param leaderboard Pointer to the Leaderboard.
+ */
+void free_scores(Leaderboard *leaderboard) {
+	if(leaderboard->mapping != NULL) {
+		munmap(leaderboard->mapping, sizeof(LeaderboardFile));
+		leaderboard->mapping = NULL;
+	}
+	leaderboard->view = &leaderboard->image;
+}
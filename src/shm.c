@@ -0,0 +1,253 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include "shm.h"
+
+/**
+ * @brief Checks whether an existing shared memory object was left over by a crashed game.
+ *
+ * Only such an object (or an empty one, from a crash before it was resized) may be taken over.
+ * An object of a running game or of another program is left alone.
+ *
+ * @param fd The opened object.
+ * @param name Name of the object (for the error messages).
+ * @return `0` if the object can be reused, `-1` otherwise.
+ */
+static I8 check_stale_shm(int fd, const char *name) {
+	struct stat info;
+	const ShmRegion *region;
+	U32 magic, pid;
+
+	if(fstat(fd, &info) != 0) {
+		fprintf(stderr, "Error: could not inspect the shared memory %s: %s\n", name, strerror(errno));
+		return -1;
+	}
+	if(info.st_size == 0) {
+		return 0;
+	}
+	if((size_t)info.st_size < sizeof(ShmRegion)
+			|| (region = mmap(NULL, sizeof(ShmRegion), PROT_READ, MAP_SHARED, fd, 0)) == MAP_FAILED) {
+		fprintf(stderr, "Error: the shared memory %s exists and does not belong to a game\n", name);
+		return -1;
+	}
+	magic = __atomic_load_n(&region->magic, __ATOMIC_ACQUIRE);
+	pid = region->pid;
+	munmap((void *)region, sizeof(ShmRegion));
+
+	if(magic != SHM_MAGIC) {
+		fprintf(stderr, "Error: the shared memory %s exists and does not belong to a game\n", name);
+		return -1;
+	}
+	if(pid != 0 && (kill((pid_t)pid, 0) == 0 || errno == EPERM)) {
+		fprintf(stderr, "Error: the shared memory %s is used by the running game %u\n", name, pid);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Creates the shared memory object and maps it.
+ *
+ * The object is created exclusively. An existing one is only reused (and its content reset) if
+ * it was left over by a crashed game, see `check_stale_shm`. On errors the object is only
+ * removed if it was created here.
+ *
+ * @param shm The interface to initialize.
+ * @param name Name of the object, starts with a `/` (e.g. `/cubes`, found in /dev/shm).
+ * @return `0` on success, `-1` on error.
+ */
+I8 init_shm_interface(ShmInterface *shm, const char *name) {
+	struct stat info;
+	bool created = true;
+	int fd;
+	void *mapped;
+
+	memset(shm, 0, sizeof(*shm));
+	if(name[0] != '/' || strchr(name + 1, '/') != NULL || strlen(name) >= sizeof(shm->name)) {
+		fprintf(stderr, "Error: invalid shared memory name %s, use /<name>\n", name);
+		return -1;
+	}
+
+	if((fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600)) < 0 && errno == EEXIST) {
+		created = false;
+		fd = shm_open(name, O_RDWR, 0600);
+	}
+	if(fd < 0) {
+		fprintf(stderr, "Error: could not create the shared memory %s: %s\n", name, strerror(errno));
+		return -1;
+	}
+	if(!created && check_stale_shm(fd, name) != 0) {
+		close(fd);
+		return -1;
+	}
+	if(ftruncate(fd, sizeof(ShmRegion)) != 0 || fstat(fd, &info) != 0) {
+		fprintf(stderr, "Error: could not resize the shared memory %s: %s\n", name, strerror(errno));
+		close(fd);
+		if(created) {
+			shm_unlink(name);
+		}
+		return -1;
+	}
+	mapped = mmap(NULL, sizeof(ShmRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd); // the mapping keeps the object
+	if(mapped == MAP_FAILED) {
+		fprintf(stderr, "Error: could not map the shared memory %s: %s\n", name, strerror(errno));
+		if(created) {
+			shm_unlink(name);
+		}
+		return -1;
+	}
+
+	shm->region = mapped;
+	strcpy(shm->name, name);
+	shm->device = info.st_dev;
+	shm->inode = info.st_ino;
+	memset(shm->region, 0, sizeof(ShmRegion));
+	shm->region->version = SHM_VERSION;
+	shm->region->size = sizeof(ShmRegion);
+	shm->region->pid = (U32)getpid();
+	__atomic_store_n(&shm->region->magic, SHM_MAGIC, __ATOMIC_RELEASE); // tools wait for it
+	return 0;
+}
+
+/**
+ * @brief Publishes the state of the game to the tools.
+ *
+ * Called once per tick by the simulation, it writes the state in place under the seqlock. A
+ * reader never blocks the game, it retries instead.
+ *
+ * @param shm The interface (does nothing while it is off).
+ * @param game The game.
+ */
+void publish_shm_state(ShmInterface *shm, const Game *game) {
+	ShmState *state;
+	U32 sequence;
+
+	if(shm->region == NULL) {
+		return;
+	}
+	state = &shm->region->state;
+	sequence = shm->region->sequence;
+	__atomic_store_n(&shm->region->sequence, sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE); // the odd sequence is visible before any field
+
+	state->tick = game->tick;
+	state->score = game->board.score;
+	state->highscore = game->board.highscore;
+	state->level = game->board.level;
+	state->boardVersion = game->boardVersion;
+	memcpy(state->colors, game->board.colors, sizeof(state->colors));
+	for(U8 y=0;y<BOARD_HEIGHT;y++) {
+		for(U8 x=0;x<BOARD_WIDTH;x++) {
+			state->cells[y][x] = game->board.state[x][y];
+		}
+	}
+	memcpy(state->next, game->next, sizeof(state->next));
+	state->state = (U8)game->state;
+	state->hasPiece = (game->current != NULL);
+	if(game->current != NULL) {
+		state->type = game->current->type;
+		state->rotationState = game->current->rotationState;
+		state->col = game->current->col;
+		state->row = game->current->row;
+		state->fraction = game->current->fraction;
+	}
+
+	__atomic_store_n(&shm->region->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Moves the actions the tools wrote into the input queue.
+ *
+ * Has to run on the thread that feeds the queue with the X events (the queue has a single
+ * producer). Actions that do not fit into the queue stay in the ring for the next call.
+ *
+ * @param shm The interface (does nothing while it is off).
+ * @param queue The input queue of the game.
+ * @return The number of actions moved.
+ */
+U32 pump_shm_inputs(ShmInterface *shm, InputQueue *queue) {
+	U32 head, tail, moved = 0;
+	ShmInput input;
+
+	if(shm->region == NULL) {
+		return 0;
+	}
+	head = shm->region->inputHead;
+	tail = __atomic_load_n(&shm->region->inputTail, __ATOMIC_ACQUIRE);
+	for(;head!=tail;head++) {
+		input = shm->region->inputs[head & (SHM_INPUT_SIZE - 1)];
+		if(input.action >= KEY_COUNT) {
+			continue; // not an action of this version
+		}
+		if(queue->tail - __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) == INPUT_QUEUE_SIZE) {
+			break; // the queue is full, taken again next time
+		}
+		(void)push_input(queue, &(InputEvent){(KeyAction)input.action, input.pressed != 0, 0});
+		moved++;
+	}
+	__atomic_store_n(&shm->region->inputHead, head, __ATOMIC_RELEASE);
+	return moved;
+}
+
+/**
+ * @brief Unmaps and removes the shared memory object.
+ *
+ * The name is only removed while it still refers to the object of this game, not to one
+ * another game created after it was removed by hand.
+ *
+ * @param shm The interface (does nothing while it is off).
+ */
+void free_shm_interface(ShmInterface *shm) {
+	struct stat info;
+	int fd;
+
+	if(shm->region == NULL) {
+		return;
+	}
+	munmap(shm->region, sizeof(ShmRegion));
+	if((fd = shm_open(shm->name, O_RDONLY, 0)) >= 0) {
+		if(fstat(fd, &info) == 0 && (U64)info.st_dev == shm->device && (U64)info.st_ino == shm->inode) {
+			shm_unlink(shm->name);
+		}
+		close(fd);
+	}
+	shm->region = NULL;
+}
+
+/**
+ * @brief Takes a consistent copy of the published state, for tools written in C.
+ *
+ * @param region The mapped shared memory.
+ * @param state Receives the state.
+ */
+void read_shm_state(const ShmRegion *region, ShmState *state) {
+	U32 before, after;
+
+	do {
+		before = __atomic_load_n(&region->sequence, __ATOMIC_ACQUIRE);
+		memcpy(state, (const void *)&region->state, sizeof(*state));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE); // the copy is done before the sequence is checked
+		after = __atomic_load_n(&region->sequence, __ATOMIC_RELAXED);
+	} while((before & 1) || before != after);
+}
+
+/**
+ * @brief Writes a key press or release into the input ring, for tools written in C.
+ *
+ * @param region The mapped shared memory.
+ * @param action The action.
+ * @param pressed `true` for a press, `false` for a release.
+ * @return `true` on success, `false` if the ring is full (the action is dropped).
+ */
+bool send_shm_input(ShmRegion *region, KeyAction action, bool pressed) {
+	U32 tail = region->inputTail;
+
+	if(tail - __atomic_load_n(&region->inputHead, __ATOMIC_ACQUIRE) == SHM_INPUT_SIZE) {
+		region->inputDropped++;
+		return false;
+	}
+	region->inputs[tail & (SHM_INPUT_SIZE - 1)] = (ShmInput){(U8)action, pressed};
+	__atomic_store_n(&region->inputTail, tail + 1, __ATOMIC_RELEASE);
+	return true;
+}
@@ -0,0 +1,162 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include "snapshot.h"
+
+/**
+ * @brief Saves the game in the background.
+ *
+ * The snapshot is about 100 bytes, it is copied to the writer thread which replaces the file
+ * atomically and syncs it, the simulation never waits for the disk. A game that is not
+ * running (start screen, game over) is saved as well, so it will not be resumed.
+ *
+ * @param game Pointer to the Game to save.
+ */
+void save_game(const Game *game) {
+	SnapshotFile file;
+	U16 cell;
+
+	if(game->snapshotPath[0] == '\0') {
+		return;
+	}
+
+	memset(&file, 0, sizeof(file)); // no uninitialized padding in the file
+	file.magic = SNAPSHOT_MAGIC;
+	file.version = SNAPSHOT_VERSION;
+	file.state = game->state;
+	file.score = game->board.score;
+	file.level = game->board.level;
+	memcpy(file.colors, game->board.colors, sizeof(file.colors));
+	file.rngMode = game->rng.mode;
+	file.rngSeed = game->rng.seed;
+	file.rngId = game->rng.id;
+	file.rngKey = game->rng.key;
+	file.rngCounter = game->rng.counter;
+	file.rngState = game->rng.state;
+	memcpy(file.next, game->next, sizeof(file.next));
+
+	for(U8 x=0;x<BOARD_WIDTH;x++) {
+		for(U8 y=0;y<BOARD_HEIGHT;y++) {
+			cell = x * BOARD_HEIGHT + y;
+			if(game->board.state[x][y] != 0) {
+				file.board[cell / 8] |= 1 << (cell % 8);
+			}
+		}
+	}
+
+	if(game->current != NULL) {
+		file.hasPiece = 1;
+		file.type = game->current->type;
+		file.rotationState = game->current->rotationState;
+		file.col = game->current->col;
+		file.row = game->current->row;
+		file.fraction = game->current->fraction;
+	}
+
+	file.checksum = fnv1a(&file, offsetof(SnapshotFile, checksum));
+	submit_write(WRITE_SLOT_SNAPSHOT, game->snapshotPath, &file, sizeof(file), true);
+}
+
+/**
+ * @brief Checks that a snapshot describes a game that can be continued.
+ *
+ * @param file The snapshot read from disk.
+ * @return `true` if it is intact and was saved during a running game.
+ */
+static bool valid_snapshot(const SnapshotFile *file) {
+	if(file->magic != SNAPSHOT_MAGIC || file->version != SNAPSHOT_VERSION
+			|| file->checksum != fnv1a(file, offsetof(SnapshotFile, checksum))) {
+		return false;
+	}
+	if(file->state != STATE_GAME && file->state != STATE_PAUSE) {
+		return false; // saved after the game ended
+	}
+	if(file->rngMode != RNG_COUNTER && file->rngMode != RNG_BBS) {
+		return false;
+	}
+	for(U8 i=0;i<PIECE_QUEUE_LENGTH;i++) {
+		if(file->next[i] >= TETROMINO_TYPES) {
+			return false;
+		}
+	}
+	if(file->hasPiece) {
+		return file->type < TETROMINO_TYPES && file->rotationState < 4 && file->fraction < BLOCKSIZE
+			&& file->col > -4 && file->col < BOARD_WIDTH && file->row >= 0 && file->row < BOARD_HEIGHT;
+	}
+	return true;
+}
+
+/**
+ * @brief Sets up the snapshot file and continues the game saved in it.
+ *
+ * A resumed game starts paused, any key but pause is ignored until the player continues.
+ *
+ * @param game Pointer to the Game (after `init_session`).
+ * @param path Location of the file, `NULL` for `$HOME/.cubes_snapshot`.
+ * @return `0` if a game was resumed, `-1` if there was nothing (valid) to resume.
+ */
+I8 resume_game(Game *game, const char *path) {
+	SnapshotFile file;
+	const char *home;
+	Tetromino *piece;
+	U16 cell;
+	ssize_t length;
+	int fd;
+
+	if(path != NULL) {
+		snprintf(game->snapshotPath, sizeof(game->snapshotPath), "%s", path);
+	} else if((home = getenv("HOME")) != NULL) {
+		snprintf(game->snapshotPath, sizeof(game->snapshotPath), "%s/%s", home, SNAPSHOT_FILE_NAME);
+	} else {
+		return -1; // nowhere to keep the game
+	}
+
+	if((fd = open(game->snapshotPath, O_RDONLY)) < 0) {
+		return -1; // nothing saved
+	}
+	length = read(fd, &file, sizeof(file));
+	close(fd);
+
+	if(length != sizeof(file) || !valid_snapshot(&file)) {
+		return -1;
+	}
+
+	piece = NULL;
+	if(file.hasPiece) {
+		if((piece = get_tetromino(file.type)) == NULL) {
+			return -1;
+		}
+		piece->rotationState = file.rotationState;
+		piece->col = file.col;
+		piece->row = file.row;
+		piece->fraction = file.fraction;
+	}
+
+	for(U8 x=0;x<BOARD_WIDTH;x++) {
+		for(U8 y=0;y<BOARD_HEIGHT;y++) {
+			cell = x * BOARD_HEIGHT + y;
+			game->board.state[x][y] = (file.board[cell / 8] >> (cell % 8)) & 1;
+		}
+	}
+	for(U8 y=0;y<BOARD_HEIGHT;y++) {
+		game->board.colors[y] = file.colors[y] & CELL_COLOR_ROW_MASK;
+	}
+	game->board.score = file.score;
+	game->board.level = file.level;
+	if(file.score > game->board.highscore) {
+		game->board.highscore = file.score;
+	}
+	memcpy(game->next, file.next, sizeof(game->next));
+	game->rng.mode = file.rngMode;
+	game->rng.seed = file.rngSeed;
+	game->rng.id = file.rngId;
+	game->rng.key = file.rngKey;
+	game->rng.counter = file.rngCounter;
+	game->rng.state = file.rngState;
+
+	free(game->current);
+	game->current = piece;
+	game->state = STATE_PAUSE;
+	game->boardVersion++;
+	return 0;
+}
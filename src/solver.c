@@ -0,0 +1,299 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include "solver.h"
+
+// Solver boards: bit `row * BOARD_WIDTH + col`, row 0 is the bottom row of the game board
+#define NODES_PER_CLOCK 1024				// searched states between two checks of the deadline
+
+/**
+ * @brief A distinct shape of a Tetromino, shifted to the bottom left corner.
+ */
+typedef struct {
+	U64 mask;		///< Cells in solver board bits
+	U8 width;
+	U8 height;
+	U8 rotation;	///< Rotation state of the Tetromino that has this shape
+	I8 colOffset;	///< Column of the leftmost cell inside the 4x4 shape
+	I8 rowOffset;	///< Row of the lowest cell inside the 4x4 shape
+} SolverShape;
+
+static SolverShape shapes[TETROMINO_TYPES][4];
+static U8 shapeCount[TETROMINO_TYPES];
+static U64 column0;	// column 0 of every row
+static U64 column9;	// last column of every row
+
+/**
+ * @brief Converts the rotation masks of the tetrominos into solver shapes.
+ *
+ * Rotations with the same shape (all of "O", two of "I", "S" and "Z") would only produce the
+ * same placements again, just one of them is kept.
+ */
+static void init_shapes(void) {
+	SolverShape shape;
+	U16 rotation;
+	bool duplicate;
+	I8 minCol, maxCol, minRow, maxRow;
+
+	column0 = 0;
+	for(U8 row=0;row<SOLVER_MAX_HEIGHT;row++) {
+		column0 |= 1ULL << (row * BOARD_WIDTH);
+	}
+	column9 = column0 << (BOARD_WIDTH - 1);
+
+	for(U8 type=0;type<TETROMINO_TYPES;type++) {
+		shapeCount[type] = 0;
+		for(U8 r=0;r<4;r++) {
+			rotation = tetrominos[type].rotations[r];
+			minCol = minRow = 3;
+			maxCol = maxRow = 0;
+			for(I8 i=0;i<4;i++) {
+				for(I8 j=0;j<4;j++) {
+					if(rotation & (1 << (i * 4 + j))) {
+						if(j < minCol) minCol = j;
+						if(j > maxCol) maxCol = j;
+						if(i < minRow) minRow = i;
+						if(i > maxRow) maxRow = i;
+					}
+				}
+			}
+
+			// row i of the 4x4 shape is above row i + 1, the solver counts rows upwards
+			shape.mask = 0;
+			for(I8 i=minRow;i<=maxRow;i++) {
+				for(I8 j=minCol;j<=maxCol;j++) {
+					if(rotation & (1 << (i * 4 + j))) {
+						shape.mask |= 1ULL << ((maxRow - i) * BOARD_WIDTH + (j - minCol));
+					}
+				}
+			}
+			shape.width = maxCol - minCol + 1;
+			shape.height = maxRow - minRow + 1;
+			shape.rotation = r;
+			shape.colOffset = minCol;
+			shape.rowOffset = maxRow;
+
+			duplicate = false;
+			for(U8 k=0;k<shapeCount[type];k++) {
+				duplicate |= (shapes[type][k].mask == shape.mask);
+			}
+			if(!duplicate) {
+				shapes[type][shapeCount[type]++] = shape;
+			}
+		}
+	}
+}
+
+/**
+ * @brief Checks that every enclosed empty area can still be filled with tetrominos.
+ *
+ * Pieces can not cross filled cells, so an empty region whose size is not a multiple
+ * of 4 below the height limit can never be filled completely.
+ *
+ * @param board The solver board.
+ * @param limit Rows that have to be filled.
+ * @return `false` if the board can not be cleared any more.
+ */
+static bool regions_fillable(U64 board, U8 limit) {
+	U64 empty = ~board & ((limit == 0) ? 0 : (~0ULL >> (64 - limit * BOARD_WIDTH)));
+	U64 region, previous;
+
+	while(empty != 0) {
+		region = empty & (~empty + 1); // lowest empty cell
+		do {
+			previous = region;
+			region |= ((region << 1) & ~column0) | ((region >> 1) & ~column9) | (region << BOARD_WIDTH) | (region >> BOARD_WIDTH);
+			region &= empty;
+		} while(region != previous);
+
+		if(__builtin_popcountll(region) % 4 != 0) {
+			return false;
+		}
+		empty &= ~region;
+	}
+	return true;
+}
+
+/**
+ * @brief Removes the full rows of a solver board.
+ *
+ * @param board The board, rows above a full row move down.
+ * @param limit The height limit, lowered by the number of removed rows.
+ * @return The board without full rows.
+ */
+static U64 clear_rows(U64 board, U8 *limit) {
+	U64 below;
+
+	for(U8 row=0;row<*limit;) {
+		if(((board >> (row * BOARD_WIDTH)) & SOLVER_ROW_MASK) != SOLVER_ROW_MASK) {
+			row++;
+			continue;
+		}
+		below = (row == 0) ? 0 : (board & (~0ULL >> (64 - row * BOARD_WIDTH)));
+		board = below | ((board >> ((row + 1) * BOARD_WIDTH)) << (row * BOARD_WIDTH));
+		(*limit)--;
+	}
+	return board;
+}
+
+/**
+ * @brief Depth first search for placements that clear the board.
+ *
+ * Tetrominos are hard dropped in every distinct rotation and column. States that failed are
+ * remembered in the memo table, the same board is often reached with different orders of moves.
+ *
+ * @param solver The solver.
+ * @param board The current board.
+ * @param depth Number of placed pieces.
+ * @param limit Rows that have to be filled (the height of the perfect clear minus cleared rows).
+ * @return `true` if the board can be cleared with the remaining pieces.
+ */
+static bool search(PcSolver *solver, U64 board, U8 depth, U8 limit) {
+	const SolverShape *shape;
+	SolverMemo *entry;
+	U64 key, placed, next;
+	U8 type, nextLimit;
+	I8 bottom;
+
+	if(depth == solver->pieceCount) {
+		return board == 0;
+	}
+
+	if(++solver->nodes % NODES_PER_CLOCK == 0 && now_ns() > solver->deadline) {
+		solver->timedOut = true;
+	}
+	if(solver->timedOut) {
+		return false;
+	}
+
+	key = board | ((U64)depth << 60);
+	entry = &solver->memo[(key * 0x9e3779b97f4a7c15ULL) >> 32 & solver->memoMask];
+	if(entry->generation == solver->generation && entry->key == key) {
+		return false;
+	}
+
+	type = solver->pieces[depth];
+	for(U8 s=0;s<shapeCount[type];s++) {
+		shape = &shapes[type][s];
+		if(shape->height > limit) {
+			continue;
+		}
+
+		for(U8 col=0;col+shape->width<=BOARD_WIDTH;col++) {
+			// drop from above the area (rows shifted out are empty anyway) until the piece lands
+			bottom = limit;
+			placed = shape->mask << col;
+			while(bottom > 0 && ((placed << ((bottom - 1) * BOARD_WIDTH)) & board) == 0) {
+				bottom--;
+			}
+			if(bottom + shape->height > limit) {
+				continue; // it would stick out of the area
+			}
+
+			nextLimit = limit;
+			next = clear_rows(board | (placed << (bottom * BOARD_WIDTH)), &nextLimit);
+			if(!regions_fillable(next, nextLimit)) {
+				continue;
+			}
+
+			solver->path[depth] = (Placement){type, shape->rotation, col - shape->colOffset, BOARD_HEIGHT - 1 - bottom - shape->rowOffset};
+			if(search(solver, next, depth + 1, nextLimit)) {
+				return true;
+			}
+		}
+	}
+
+	if(!solver->timedOut) {
+		entry->key = key;
+		entry->generation = solver->generation;
+	}
+	return false;
+}
+
+/**
+ * @brief Allocates the memo table of a solver.
+ *
+ * @param solver The solver to initialize.
+ * @param memoBits Size of the memo table (2^memoBits entries).
+ * @return `0` on success, `-1` if the table could not be allocated.
+ */
+I8 init_solver(PcSolver *solver, U8 memoBits) {
+	memset(solver, 0, sizeof(*solver));
+	if((solver->memo = calloc((size_t)1 << memoBits, sizeof(SolverMemo))) == NULL) {
+		fprintf(stderr, "Error: failed to allocate mem for the solver\n");
+		return -1;
+	}
+	solver->memoMask = (1U << memoBits) - 1;
+	init_shapes();
+	return 0;
+}
+
+/**
+ * @brief Searches placements of the given pieces that leave an empty board.
+ *
+ * The pieces are placed in order (there is no hold), each one hard dropped. Perfect clears
+ * of increasing height are tried, as far as the pieces suffice, the shortest solution is found first.
+ *
+ * @param solver The solver (see `init_solver`).
+ * @param board The game board, only the lowest `SOLVER_MAX_HEIGHT` rows may be filled.
+ * @param pieces Tetromino types in the order they come (e.g. the falling one and `Game.next`).
+ * @param count Number of pieces that may be used.
+ * @param budgetUs Time budget of the whole search (in µs).
+ * @return `SOLVE_FOUND` with the placements in `solver->path`, otherwise why there is none.
+ */
+SolveResult solve_perfect_clear(PcSolver *solver, const GameBoard *board, const U8 *pieces, U8 count, U32 budgetUs) {
+	U64 bits = 0;
+	U8 filled = 0, height = 0, row;
+
+	for(U8 x=0;x<BOARD_WIDTH;x++) {
+		for(U8 y=0;y<BOARD_HEIGHT;y++) {
+			if(board->state[x][y] == 0) {
+				continue;
+			}
+			row = BOARD_HEIGHT - 1 - y;
+			if(row >= SOLVER_MAX_HEIGHT) {
+				return SOLVE_TOO_HIGH;
+			}
+			bits |= 1ULL << (row * BOARD_WIDTH + x);
+			filled++;
+			if(row + 1 > height) {
+				height = row + 1;
+			}
+		}
+	}
+
+	if(count > SOLVER_MAX_PIECES) {
+		count = SOLVER_MAX_PIECES;
+	}
+	solver->pieces = pieces;
+	solver->deadline = now_ns() + (I64)budgetUs * 1000;
+	solver->timedOut = false;
+	solver->length = 0;
+
+	for(U8 limit=(height > 0) ? height : 1;limit<=SOLVER_MAX_HEIGHT;limit++) {
+		if((limit * BOARD_WIDTH - filled) % 4 != 0 || (limit * BOARD_WIDTH - filled) / 4 > count) {
+			continue;
+		}
+
+		solver->pieceCount = (limit * BOARD_WIDTH - filled) / 4;
+		solver->generation++; // forget the failures of the other heights
+		if(regions_fillable(bits, limit) && search(solver, bits, 0, limit)) {
+			solver->length = solver->pieceCount;
+			return SOLVE_FOUND;
+		}
+		if(solver->timedOut) {
+			return SOLVE_TIMEOUT;
+		}
+	}
+	return SOLVE_NONE;
+}
+
+/**
+ * @brief Frees the memo table of a solver.
+ *
+ * @param solver The solver.
+ */
+void free_solver(PcSolver *solver) {
+	free(solver->memo);
+	solver->memo = NULL;
+}
@@ -0,0 +1,549 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include "stream.h"
+
+/**
+ * @brief Stores a little endian value of `bytes` bytes.
+ */
+static void put_le(U8 *out, U64 value, U8 bytes) {
+	for(U8 i=0;i<bytes;i++) {
+		out[i] = (U8)(value >> (8 * i));
+	}
+}
+
+/**
+ * @brief Loads a little endian value of `bytes` bytes.
+ */
+static U64 get_le(const U8 *in, U8 bytes) {
+	U64 value = 0;
+
+	for(U8 i=0;i<bytes;i++) {
+		value |= (U64)in[i] << (8 * i);
+	}
+	return value;
+}
+
+/**
+ * @brief Packs everything a viewer needs to draw a frame into a fixed layout.
+ *
+ * The board is stored as one bit per cell and all fields are little endian, so consecutive
+ * frames mostly differ in a few bytes (piece position, tick) and XOR well.
+ *
+ * | offset | field                       |
+ * |--------|-----------------------------|
+ * | 0      | state, hasPiece             |
+ * | 2      | board cells (30 bytes)      |
+ * | 32     | level, score, highscore     |
+ * | 52     | piece: rotation state, rotations, column, row, fraction, type, color |
+ * | 69     | boardVersion, tick          |
+ * | 81     | board colors (4 bytes a row) |
+ *
+ * @param frame The frame snapshot.
+ * @param packed Output buffer.
+ */
+void pack_frame(const Frame *frame, U8 packed[STREAM_FRAME_SIZE]) {
+	U16 cell;
+
+	memset(packed, 0, STREAM_FRAME_SIZE);
+	packed[0] = (U8)frame->state;
+	packed[1] = frame->hasPiece;
+
+	for(U8 y=0;y<BOARD_HEIGHT;y++) {
+		for(U8 x=0;x<BOARD_WIDTH;x++) {
+			cell = y * BOARD_WIDTH + x;
+			if(frame->board.state[x][y] == 1) {
+				packed[2 + cell / 8] |= 1 << (cell % 8);
+			}
+		}
+	}
+
+	put_le(packed + 32, frame->board.level, 4);
+	put_le(packed + 36, frame->board.score, 8);
+	put_le(packed + 44, frame->board.highscore, 8);
+	packed[52] = frame->piece.rotationState;
+	for(U8 i=0;i<4;i++) {
+		put_le(packed + 53 + 2 * i, frame->piece.rotations[i], 2);
+	}
+	packed[61] = (U8)frame->piece.col;
+	packed[62] = (U8)frame->piece.row;
+	packed[63] = frame->piece.fraction;
+	packed[64] = frame->piece.type;
+	put_le(packed + 65, frame->piece.color, 4);
+	put_le(packed + 69, frame->boardVersion, 4);
+	put_le(packed + 73, frame->tick, 8);
+	for(U8 y=0;y<BOARD_HEIGHT;y++) {
+		put_le(packed + 81 + 4 * y, frame->board.colors[y], 4);
+	}
+}
+
+/**
+ * @brief Restores a frame packed by `pack_frame`.
+ *
+ * @param packed The packed frame.
+ * @param frame Output frame.
+ */
+void unpack_frame(const U8 packed[STREAM_FRAME_SIZE], Frame *frame) {
+	U16 cell;
+
+	memset(frame, 0, sizeof(*frame));
+	frame->state = (GameState)packed[0];
+	frame->hasPiece = packed[1] != 0;
+
+	for(U8 y=0;y<BOARD_HEIGHT;y++) {
+		for(U8 x=0;x<BOARD_WIDTH;x++) {
+			cell = y * BOARD_WIDTH + x;
+			frame->board.state[x][y] = (packed[2 + cell / 8] >> (cell % 8)) & 1;
+		}
+	}
+
+	frame->board.level = get_le(packed + 32, 4);
+	frame->board.score = get_le(packed + 36, 8);
+	frame->board.highscore = get_le(packed + 44, 8);
+	frame->piece.rotationState = packed[52] % 4;
+	for(U8 i=0;i<4;i++) {
+		frame->piece.rotations[i] = get_le(packed + 53 + 2 * i, 2);
+	}
+	frame->piece.col = (I8)packed[61];
+	frame->piece.row = (I8)packed[62];
+	frame->piece.fraction = packed[63] % BLOCKSIZE;
+	frame->piece.type = packed[64] % TETROMINO_TYPES;
+	frame->piece.color = get_le(packed + 65, 4);
+	frame->boardVersion = get_le(packed + 69, 4);
+	frame->tick = get_le(packed + 73, 8);
+	for(U8 y=0;y<BOARD_HEIGHT;y++) {
+		frame->board.colors[y] = get_le(packed + 81 + 4 * y, 4) & CELL_COLOR_ROW_MASK;
+	}
+}
+
+/**
+ * @brief Encodes a packed frame as XOR against the previous one, run length coded.
+ *
+ * The output is a sequence of tokens: number of unchanged bytes, number of changed bytes,
+ * followed by the XOR of the changed bytes. A frame where only the piece moved takes a few bytes.
+ *
+ * @param previous The previous packed frame.
+ * @param current The packed frame to encode.
+ * @param out Output buffer.
+ * @param capacity Size of the output buffer.
+ * @return Length of the delta, 0 if nothing changed or it would not fit into `capacity`.
+ */
+U16 encode_delta(const U8 *previous, const U8 *current, U8 *out, U16 capacity) {
+	U16 length = 0;
+	U16 i = 0;
+	U8 zeros, literals;
+
+	while(i < STREAM_FRAME_SIZE) {
+		zeros = 0;
+		while(i < STREAM_FRAME_SIZE && zeros < 0xff && previous[i] == current[i]) {
+			zeros++;
+			i++;
+		}
+		if(i == STREAM_FRAME_SIZE) {
+			break; // trailing unchanged bytes are implied
+		}
+
+		literals = 0;
+		while(i + literals < STREAM_FRAME_SIZE && literals < 0xff && previous[i + literals] != current[i + literals]) {
+			literals++;
+		}
+
+		if(length + 2 + literals > capacity) {
+			return 0;
+		}
+		out[length++] = zeros;
+		out[length++] = literals;
+		for(U8 j=0;j<literals;j++) {
+			out[length++] = previous[i + j] ^ current[i + j];
+		}
+		i += literals;
+	}
+
+	return length;
+}
+
+/**
+ * @brief Applies a delta made by `encode_delta` to a packed frame.
+ *
+ * @param delta The delta.
+ * @param length Length of the delta.
+ * @param frame The previous packed frame, updated in place.
+ * @return `0` on success, `-1` if the delta is corrupt.
+ */
+I8 decode_delta(const U8 *delta, U16 length, U8 *frame) {
+	U16 position = 0;
+	U16 i = 0;
+
+	while(i + 2 <= length) {
+		position += delta[i];
+		if(position + delta[i + 1] > STREAM_FRAME_SIZE || i + 2 + delta[i + 1] > length) {
+			return -1;
+		}
+		for(U8 j=0;j<delta[i + 1];j++) {
+			frame[position++] ^= delta[i + 2 + j];
+		}
+		i += 2 + delta[i + 1];
+	}
+
+	return (i == length) ? 0 : -1;
+}
+
+/**
+ * @brief Writes the header of a stream message.
+ */
+static void put_header(U8 *message, StreamMessageType type, U16 length, U64 sequence) {
+	message[0] = type;
+	message[1] = 0;
+	put_le(message + 2, length, 2);
+	put_le(message + 4, sequence, 8);
+}
+
+/**
+ * @brief Removes a viewer, its slot is filled with the last one.
+ *
+ * @param server The stream server.
+ * @param index Index of the viewer.
+ */
+static void drop_viewer(StreamServer *server, U32 index) {
+	epoll_ctl(server->epollFd, EPOLL_CTL_DEL, server->viewers[index], NULL);
+	close(server->viewers[index]);
+
+	server->viewerCount--;
+	server->viewers[index] = server->viewers[server->viewerCount];
+	server->needsKeyframe[index] = server->needsKeyframe[server->viewerCount];
+}
+
+/**
+ * @brief Accepts new viewers and handles the messages and hangups of connected ones.
+ *
+ * Viewers only ever send a byte to ask for a keyframe after they lost track of the deltas.
+ *
+ * @param server The stream server.
+ */
+static void poll_viewers(StreamServer *server) {
+	struct epoll_event events[64];
+	struct epoll_event event;
+	int count, fd;
+	U8 request[16];
+	ssize_t received;
+
+	count = epoll_wait(server->epollFd, events, sizeof(events) / sizeof(events[0]), 0);
+	for(int i=0;i<count;i++) {
+		if(events[i].data.fd == server->listenFd) {
+			while((fd = accept(server->listenFd, NULL, NULL)) >= 0) {
+				if(server->viewerCount == STREAM_MAX_VIEWERS) {
+					close(fd);
+					continue;
+				}
+				fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+				event.events = EPOLLIN;
+				event.data.fd = fd;
+				if(epoll_ctl(server->epollFd, EPOLL_CTL_ADD, fd, &event) != 0) {
+					close(fd);
+					continue;
+				}
+				server->viewers[server->viewerCount] = fd;
+				server->needsKeyframe[server->viewerCount] = true; // late joiners start with a keyframe
+				server->viewerCount++;
+			}
+			continue;
+		}
+
+		for(U32 v=0;v<server->viewerCount;v++) {
+			if(server->viewers[v] != events[i].data.fd) {
+				continue;
+			}
+
+			received = recv(server->viewers[v], request, sizeof(request), MSG_DONTWAIT);
+			if(received > 0) {
+				server->needsKeyframe[v] = true;
+			} else if(received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+				drop_viewer(server, v);
+			}
+			break;
+		}
+	}
+}
+
+/**
+ * @brief Removes a socket file, anything else at the path is left alone.
+ *
+ * @param path Path of the socket.
+ * @return `0` if nothing is left at the path, `-1` if something other than a socket is there.
+ */
+static I8 remove_socket(const char *path) {
+	struct stat status;
+
+	if(lstat(path, &status) != 0) {
+		return (errno == ENOENT) ? 0 : -1;
+	}
+	if(!S_ISSOCK(status.st_mode)) {
+		return -1;
+	}
+	return (unlink(path) == 0 || errno == ENOENT) ? 0 : -1;
+}
+
+/**
+ * @brief Opens the Unix domain socket the spectators connect to.
+ *
+ * `SOCK_SEQPACKET` keeps the message boundaries, so a message is either sent completely or
+ * not at all and viewers never see partial frames.
+ *
+ * @param server The stream server to initialize.
+ * @param path Path of the socket (a stale socket is replaced, any other file is an error).
+ * @return `0` on success, `-1` on error.
+ */
+I8 init_stream_server(StreamServer *server, const char *path) {
+	struct sockaddr_un address;
+	struct epoll_event event;
+
+	memset(server, 0, sizeof(*server));
+	server->listenFd = -1;
+	server->epollFd = -1;
+
+	if(strlen(path) >= sizeof(address.sun_path) || strlen(path) >= sizeof(server->path)) {
+		fprintf(stderr, "Error: stream socket path %s is too long\n", path);
+		return -1;
+	}
+	strcpy(server->path, path);
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+	if(remove_socket(path) != 0) {
+		fprintf(stderr, "Error: %s exists and is not a socket that can be replaced\n", path);
+		return -1;
+	}
+
+	if((server->listenFd = socket(AF_UNIX, SOCK_SEQPACKET, 0)) < 0
+		|| bind(server->listenFd, (struct sockaddr *)&address, sizeof(address)) != 0
+		|| listen(server->listenFd, 64) != 0) {
+		fprintf(stderr, "Error: could not listen on %s\n", path);
+		free_stream_server(server);
+		return -1;
+	}
+	fcntl(server->listenFd, F_SETFL, fcntl(server->listenFd, F_GETFL) | O_NONBLOCK);
+
+	event.events = EPOLLIN;
+	event.data.fd = server->listenFd;
+	if((server->epollFd = epoll_create1(0)) < 0 || epoll_ctl(server->epollFd, EPOLL_CTL_ADD, server->listenFd, &event) != 0) {
+		fprintf(stderr, "Error: could not create the epoll instance for the stream\n");
+		free_stream_server(server);
+		return -1;
+	}
+
+	server->statsSince = now_ns();
+	return 0;
+}
+
+/**
+ * @brief Publishes a frame to all connected viewers.
+ *
+ * The frame is encoded once as delta against the previously published one and the same
+ * message is sent to every viewer. Viewers that just joined, asked for it or could not take
+ * the last message (full socket buffer) get a keyframe instead, and every
+ * `STREAM_KEYFRAME_INTERVAL` frames all of them do. Unchanged frames are not sent at all.
+ *
+ * @param server The stream server.
+ * @param frame The frame snapshot.
+ */
+void stream_frame(StreamServer *server, const Frame *frame) {
+	U8 packed[STREAM_FRAME_SIZE];
+	U8 delta[STREAM_MESSAGE_SIZE];
+	U8 keyframe[STREAM_HEADER_SIZE + STREAM_FRAME_SIZE];
+	U16 deltaLength;
+	bool periodic;
+	I64 start, now;
+	ssize_t sent;
+
+	poll_viewers(server);
+
+	start = now_ns();
+	pack_frame(frame, packed);
+	deltaLength = encode_delta(server->previous, packed, delta + STREAM_HEADER_SIZE, STREAM_MESSAGE_SIZE - STREAM_HEADER_SIZE);
+	if(deltaLength == 0 && server->sequence != 0) {
+		return; // nothing changed
+	}
+
+	server->sequence++;
+	periodic = (server->sequence - server->lastKeyframe >= STREAM_KEYFRAME_INTERVAL);
+	if(periodic) {
+		server->lastKeyframe = server->sequence;
+	}
+	put_header(delta, STREAM_DELTA, deltaLength, server->sequence);
+	put_header(keyframe, STREAM_KEYFRAME, STREAM_FRAME_SIZE, server->sequence);
+	memcpy(keyframe + STREAM_HEADER_SIZE, packed, STREAM_FRAME_SIZE);
+	memcpy(server->previous, packed, STREAM_FRAME_SIZE);
+	server->encodeNs += now_ns() - start;
+	server->framesEncoded++;
+
+	for(U32 v=0;v<server->viewerCount;v++) {
+		if(periodic || server->needsKeyframe[v]) {
+			sent = send(server->viewers[v], keyframe, sizeof(keyframe), MSG_DONTWAIT | MSG_NOSIGNAL);
+		} else {
+			sent = send(server->viewers[v], delta, STREAM_HEADER_SIZE + deltaLength, MSG_DONTWAIT | MSG_NOSIGNAL);
+		}
+
+		if(sent > 0) {
+			server->needsKeyframe[v] = false;
+			server->bytesSent += sent;
+		} else if(errno == EAGAIN || errno == EWOULDBLOCK) {
+			server->needsKeyframe[v] = true; // slow viewer, the next delta would not apply
+		} else {
+			drop_viewer(server, v);
+			v--;
+		}
+	}
+
+	now = now_ns();
+	if(now - server->statsSince >= STREAM_STATS_INTERVAL_S * 1000000000L) {
+		printf("Stream: %u viewers, encoding %ld ns/frame, %.0f B/s per viewer\n",
+			server->viewerCount,
+			server->encodeNs / (I64)(server->framesEncoded ? server->framesEncoded : 1),
+			server->viewerCount ? server->bytesSent / ((now - server->statsSince) / 1e9) / server->viewerCount : 0.0);
+		server->framesEncoded = 0;
+		server->encodeNs = 0;
+		server->bytesSent = 0;
+		server->statsSince = now;
+	}
+}
+
+/**
+ * @brief Disconnects all viewers and removes the socket.
+ *
+ * @param server The stream server.
+ */
+void free_stream_server(StreamServer *server) {
+	for(U32 v=0;v<server->viewerCount;v++) {
+		close(server->viewers[v]);
+	}
+	server->viewerCount = 0;
+
+	if(server->epollFd >= 0) {
+		close(server->epollFd);
+		server->epollFd = -1;
+	}
+	if(server->listenFd >= 0) {
+		close(server->listenFd);
+		server->listenFd = -1;
+		(void)remove_socket(server->path); // left alone if something replaced the socket
+	}
+}
+
+/**
+ * @brief Watches a game published by `stream_frame` instead of playing.
+ *
+ * The messages are read without blocking once per tick and the latest frame is drawn with
+ * `render_frame`, like a local game. A gap in the sequence or a corrupt delta makes the viewer
+ * ask for a keyframe and ignore deltas until it arrived. Key presses are ignored, Escape or
+ * closing the window exits.
+ *
+ * @param xw Pointer to the XWindow structure containing display and window info.
+ * @param rb The render backend drawing into the window.
+ * @param screens Pointer to the ScreenCache with the static screens.
+ * @param path Path of the stream socket.
+ * @return `0` when the user or the server ended the stream, `-1` if it could not connect.
+ */
+I8 run_viewer(XWindow *xw, RenderBackend *rb, ScreenCache *screens, const char *path) {
+	struct sockaddr_un address;
+	struct timespec deadline;
+	InputQueue queue = {0};
+	InputEvent event;
+	U32 mousePos[2];
+	U8 message[STREAM_MESSAGE_SIZE];
+	U8 packed[STREAM_FRAME_SIZE];
+	Frame drawn, current;
+	Animations animations; // only the game over fill, the stream has no locks
+	U64 sequence = 0;
+	U64 bytesReceived = 0;
+	bool synced = false;
+	bool haveFrame = false;
+	bool running = true;
+	I64 start = now_ns();
+	ssize_t received;
+	U16 length;
+	int fd;
+
+	if(strlen(path) >= sizeof(address.sun_path)) {
+		fprintf(stderr, "Error: stream socket path %s is too long\n", path);
+		return -1;
+	}
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+
+	if((fd = socket(AF_UNIX, SOCK_SEQPACKET, 0)) < 0 || connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+		fprintf(stderr, "Error: could not connect to the stream %s\n", path);
+		if(fd >= 0) {
+			close(fd);
+		}
+		return -1;
+	}
+
+	memset(&drawn, 0, sizeof(drawn));
+	init_animations(&animations, &drawn);
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	while(running) {
+		if(recv_events(xw->display, &queue, mousePos)) {
+			break;
+		}
+		while(pop_input(&queue, &event)) {
+			// spectators do not play
+		}
+
+		while((received = recv(fd, message, sizeof(message), MSG_DONTWAIT)) != 0) {
+			if(received < 0) {
+				if(errno != EAGAIN && errno != EWOULDBLOCK) {
+					running = false;
+				}
+				break;
+			}
+			bytesReceived += received;
+
+			length = get_le(message + 2, 2);
+			if(received < STREAM_HEADER_SIZE || STREAM_HEADER_SIZE + length != received) {
+				continue;
+			}
+
+			if(message[0] == STREAM_KEYFRAME && length == STREAM_FRAME_SIZE) {
+				memcpy(packed, message + STREAM_HEADER_SIZE, STREAM_FRAME_SIZE);
+				synced = true;
+			} else if(message[0] == STREAM_DELTA && synced && get_le(message + 4, 8) == sequence + 1) {
+				if(decode_delta(message + STREAM_HEADER_SIZE, length, packed) != 0) {
+					synced = false;
+				}
+			} else if(synced) {
+				synced = false;
+			} else {
+				continue; // still waiting for the requested keyframe
+			}
+
+			if(!synced) {
+				(void)send(fd, "K", 1, MSG_DONTWAIT | MSG_NOSIGNAL);
+				continue;
+			}
+			sequence = get_le(message + 4, 8);
+			if(!haveFrame) {
+				needsRedraw = 1; // nothing was drawn yet
+				haveFrame = true;
+			}
+		}
+		if(received == 0) {
+			running = false; // the game ended
+		}
+
+		if(haveFrame) {
+			unpack_frame(packed, &current);
+			render_frame(rb, screens, &animations, &drawn, &current);
+			drawn = current;
+			end_x_frame(&xAccounting);
+		}
+
+		wait_next_tick(&deadline, TICK_NS);
+	}
+
+	printf("Stream: received %.0f B/s\n", bytesReceived / ((now_ns() - start) / 1e9));
+	close(fd);
+	return 0;
+}
@@ -6,12 +6,11 @@
  * 
  * @param display Pointer to the Display structure representing the connection to the X server.
  * @param window The main application window to be initialized.
- * @param xim Pointer to an XIM input method structure.
- * @param xic Pointer to an XIC input context structure.
  * @return I8 Returns 0 on success, or -1 on failure.
  */
-I8 init_main_window(Display *display, Window window, XIM *xim, XIC *xic) {
+I8 init_main_window(Display *display, Window window) {
     XSizeHints *hints;
+    Bool detectableRepeat;
 
     // Disallow resizing of the window
     if ((hints = XAllocSizeHints()) == NULL) {
@@ -33,19 +32,12 @@ I8 init_main_window(Display *display, Window window, XIM *xim, XIC *xic) {
     // Map the window (make it visible)
     XMapWindow(display, window);
 
-    // Select input events (keyboard, mouse, etc.)
-    XSelectInput(display, window, KeyPressMask | ButtonPressMask | StructureNotifyMask | ExposureMask);
+    // Select input events (keyboard, mouse, etc.), releases are needed to know which keys are held
+    XSelectInput(display, window, KeyPressMask | KeyReleaseMask | ButtonPressMask | StructureNotifyMask | ExposureMask | FocusChangeMask);
 
-    // Initialize input method and input context
-    if ((*xim = XOpenIM(display, NULL, NULL, NULL)) == NULL) {
-        fprintf(stderr, "Error: could not open input method\n");
-        return -1;
-    }
-
-    if ((*xic = XCreateIC(*xim, XNInputStyle, XIMPreeditNothing | XIMStatusNothing, XNClientWindow, window, NULL)) == NULL) {
-        fprintf(stderr, "Error: could not create input context\n");
-        XCloseIM(*xim);
-        return -1;
+    // Held keys should not produce release/press pairs, the game repeats them itself (DAS/ARR)
+    if (!XkbSetDetectableAutoRepeat(display, True, &detectableRepeat) || !detectableRepeat) {
+        fprintf(stderr, "Warning: detectable auto repeat is not supported, filtering repeated keys\n");
     }
 
     XStoreName(display, window, "Cubes"); // tell the WM our game name for the window
@@ -0,0 +1,185 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include "writer.h"
+
+/**
+ * @brief A pending file write, owned by the writer once submitted.
+ */
+typedef struct {
+	char path[256];		///< Destination, replaced atomically
+	U8 *data;			///< Copy of the content (`NULL` if nothing is pending)
+	size_t length;
+	bool durable;		///< `fsync` the file and the directory before/after the rename
+} WriteJob;
+
+static pthread_t writerThread;
+static pthread_mutex_t writerLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writerWake = PTHREAD_COND_INITIALIZER;
+static WriteJob pending[WRITE_SLOT_COUNT];
+static bool writerRunning = false;
+
+/**
+ * @brief Replaces a file atomically: write a temporary file next to it and rename it over the old one.
+ *
+ * A crash leaves either the old or the new file, never a partially written one.
+ *
+ * @param job The job to write.
+ * @return `0` on success, `-1` on failure.
+ */
+static I8 replace_file(const WriteJob *job) {
+	char tmpPath[sizeof(job->path) + 8];
+	char dirPath[sizeof(job->path)];
+	ssize_t written;
+	size_t offset = 0;
+	int fd;
+
+	snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", job->path);
+	if((fd = open(tmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+		fprintf(stderr, "Error: could not create %s\n", tmpPath);
+		return -1;
+	}
+
+	while(offset < job->length) {
+		if((written = write(fd, job->data + offset, job->length - offset)) <= 0) {
+			fprintf(stderr, "Error: could not write %s\n", tmpPath);
+			close(fd);
+			unlink(tmpPath);
+			return -1;
+		}
+		offset += (size_t)written;
+	}
+
+	if(job->durable) {
+		fsync(fd);
+	}
+	close(fd);
+
+	if(rename(tmpPath, job->path) != 0) {
+		fprintf(stderr, "Error: could not replace %s\n", job->path);
+		unlink(tmpPath);
+		return -1;
+	}
+
+	if(job->durable) {
+		// make the rename itself survive a power loss
+		strcpy(dirPath, job->path);
+		if((fd = open(dirname(dirPath), O_RDONLY)) >= 0) {
+			fsync(fd);
+			close(fd);
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Writer thread: writes the pending jobs until the writer is stopped and nothing is pending.
+ *
+ * @param arg Unused.
+ * @return Always `NULL`.
+ */
+static void *writer_thread(void *arg) {
+	WriteJob job;
+	bool found;
+
+	(void)arg;
+
+	pthread_mutex_lock(&writerLock);
+	while(true) {
+		found = false;
+		for(U8 i=0;i<WRITE_SLOT_COUNT && !found;i++) {
+			if(pending[i].data != NULL) {
+				job = pending[i];
+				pending[i].data = NULL;
+				found = true;
+			}
+		}
+
+		if(!found) {
+			if(!writerRunning) {
+				break;
+			}
+			pthread_cond_wait(&writerWake, &writerLock);
+			continue;
+		}
+
+		// the slow part (write, fsync, rename) runs without the lock
+		pthread_mutex_unlock(&writerLock);
+		(void)replace_file(&job);
+		free(job.data);
+		pthread_mutex_lock(&writerLock);
+	}
+	pthread_mutex_unlock(&writerLock);
+
+	return NULL;
+}
+
+/**
+ * @brief Starts the background writer thread.
+ *
+ * @return `0` on success, `-1` if the thread could not be started.
+ */
+I8 start_writer(void) {
+	writerRunning = true;
+	if(pthread_create(&writerThread, NULL, writer_thread, NULL) != 0) {
+		fprintf(stderr, "Error: could not start the writer thread\n");
+		writerRunning = false;
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * @brief Hands a file to the writer thread, the caller never waits for the disk.
+ *
+ * The data is copied. If an older write for the same slot is still pending it is replaced,
+ * only the newest content is written. Without a running writer the file is written directly.
+ *
+ * @param slot The slot of the file.
+ * @param path Destination path.
+ * @param data The new file content.
+ * @param length Length of the content in bytes.
+ * @param durable `true` to `fsync` the file and its directory.
+ */
+void submit_write(WriteSlot slot, const char *path, const void *data, size_t length, bool durable) {
+	WriteJob job;
+
+	if((job.data = malloc(length)) == NULL) {
+		fprintf(stderr, "Error: failed to allocate mem for %s\n", path);
+		return;
+	}
+	memcpy(job.data, data, length);
+	snprintf(job.path, sizeof(job.path), "%s", path);
+	job.length = length;
+	job.durable = durable;
+
+	pthread_mutex_lock(&writerLock);
+	if(!writerRunning) {
+		pthread_mutex_unlock(&writerLock);
+		(void)replace_file(&job);
+		free(job.data);
+		return;
+	}
+
+	free(pending[slot].data);
+	pending[slot] = job;
+	pthread_cond_signal(&writerWake);
+	pthread_mutex_unlock(&writerLock);
+}
+
+/**
+ * @brief Writes everything still pending and stops the writer thread.
+ */
+void stop_writer(void) {
+	pthread_mutex_lock(&writerLock);
+	if(!writerRunning) {
+		pthread_mutex_unlock(&writerLock);
+		return;
+	}
+	writerRunning = false;
+	pthread_cond_signal(&writerWake);
+	pthread_mutex_unlock(&writerLock);
+
+	pthread_join(writerThread, NULL);
+}
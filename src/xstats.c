@@ -0,0 +1,313 @@
+/// \file
+#define _POSIX_C_SOURCE 200809L
+
+#include "xstats.h"
+#include <X11/Xlibint.h> // output buffer of the display, only read
+
+/**
+ * @brief Adds the traffic since the last observation to the current frame.
+ *
+ * Requests are counted exactly from the request sequence number. Bytes are taken from the fill
+ * level of the Xlib output buffer, a flush inside a single call hides the part written before it.
+ *
+ * @param accounting The accounting state.
+ */
+static void observe(XAccounting *accounting) {
+	struct _XDisplay *display = (struct _XDisplay *)accounting->display;
+	unsigned long request = XNextRequest(accounting->display);
+	size_t buffered = (size_t)(display->bufptr - display->buffer);
+
+	accounting->frame.requests += request - accounting->request;
+	if(buffered < accounting->buffered) {
+		// the buffer was sent in between
+		accounting->frame.flushes++;
+		accounting->frame.bytes += buffered;
+	} else {
+		accounting->frame.bytes += buffered - accounting->buffered;
+	}
+
+	accounting->request = request;
+	accounting->buffered = buffered;
+}
+
+/**
+ * @brief Starts the accounting of a wrapped drawing call.
+ *
+ * @param accounting The accounting state.
+ * @return The last request the server is known to have processed.
+ */
+static unsigned long begin_call(XAccounting *accounting) {
+	observe(accounting);
+	return LastKnownRequestProcessed(accounting->display);
+}
+
+/**
+ * @brief Finishes the accounting of a wrapped drawing call.
+ *
+ * Drawing never reads events, so if the server processed more requests meanwhile
+ * Xlib waited for a reply.
+ *
+ * @param accounting The accounting state.
+ * @param lastProcessed The value returned by `begin_call`.
+ */
+static void end_call(XAccounting *accounting, unsigned long lastProcessed) {
+	observe(accounting);
+	if(LastKnownRequestProcessed(accounting->display) != lastProcessed) {
+		accounting->frame.roundTrips++;
+	}
+}
+
+/**
+ * @brief Accounted `create_surface`.
+ * @see RenderBackend
+ */
+static Surface accounted_create_surface(void *ctx, U16 width, U16 height) {
+	XAccounting *accounting = ctx;
+	unsigned long lastProcessed = begin_call(accounting);
+	Surface surface = accounting->inner.create_surface(accounting->inner.ctx, width, height);
+
+	end_call(accounting, lastProcessed);
+	return surface;
+}
+
+/**
+ * @brief Accounted `free_surface`.
+ * @see RenderBackend
+ */
+static void accounted_free_surface(void *ctx, Surface surface) {
+	XAccounting *accounting = ctx;
+	unsigned long lastProcessed = begin_call(accounting);
+
+	accounting->inner.free_surface(accounting->inner.ctx, surface);
+	end_call(accounting, lastProcessed);
+}
+
+/**
+ * @brief Accounted `clear`.
+ * @see RenderBackend
+ */
+static void accounted_clear(void *ctx, Surface target, I16 x, I16 y, U16 width, U16 height) {
+	XAccounting *accounting = ctx;
+	unsigned long lastProcessed = begin_call(accounting);
+
+	accounting->inner.clear(accounting->inner.ctx, target, x, y, width, height);
+	end_call(accounting, lastProcessed);
+}
+
+/**
+ * @brief Accounted `fill_rects`.
+ * @see RenderBackend
+ */
+static void accounted_fill_rects(void *ctx, Surface target, U32 color, const XRectangle *rects, U16 count) {
+	XAccounting *accounting = ctx;
+	unsigned long lastProcessed = begin_call(accounting);
+
+	accounting->inner.fill_rects(accounting->inner.ctx, target, color, rects, count);
+	end_call(accounting, lastProcessed);
+}
+
+/**
+ * @brief Accounted `blit`.
+ * @see RenderBackend
+ */
+static void accounted_blit(void *ctx, Surface source, I16 sourceX, I16 sourceY, U16 width, U16 height, Surface target, I16 x, I16 y) {
+	XAccounting *accounting = ctx;
+	unsigned long lastProcessed = begin_call(accounting);
+
+	accounting->inner.blit(accounting->inner.ctx, source, sourceX, sourceY, width, height, target, x, y);
+	end_call(accounting, lastProcessed);
+}
+
+/**
+ * @brief Accounted `fill_tiled`.
+ * @see RenderBackend
+ */
+static void accounted_fill_tiled(void *ctx, Surface target, Surface source, const XRectangle *area, I16 originX, I16 originY, const XRectangle *rects, U16 count) {
+	XAccounting *accounting = ctx;
+	unsigned long lastProcessed = begin_call(accounting);
+
+	accounting->inner.fill_tiled(accounting->inner.ctx, target, source, area, originX, originY, rects, count);
+	end_call(accounting, lastProcessed);
+}
+
+/**
+ * @brief Accounted `text`.
+ * @see RenderBackend
+ */
+static void accounted_text(void *ctx, Surface target, FontId font, I16 x, I16 y, const char *text, bool glow) {
+	XAccounting *accounting = ctx;
+	unsigned long lastProcessed = begin_call(accounting);
+
+	accounting->inner.text(accounting->inner.ctx, target, font, x, y, text, glow);
+	end_call(accounting, lastProcessed);
+}
+
+/**
+ * @brief Accounted `text_extents` (may upload glyphs).
+ * @see RenderBackend
+ */
+static void accounted_text_extents(void *ctx, FontId font, const char *text, XGlyphInfo *extents) {
+	XAccounting *accounting = ctx;
+	unsigned long lastProcessed = begin_call(accounting);
+
+	accounting->inner.text_extents(accounting->inner.ctx, font, text, extents);
+	end_call(accounting, lastProcessed);
+}
+
+/**
+ * @brief Passes `line_height` through, it never talks to the server.
+ * @see RenderBackend
+ */
+static U16 accounted_line_height(void *ctx, FontId font) {
+	XAccounting *accounting = ctx;
+	return accounting->inner.line_height(accounting->inner.ctx, font);
+}
+
+/**
+ * @brief Accounted `set_clip`.
+ * @see RenderBackend
+ */
+static void accounted_set_clip(void *ctx, Region clip) {
+	XAccounting *accounting = ctx;
+	unsigned long lastProcessed = begin_call(accounting);
+
+	accounting->inner.set_clip(accounting->inner.ctx, clip);
+	end_call(accounting, lastProcessed);
+}
+
+/**
+ * @brief Accounted `flush`.
+ * @see RenderBackend
+ */
+static void accounted_flush(void *ctx) {
+	XAccounting *accounting = ctx;
+	unsigned long lastProcessed = begin_call(accounting);
+
+	accounting->inner.flush(accounting->inner.ctx);
+	end_call(accounting, lastProcessed);
+}
+
+/**
+ * @brief Starts counting the X traffic of a render backend.
+ *
+ * The backend is replaced by a wrapper that observes the connection around every call,
+ * the callers keep using the same RenderBackend.
+ *
+ * @param accounting The accounting state to initialize.
+ * @param rb The backend drawing on `display`, wrapped in place.
+ * @param display The connection to account.
+ * @param overlay Draw the traffic of the last frame into the window (see `end_x_frame`).
+ */
+void account_backend(XAccounting *accounting, RenderBackend *rb, Display *display, bool overlay) {
+	memset(accounting, 0, sizeof(*accounting));
+	accounting->display = display;
+	accounting->overlay = overlay;
+	accounting->inner = *rb;
+	accounting->request = XNextRequest(display);
+	observe(accounting);
+	memset(&accounting->frame, 0, sizeof(accounting->frame)); // everything before was startup
+
+	rb->ctx = accounting;
+	rb->create_surface = accounted_create_surface;
+	rb->free_surface = accounted_free_surface;
+	rb->clear = accounted_clear;
+	rb->fill_rects = accounted_fill_rects;
+	rb->blit = accounted_blit;
+	rb->fill_tiled = accounted_fill_tiled;
+	rb->text = accounted_text;
+	rb->text_extents = accounted_text_extents;
+	rb->line_height = accounted_line_height;
+	rb->set_clip = accounted_set_clip;
+	rb->flush = accounted_flush;
+}
+
+/**
+ * @brief Accounts the traffic of the event handling (`recv_events`).
+ *
+ * `XPending` flushes the output buffer, the requests were already counted by the drawing calls.
+ *
+ * @param accounting The accounting state (does nothing while it is off).
+ */
+void account_x_io(XAccounting *accounting) {
+	if(accounting->display != NULL) {
+		observe(accounting);
+	}
+}
+
+/**
+ * @brief Waits until the server processed everything sent so far, the sync itself is not counted.
+ *
+ * Fences the frames of the X11 benchmark, the round trip of `XSync` belongs to no frame.
+ *
+ * @param accounting The accounting state (does nothing while it is off).
+ */
+void sync_x_frame(XAccounting *accounting) {
+	if(accounting->display == NULL) {
+		return;
+	}
+	observe(accounting);
+	XSync(accounting->display, False);
+	accounting->request = XNextRequest(accounting->display);
+	accounting->buffered = 0; // sent by the sync
+}
+
+/**
+ * @brief Closes the accounting of a frame and draws the overlay.
+ *
+ * The overlay is only redrawn if the numbers changed (or once per second, in case a screen
+ * was drawn over it), its own requests are counted for the next frame.
+ *
+ * @param accounting The accounting state (does nothing while it is off).
+ */
+void end_x_frame(XAccounting *accounting) {
+	RenderBackend *rb = &accounting->inner;
+	char line[X_OVERLAY_LENGTH];
+	XStats *frame = &accounting->frame;
+
+	if(accounting->display == NULL) {
+		return;
+	}
+
+	observe(accounting);
+	accounting->last = *frame;
+	accounting->total.requests += frame->requests;
+	accounting->total.bytes += frame->bytes;
+	accounting->total.roundTrips += frame->roundTrips;
+	accounting->total.flushes += frame->flushes;
+	if(frame->requests > accounting->peak.requests) accounting->peak.requests = frame->requests;
+	if(frame->bytes > accounting->peak.bytes) accounting->peak.bytes = frame->bytes;
+	if(frame->roundTrips > accounting->peak.roundTrips) accounting->peak.roundTrips = frame->roundTrips;
+	if(frame->flushes > accounting->peak.flushes) accounting->peak.flushes = frame->flushes;
+	accounting->frames++;
+	memset(frame, 0, sizeof(*frame));
+
+	if(!accounting->overlay) {
+		return;
+	}
+	if(memcmp(&accounting->last, &accounting->shown, sizeof(XStats)) == 0 && accounting->frames % TICK_RATE != 0) {
+		return;
+	}
+
+	snprintf(line, sizeof(line), "X: %lu req %lu B %lu rt", (unsigned long)accounting->last.requests, (unsigned long)accounting->last.bytes, (unsigned long)accounting->last.roundTrips);
+	rb->set_clip(rb->ctx, NULL);
+	rb->clear(rb->ctx, SURFACE_WINDOW, X_OVERLAY_X, X_OVERLAY_Y, X_OVERLAY_WIDTH, rb->line_height(rb->ctx, FONT_TEXT));
+	rb->text(rb->ctx, SURFACE_WINDOW, FONT_TEXT, X_OVERLAY_X, X_OVERLAY_Y, line, false);
+	accounting->shown = accounting->last;
+}
+
+/**
+ * @brief Prints the X traffic of the whole run.
+ *
+ * @param accounting The accounting state.
+ */
+void print_x_summary(const XAccounting *accounting) {
+	double frames = (accounting->frames > 0) ? (double)accounting->frames : 1;
+
+	printf("X traffic: %lu frames, %lu requests, %lu bytes, %lu round trips, %lu flushes\n",
+		(unsigned long)accounting->frames, (unsigned long)accounting->total.requests, (unsigned long)accounting->total.bytes,
+		(unsigned long)accounting->total.roundTrips, (unsigned long)accounting->total.flushes);
+	printf("  per frame: %.1f requests (peak %lu), %.0f bytes (peak %lu), %.3f round trips (peak %lu)\n",
+		accounting->total.requests / frames, (unsigned long)accounting->peak.requests,
+		accounting->total.bytes / frames, (unsigned long)accounting->peak.bytes,
+		accounting->total.roundTrips / frames, (unsigned long)accounting->peak.roundTrips);
+}